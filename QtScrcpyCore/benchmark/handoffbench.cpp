@@ -0,0 +1,184 @@
+// 解码线程 -> 渲染线程帧交接的对比测试
+// - mutex: 原来的双缓冲交接，解码线程和读者共用一把锁，读者在锁内上传纹理时解码线程要等待
+// - triple: 现在的VideoBuffer三缓冲交接，解码线程不取读者锁
+// 用法: qsc_handoff_bench [frames] [decodeIntervalUs] [renderIntervalUs] [uploadUs]
+// 输出每种交接offerDecodedFrame的耗时分布(ns)以及读者消费/跳过的帧数
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "videobuffer.h"
+
+namespace {
+
+// 原来的VideoBuffer双缓冲交接（不含m_renderExpiredFrames）
+class MutexHandoff
+{
+public:
+    void lock() { m_mutex.lock(); }
+    void unLock() { m_mutex.unlock(); }
+
+    void offerDecodedFrame(bool &previousFrameSkipped)
+    {
+        m_mutex.lock();
+        std::swap(m_decodingFrame, m_renderingFrame);
+        previousFrameSkipped = !m_renderingFrameConsumed;
+        m_renderingFrameConsumed = false;
+        m_mutex.unlock();
+    }
+
+    // 必须持有lock()
+    const int *consumeRenderedFrame()
+    {
+        if (m_renderingFrameConsumed) {
+            return Q_NULLPTR;
+        }
+        m_renderingFrameConsumed = true;
+        return m_renderingFrame;
+    }
+
+private:
+    QMutex m_mutex;
+    int m_frames[2] = { 0, 0 };
+    int *m_decodingFrame = &m_frames[0];
+    int *m_renderingFrame = &m_frames[1];
+    bool m_renderingFrameConsumed = true;
+};
+
+struct Options
+{
+    int frames = 2000;
+    int decodeIntervalUs = 4000;
+    int renderIntervalUs = 8000;
+    // 读者在锁内处理一帧的时间（纹理上传）
+    int uploadUs = 2000;
+};
+
+struct Result
+{
+    std::vector<qint64> offerNs;
+    quint64 consumed = 0;
+    quint64 skipped = 0;
+};
+
+void spinUs(int us)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.nsecsElapsed() < static_cast<qint64>(us) * 1000) {
+    }
+}
+
+class FuncThread : public QThread
+{
+public:
+    explicit FuncThread(std::function<void()> func) : m_func(func) {}
+
+protected:
+    void run() override { m_func(); }
+
+private:
+    std::function<void()> m_func;
+};
+
+template<typename Handoff>
+Result run(Handoff &handoff, const Options &options)
+{
+    Result result;
+    result.offerNs.reserve(static_cast<size_t>(options.frames));
+    std::atomic<bool> done(false);
+
+    FuncThread reader([&]() {
+        while (!done.load()) {
+            handoff.lock();
+            if (handoff.consumeRenderedFrame()) {
+                result.consumed++;
+                spinUs(options.uploadUs);
+            }
+            handoff.unLock();
+            QThread::usleep(static_cast<unsigned long>(qMax(0, options.renderIntervalUs - options.uploadUs)));
+        }
+    });
+    reader.start();
+
+    QElapsedTimer timer;
+    for (int i = 0; i < options.frames; ++i) {
+        bool skipped = false;
+        timer.start();
+        handoff.offerDecodedFrame(skipped);
+        result.offerNs.push_back(timer.nsecsElapsed());
+        if (skipped) {
+            result.skipped++;
+        }
+        QThread::usleep(static_cast<unsigned long>(options.decodeIntervalUs));
+    }
+
+    done = true;
+    reader.wait();
+    return result;
+}
+
+void print(const char *name, Result &result)
+{
+    std::vector<qint64> &ns = result.offerNs;
+    if (ns.empty()) {
+        return;
+    }
+    std::sort(ns.begin(), ns.end());
+    qint64 total = 0;
+    for (qint64 value : ns) {
+        total += value;
+    }
+    const size_t count = ns.size();
+    std::printf("%-8s offered %zu consumed %llu skipped %llu | offer ns avg %lld p50 %lld p99 %lld max %lld\n",
+                name, count, result.consumed, result.skipped,
+                total / static_cast<qint64>(count), ns[count / 2], ns[qMin(count - 1, count * 99 / 100)], ns[count - 1]);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    Options options;
+    const QStringList args = app.arguments();
+    if (args.size() > 1) {
+        options.frames = qMax(1, args[1].toInt());
+    }
+    if (args.size() > 2) {
+        options.decodeIntervalUs = qMax(0, args[2].toInt());
+    }
+    if (args.size() > 3) {
+        options.renderIntervalUs = qMax(0, args[3].toInt());
+    }
+    if (args.size() > 4) {
+        options.uploadUs = qMax(0, args[4].toInt());
+    }
+    std::printf("frames %d decode interval %d us render interval %d us upload %d us\n",
+                options.frames, options.decodeIntervalUs, options.renderIntervalUs, options.uploadUs);
+
+    MutexHandoff mutexHandoff;
+    Result mutexResult = run(mutexHandoff, options);
+    print("mutex", mutexResult);
+
+    VideoBuffer videoBuffer;
+    if (!videoBuffer.init()) {
+        std::fprintf(stderr, "could not init video buffer\n");
+        return 1;
+    }
+    Result tripleResult = run(videoBuffer, options);
+    videoBuffer.deInit();
+    print("triple", tripleResult);
+
+    return 0;
+}
@@ -1,9 +1,15 @@
 #pragma once
 #include <QPointer>
 #include <QMouseEvent>
+#include <QStringList>
+
+#include <atomic>
 
 #include "QtScrcpyCoreDef.h"
 
+// 核心中按设备、按观察者保存的投递策略，更新deliveryStats的计数
+class FrameGate;
+
 namespace qsc {
 
 class DeviceObserver {
@@ -26,7 +32,31 @@ public:
         Q_UNUSED(linesizeU);
         Q_UNUSED(linesizeV);
     }
+    // 带引用计数的帧，onFrame返回后仍可持有（例如交给渲染线程直接上传YUV平面）
+    // 核心调用的是这个接口，frame为frameFormat()请求的格式；默认转发到onFrame（只适用于PF_I420）
+    virtual void onFrameBuffer(const FrameBufferPtr &frame) {
+        if (frame->format != PF_I420) {
+            return;
+        }
+        onFrame(frame->width, frame->height, frame->data[0], frame->data[1], frame->data[2],
+                frame->linesize[0], frame->linesize[1], frame->linesize[2]);
+    }
+    // 希望接收的帧规格，每帧投递前在投递线程中查询，可以随显示尺寸变化
+    // 默认源尺寸的I420，不做任何转换
+    virtual FrameFormat frameFormat() const { return FrameFormat(); }
     virtual void updateFPS(quint32 fps) { Q_UNUSED(fps); }
+    // 当前onFrame对应帧的设备PTS(us)，只在onFrame内有效，用于IDevice::markFrameStage
+    qint64 framePts() const { return m_framePts; }
+    // 由核心在调用onFrame前设置
+    void setFramePts(qint64 pts) { m_framePts = pts; }
+    // 投递统计，注册到多个设备时为各设备之和；可在任意线程调用
+    FrameDeliveryStats deliveryStats() const {
+        FrameDeliveryStats stats;
+        stats.delivered = m_deliveredFrames.load(std::memory_order_relaxed);
+        stats.decimated = m_decimatedFrames.load(std::memory_order_relaxed);
+        stats.unchanged = m_unchangedFrames.load(std::memory_order_relaxed);
+        return stats;
+    }
     virtual void grabCursor(bool grab) {Q_UNUSED(grab);}
 
     virtual void mouseEvent(const QMouseEvent *from, const QSize &frameSize, const QSize &showSize) {
@@ -72,6 +102,14 @@ public:
     virtual void installApkRequest(const QString &apkFile) { Q_UNUSED(apkFile); }
     virtual void screenshot() {}
     virtual void showTouch(bool show) { Q_UNUSED(show); }
+
+private:
+    friend class ::FrameGate;
+
+    qint64 m_framePts = -1;
+    std::atomic<quint64> m_deliveredFrames{0};
+    std::atomic<quint64> m_decimatedFrames{0};
+    std::atomic<quint64> m_unchangedFrames{0};
 };
 
 class IDevice : public QObject {
@@ -87,7 +125,10 @@ signals:
 public:
     virtual void setUserData(void* data) = 0;
     virtual void* getUserData() = 0;
-    virtual void registerDeviceObserver(DeviceObserver* observer) = 0;
+    // 非GUI线程的观察者需要自己保证onFrame的线程安全，deRegister会等待正在进行的onFrame返回
+    // （在该观察者自己的onFrame中deRegister时不等待，本次返回后不会再被调用）；onFrame调用时核心不持有内部锁
+    // 新注册的观察者立即收到最近解码的一帧（FA_DECODE_THREAD除外，从下一帧开始）
+    virtual void registerDeviceObserver(DeviceObserver* observer, FrameAffinity affinity = FA_GUI_THREAD) = 0;
     virtual void deRegisterDeviceObserver(DeviceObserver* observer) = 0;
 
     virtual bool connectDevice() = 0;
@@ -118,8 +159,30 @@ public:
     virtual void installApkRequest(const QString &apkFile) = 0;
 
     virtual void screenshot() = 0;
+    // 异步截图：帧的引用在锁内获取，转换和编码在工作线程中完成
+    virtual void screenshot(const ScreenshotParams& params, ScreenshotCallback callback = Q_NULLPTR) = 0;
     virtual void showTouch(bool show) = 0;
 
+    // 焦点设备在解码调度中优先
+    virtual void setDecodeFocus(bool focus) = 0;
+    virtual DecodeStats decodeStats() = 0;
+    // 切换解码模式，从关键帧/暂停模式恢复时补解缓存的最近一组图像立即出图，
+    // 缓存不可用（DeviceParams::gopCacheBytes为0或一组超过上限）时在下一个关键帧处重新开始解码
+    virtual void setDecodeMode(DecodeMode mode) = 0;
+    virtual DecodeMode decodeMode() = 0;
+
+    // 控制通道的发送统计和往返时间，可在任意线程调用
+    virtual ControlStats controlStats() = 0;
+
+    // 帧延迟分布（p50/p95/p99）
+    virtual LatencyStats latencyStats() = 0;
+    virtual void resetLatencyStats() = 0;
+    // 渲染端上报帧到达LS_UPLOAD/LS_PRESENT，pts取自DeviceObserver::framePts()，可在任意线程调用
+    virtual void markFrameStage(qint64 pts, LatencyStage stage) = 0;
+
+    // 游戏键位定时触摸的发送抖动，可在任意线程调用
+    virtual InputTimingStats inputTimingStats() = 0;
+
     virtual bool isReversePort(quint16 port) = 0;
     virtual quint16 getLocalPort() = 0;  // 获取设备使用的本地端口（reverse 或 forward 模式）
     virtual const QString &getSerial() = 0;
@@ -137,6 +200,12 @@ public:
     virtual void disconnectAllDevice() = 0;
     virtual QPointer<IDevice> getDevice(const QString& serial) = 0;
 
+    // 群控：hostSerial设备产生的每条控制消息都广播给members（忽略其中的hostSerial），
+    // 触摸/滚动坐标按各成员的画面尺寸缩放；hostSerial为空时停止广播
+    // 成员可以还未连接，连接后自动加入
+    virtual void setBroadcastGroup(const QString &hostSerial, const QStringList &members) = 0;
+    virtual BroadcastStats broadcastStats() = 0;
+
 signals:
     void deviceConnected(bool success, const QString& serial, const QString& deviceName, const QSize& size);
     void deviceDisconnected(QString serial);
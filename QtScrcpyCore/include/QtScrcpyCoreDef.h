@@ -1,6 +1,12 @@
 #pragma once
+#include <QByteArray>
 #include <QString>
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
 namespace qsc {
 
 struct DeviceParams {
@@ -24,7 +30,9 @@ struct DeviceParams {
     // 例如 CodecOptions="profile=1,level=2"
     // 更多编码选项参考 https://d.android.com/reference/android/media/MediaFormat
     QString codecOptions = "";
-    // 指定编码器名称(必须是H.264编码器)，""表示默认
+    // 视频编码 h264/h265/av1，实际编码以视频流头部的codec id为准
+    QString videoCodec = "h264";
+    // 指定编码器名称(必须与videoCodec一致)，""表示默认
     // 例如 CodecName="OMX.qcom.video.encoder.avc"
     QString codecName = "";
     quint32 scid = -1; // 随机数，作为localsocket名字后缀，方便同时连接同一个设备多次
@@ -39,6 +47,13 @@ struct DeviceParams {
     bool display = true;              // 是否显示画面（或者仅仅后台录制）
     bool renderExpiredFrames = false; // 是否渲染延迟视频帧
     QString gameScript = "";          // 游戏映射脚本
+    // 最近一组图像（关键帧及其后的数据包）的缓存上限(字节)，0表示不缓存
+    // 恢复解码时从缓存立即出图，而不是等待下一个关键帧；一组超过上限时等到下一个关键帧
+    qint64 gopCacheBytes = 8 * 1024 * 1024;
+    // 触摸MOVE的合并窗口(ms)，同一触摸点在窗口内只发送最新的位置；-1表示跟随视频帧率，0表示不合并
+    int touchMoveCoalesceMs = -1;
+    bool controlQuickAck = false;     // 控制socket设置TCP_QUICKACK（仅Linux），TCP_NODELAY总是设置
+    int controlRttProbeMs = 2000;     // 控制往返时间的取样间隔(ms)，0表示不取样；仅Linux/Windows
 
     // TCP直接连接模式（不使用adb）
     bool useDirectTcp = false;        // 是否使用直接TCP连接模式
@@ -48,4 +63,177 @@ struct DeviceParams {
     quint16 tcpControlPort = 9997;    // TCP控制流端口
 };
     
+// 截图输出格式
+enum ScreenshotFormat {
+    SF_PNG = 0,
+    SF_JPEG,
+    SF_RAW,                           // 原始RGB32数据（QImage::Format_RGB32内存布局）
+};
+
+struct ScreenshotParams {
+    ScreenshotFormat format = SF_PNG; // 输出格式
+    int quality = -1;                 // PNG/JPEG质量 0~100，-1表示默认
+    bool saveToFile = true;           // 是否保存到recordPath目录
+    int burstCount = 1;               // 连拍张数
+    int burstIntervalMs = 0;          // 连拍间隔(ms)
+};
+
+struct ScreenshotResult {
+    bool success = false;
+    int index = 0;                    // 连拍中的序号，从0开始
+    int width = 0;
+    int height = 0;
+    ScreenshotFormat format = SF_PNG;
+    QByteArray data;                  // 编码后的数据（SF_RAW时为RGB32像素）
+    QString filePath;                 // saveToFile时的保存路径
+};
+
+// 截图完成回调，在设备所在线程中调用
+typedef std::function<void(const ScreenshotResult& result)> ScreenshotCallback;
+
+// 解码模式，用于不可见或缩略图显示的设备降低解码开销
+enum DecodeMode {
+    DECODE_FULL = 0,                  // 完整解码
+    DECODE_SKIP_NONREF,               // 跳过非参考帧及其环路滤波（skip_frame/skip_loop_filter = AVDISCARD_NONREF）
+    DECODE_KEYFRAME_ONLY,             // 只解码关键帧（AVDISCARD_NONKEY）
+    DECODE_PAUSED,                    // 暂停解码
+};
+
+// 解码统计
+struct DecodeStats {
+    int queueDepth = 0;               // 当前输入队列长度
+    int maxQueueDepth = 0;            // 输入队列最大长度
+    quint64 decodedPackets = 0;       // 已解码的数据包
+    quint64 droppedPackets = 0;       // 队列溢出丢弃的数据包
+    qint64 avgDecodeUs = 0;           // 平均单包解码耗时(us)
+    qint64 maxDecodeUs = 0;           // 最大单包解码耗时(us)
+    QString codec;                    // 解码器名称 h264/hevc/av1
+    quint64 decodedBytes = 0;         // 已解码的数据量，与decodedPackets*avgDecodeUs对比可得各编码的码率/CPU开销
+    quint64 elidedFrames = 0;         // 与上一帧画面相同、跳过分发/转换/上传的帧
+    quint64 partialFrames = 0;        // 只有局部变化、带变化区域的帧
+    quint64 primedPackets = 0;        // 恢复解码时从GOP缓存补解的数据包
+};
+
+// 控制通道统计
+struct ControlStats {
+    quint64 sentMessages = 0;         // 已发送的控制消息
+    quint64 sentBytes = 0;
+    quint64 flushes = 0;              // 写入次数，同一次事件循环内的消息合并写入
+    quint64 rttSamples = 0;           // 往返时间取样次数（读取内核的TCP估计，不发送消息）
+    quint64 rttUnavailable = 0;       // 内核还没有估计的取样
+    qint64 lastRttUs = -1;            // 最近一次控制连接的TCP往返时间(us)，-1表示还没有测量
+    qint64 avgRttUs = -1;             // 平滑的往返时间(us)
+    qint64 minRttUs = -1;
+    qint64 maxRttUs = -1;
+};
+
+// 群控成员的广播统计
+struct BroadcastMemberStats {
+    QString serial;
+    int width = 0;                    // 成员的画面尺寸，0表示未知（不缩放坐标）
+    int height = 0;
+    qint64 lastSkewUs = -1;           // 最近一次广播相对第一个写入的成员的延后(us)
+    qint64 avgSkewUs = -1;            // 平滑的延后(us)
+};
+
+struct BroadcastStats {
+    int members = 0;                  // 控制通道已就绪的成员（不含主控设备）
+    int sizeClasses = 0;              // 不同的成员画面尺寸，每种尺寸每条消息只编码一次
+    quint64 messages = 0;             // 已广播的控制消息
+    quint64 encodes = 0;              // 实际编码的负载数
+    qint64 lastSpreadUs = -1;         // 最近一次广播第一个到最后一个成员写入的时间差(us)
+    qint64 maxSpreadUs = -1;
+    std::vector<BroadcastMemberStats> memberStats;
+};
+
+// 观察者请求的像素格式
+enum FramePixelFormat {
+    PF_I420 = 0,                      // 解码器原始格式，Y/U/V三个平面
+    PF_NV12,                          // Y平面 + UV交错平面
+    PF_ARGB,                          // 单平面，内存顺序B,G,R,A（libyuv ARGB / QImage::Format_ARGB32）
+    PF_RGBA,                          // 单平面，内存顺序R,G,B,A
+};
+
+// 观察者订阅的帧规格，同一设备上规格相同的观察者共享同一次转换
+struct FrameFormat {
+    FramePixelFormat format = PF_I420;
+    int width = 0;                    // 0表示源尺寸，宽高需同时设置
+    int height = 0;
+    int maxFps = 0;                   // 按设备PTS均匀抽帧，0表示不限制
+    bool receiveFrames = true;        // false表示不接收帧（只转发输入的观察者），不唤醒也不转换
+};
+
+// 单个观察者的帧投递统计
+struct FrameDeliveryStats {
+    quint64 delivered = 0;            // 已投递
+    quint64 decimated = 0;            // 按maxFps抽掉
+    quint64 unchanged = 0;            // 画面与上一次投递的相同，跳过
+};
+
+struct FrameRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// 解码帧的只读引用，不拷贝像素；平面数据在最后一个引用释放前一直有效
+struct FrameBuffer {
+    FramePixelFormat format = PF_I420;
+    int width = 0;
+    int height = 0;
+    int sourceWidth = 0;              // 解码尺寸（设备画面分辨率），转换后的帧也保持不变
+    int sourceHeight = 0;
+    uint8_t *data[3] = { nullptr, nullptr, nullptr };
+    int linesize[3] = { 0, 0, 0 };
+    qint64 pts = -1;                  // 设备PTS(us)
+    quint64 contentId = 0;            // 画面内容id，与上一帧画面相同时不变
+    // 相对内容id为contentId-1的画面变化的区域（本帧的像素坐标），空表示整帧都要更新
+    // 接收方只有在持有contentId-1的画面时才能只更新这些区域
+    std::vector<FrameRect> dirtyRects;
+    std::shared_ptr<void> holder;     // 持有解码器缓冲区的引用
+};
+typedef std::shared_ptr<const FrameBuffer> FrameBufferPtr;
+
+// 帧延迟阶段，每个阶段统计从上一个已到达阶段到本阶段的耗时
+enum LatencyStage {
+    LS_NETWORK = 0,                   // 设备PTS -> 收到帧头（相对最小单向延迟的增量）
+    LS_PARSE,                         // 收到帧头 -> 解析完成
+    LS_DECODE,                        // 解析完成 -> 解码完成（含解码排队）
+    LS_CONVERT,                       // 解码完成 -> 第一个观察者onFrame返回
+    LS_UPLOAD,                        // -> 场景图上传（由渲染端上报）
+    LS_PRESENT,                       // -> 显示（由渲染端上报）
+    LS_TOTAL,                         // 收到帧头 -> 显示
+    LS_COUNT
+};
+
+struct LatencyPercentiles {
+    quint64 count = 0;
+    qint64 p50Us = 0;
+    qint64 p95Us = 0;
+    qint64 p99Us = 0;
+    qint64 maxUs = 0;
+};
+
+// 各阶段延迟分布，下标为LatencyStage
+struct LatencyStats {
+    LatencyPercentiles stages[LS_COUNT];
+};
+
+// 游戏键位的定时/插值触摸消息的发送统计
+struct InputTimingStats {
+    quint64 scheduled = 0;            // 已排入输入计时线程的消息
+    quint64 sent = 0;
+    quint64 cancelled = 0;            // 发送前被取消（例如方向盘换向）
+    LatencyPercentiles jitter;        // 实际发送时刻晚于截止时间的分布(us)
+};
+
+// 观察者接收onFrame的线程
+// 非GUI线程的观察者只保留最新一帧，处理不过来时丢弃旧帧而不是排队
+enum FrameAffinity {
+    FA_GUI_THREAD = 0,                // GUI线程（默认）
+    FA_DECODE_THREAD,                 // 解码线程中同步调用，onFrame必须尽快返回
+    FA_WORKER_POOL,                   // 共享的转换线程池
+};
+
 }
@@ -2,6 +2,7 @@
 #define COMPAT_H
 #include "libavcodec/version.h"
 #include "libavformat/version.h"
+#include "libavutil/version.h"
 
 // In ffmpeg/doc/APIchanges:
 // 2016-04-11 - 6f69f7a / 9200514 - lavf 57.33.100 / 57.5.0 - avformat.h
@@ -32,4 +33,22 @@
 #define QTSCRCPY_LAVF_HAS_NEW_ENCODING_DECODING_API
 #endif
 
+// In ffmpeg/doc/APIchanges:
+// 2021-04-27 - lavu 57.0.100 - buffer.h
+//   Use size_t for buffer sizes in AVBuffer and AVBufferPool functions.
+#if LIBAVUTIL_VERSION_MAJOR >= 57
+#define QTSCRCPY_LAVU_BUFFER_SIZE_T size_t
+#else
+#define QTSCRCPY_LAVU_BUFFER_SIZE_T int
+#endif
+
+// In ffmpeg/doc/APIchanges:
+// 2021-03-xx - lavc 59.0.100 - packet.h
+//   Use size_t for the side data size in av_packet_get_side_data() and friends.
+#if LIBAVCODEC_VERSION_MAJOR >= 59
+#define QTSCRCPY_LAVC_SIDE_DATA_SIZE_T size_t
+#else
+#define QTSCRCPY_LAVC_SIDE_DATA_SIZE_T int
+#endif
+
 #endif // COMPAT_H
@@ -0,0 +1,319 @@
+#include <QDebug>
+#include <QMutexLocker>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+#ifdef Q_OS_LINUX
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#define CONTROL_HAS_TCP_RTT
+#endif
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#include <mstcpip.h>
+#ifdef SIO_TCP_INFO
+#define CONTROL_HAS_TCP_RTT
+#endif
+#endif
+
+#include "controlchannel.h"
+#include "controlmsg.h"
+#include "devicemsg.h"
+
+namespace {
+
+QMutex s_ioMutex;
+QThread *s_ioThread = Q_NULLPTR;
+
+// 内核对这个连接平滑的往返时间(us)，不发送任何数据；不支持或还没有估计时返回-1
+qint64 tcpRttUs(qintptr fd)
+{
+    if (fd < 0) {
+        return -1;
+    }
+#if defined(Q_OS_LINUX)
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (getsockopt(static_cast<int>(fd), IPPROTO_TCP, TCP_INFO, &info, &len) != 0 || !info.tcpi_rtt) {
+        return -1;
+    }
+    return static_cast<qint64>(info.tcpi_rtt);
+#elif defined(CONTROL_HAS_TCP_RTT)
+    DWORD version = 0;
+    TCP_INFO_v0 info;
+    DWORD bytes = 0;
+    if (WSAIoctl(static_cast<SOCKET>(fd), SIO_TCP_INFO, &version, sizeof(version), &info, sizeof(info), &bytes, Q_NULLPTR, Q_NULLPTR) != 0
+        || !info.RttUs) {
+        return -1;
+    }
+    return static_cast<qint64>(info.RttUs);
+#else
+    return -1;
+#endif
+}
+
+}
+
+ControlChannel::ControlChannel()
+{
+    qRegisterMetaType<QSharedPointer<DeviceMsg>>("QSharedPointer<DeviceMsg>");
+}
+
+ControlChannel::~ControlChannel() {}
+
+QThread *ControlChannel::ioThread()
+{
+    QMutexLocker locker(&s_ioMutex);
+    if (!s_ioThread) {
+        s_ioThread = new QThread();
+        s_ioThread->setObjectName("ControlIO");
+    }
+    if (!s_ioThread->isRunning()) {
+        // 输入延迟比视频更敏感
+        s_ioThread->start(QThread::HighPriority);
+    }
+    return s_ioThread;
+}
+
+void ControlChannel::stopIoThread()
+{
+    QMutexLocker locker(&s_ioMutex);
+    // the thread object is kept, channels may still reference it
+    if (s_ioThread) {
+        s_ioThread->quit();
+        s_ioThread->wait();
+    }
+}
+
+bool ControlChannel::start(QTcpSocket *socket, bool quickAck, int rttIntervalMs)
+{
+    if (!socket || m_running.load()) {
+        return false;
+    }
+
+    QThread *thread = ioThread();
+    socket->setParent(Q_NULLPTR);
+    socket->moveToThread(thread);
+    moveToThread(thread);
+
+    QMetaObject::invokeMethod(this, [this, socket, quickAck, rttIntervalMs]() {
+        open(socket, quickAck, rttIntervalMs);
+    }, Qt::QueuedConnection);
+    m_running = true;
+    return true;
+}
+
+void ControlChannel::stop()
+{
+    if (!m_running.exchange(false)) {
+        return;
+    }
+
+    if (QThread::currentThread() == thread() || !thread()->isRunning()) {
+        close();
+    } else {
+        QMetaObject::invokeMethod(this, [this]() {
+            close();
+        }, Qt::BlockingQueuedConnection);
+    }
+    deleteLater();
+}
+
+qint64 ControlChannel::send(const QByteArray &buffer)
+{
+    if (buffer.isEmpty() || !m_running.load()) {
+        return 0;
+    }
+    m_queue.push(buffer);
+    // 一次事件循环内只投递一次，之后的消息由同一次flushQueue写出
+    if (!m_flushPending.exchange(true)) {
+        QMetaObject::invokeMethod(this, [this]() {
+            flushQueue();
+        }, Qt::QueuedConnection);
+    }
+    return buffer.size();
+}
+
+bool ControlChannel::writeDirect(const QByteArray &buffer)
+{
+    if (!m_socket || m_socket->state() != QAbstractSocket::ConnectedState) {
+        return false;
+    }
+    flushQueue();
+    if (m_socket->write(buffer) != buffer.size()) {
+        return false;
+    }
+    m_socket->flush();
+
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.sentMessages++;
+    m_stats.sentBytes += static_cast<quint64>(buffer.size());
+    m_stats.flushes++;
+    return true;
+}
+
+qsc::ControlStats ControlChannel::stats()
+{
+    QMutexLocker locker(&m_statsMutex);
+    return m_stats;
+}
+
+void ControlChannel::open(QTcpSocket *socket, bool quickAck, int rttIntervalMs)
+{
+    m_socket = socket;
+    m_quickAck = quickAck;
+    // 控制消息都很小，不能等Nagle合并
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    setQuickAck();
+    connect(m_socket, &QIODevice::readyRead, this, &ControlChannel::onReadyRead);
+
+#ifndef CONTROL_HAS_TCP_RTT
+    // 没有可用的往返时间来源
+    rttIntervalMs = 0;
+#endif
+    if (rttIntervalMs > 0) {
+        m_rttTimer = new QTimer(this);
+        m_rttTimer->setInterval(rttIntervalMs);
+        connect(m_rttTimer, &QTimer::timeout, this, &ControlChannel::onRttTimer);
+        m_rttTimer->start();
+    }
+
+    // messages may have been queued and data received before the socket was opened
+    flushQueue();
+    onReadyRead();
+}
+
+void ControlChannel::close()
+{
+    if (m_rttTimer) {
+        m_rttTimer->stop();
+        delete m_rttTimer;
+        m_rttTimer = Q_NULLPTR;
+    }
+
+    if (m_socket) {
+        m_socket->disconnect(this);
+        if (m_socket->state() != QAbstractSocket::UnconnectedState) {
+            m_socket->abort();
+        }
+        m_socket->deleteLater();
+        m_socket = Q_NULLPTR;
+    }
+
+    QByteArray buffer;
+    while (m_queue.pop(buffer)) {
+    }
+    m_parser.reset();
+
+    qsc::ControlStats s = stats();
+    qInfo() << "control channel messages:" << s.sentMessages << "bytes:" << s.sentBytes << "writes:" << s.flushes
+            << "rtt samples:" << s.rttSamples << "unavailable:" << s.rttUnavailable << "avg rtt us:" << s.avgRttUs;
+}
+
+void ControlChannel::flushQueue()
+{
+    m_flushPending.store(false);
+    if (!m_socket) {
+        // not opened yet, open() flushes
+        return;
+    }
+
+    quint64 messages = 0;
+    quint64 bytes = 0;
+    QByteArray buffer;
+    while (m_queue.pop(buffer)) {
+        if (m_socket->state() != QAbstractSocket::ConnectedState) {
+            continue;
+        }
+        // 只写入socket的缓冲区
+        if (m_socket->write(buffer) != buffer.size()) {
+            qWarning() << "control channel write failed:" << m_socket->errorString();
+            continue;
+        }
+        messages++;
+        bytes += static_cast<quint64>(buffer.size());
+    }
+    if (!messages) {
+        return;
+    }
+    // 所有排队的消息一次写出，不等下一次事件循环
+    m_socket->flush();
+
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.sentMessages += messages;
+    m_stats.sentBytes += bytes;
+    m_stats.flushes++;
+}
+
+void ControlChannel::onReadyRead()
+{
+    if (!m_socket) {
+        return;
+    }
+
+    while (m_socket->bytesAvailable() > 0) {
+        // 直接读入解析器的环形缓冲区，不经过中间的QByteArray
+        qint64 space = 0;
+        char *ptr = m_parser.writePointer(space);
+        if (space <= 0) {
+            break;
+        }
+        const qint64 len = m_socket->read(ptr, space);
+        if (len <= 0) {
+            break;
+        }
+        m_parser.commitWrite(len);
+
+        bool ok = m_parser.parse([this](const QSharedPointer<DeviceMsg> &msg) {
+            emit deviceMsg(msg);
+        });
+        if (!ok) {
+            // unknown message, the stream cannot be resynchronized
+            m_socket->readAll();
+            m_parser.reset();
+            break;
+        }
+    }
+    setQuickAck();
+}
+
+void ControlChannel::onRttTimer()
+{
+    if (!m_socket || m_socket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+
+    // 只读取内核的估计：应用层探测只能借用CMT_SET_CLIPBOARD的应答，
+    // 会覆盖用户在一个往返内刚在设备上复制的内容
+    const qint64 rttUs = tcpRttUs(m_socket->socketDescriptor());
+
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.rttSamples++;
+    if (rttUs < 0) {
+        m_stats.rttUnavailable++;
+        return;
+    }
+    m_stats.lastRttUs = rttUs;
+    m_stats.minRttUs = m_stats.minRttUs < 0 ? rttUs : qMin(m_stats.minRttUs, rttUs);
+    m_stats.maxRttUs = qMax(m_stats.maxRttUs, rttUs);
+    // 1/8 smoothing, like the TCP srtt
+    m_stats.avgRttUs = m_stats.avgRttUs < 0 ? rttUs : (m_stats.avgRttUs * 7 + rttUs) / 8;
+}
+
+void ControlChannel::setQuickAck()
+{
+#ifdef Q_OS_LINUX
+    if (!m_quickAck || !m_socket) {
+        return;
+    }
+    const qintptr fd = m_socket->socketDescriptor();
+    if (fd < 0) {
+        return;
+    }
+    // the kernel falls back to delayed ACKs, so it is set again after every read
+    int on = 1;
+    setsockopt(static_cast<int>(fd), IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+#endif
+}
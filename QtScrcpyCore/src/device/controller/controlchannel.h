@@ -0,0 +1,80 @@
+#ifndef CONTROLCHANNEL_H
+#define CONTROLCHANNEL_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+
+#include <atomic>
+
+#include "QtScrcpyCoreDef.h"
+#include "devicemsgparser.h"
+#include "mpscqueue.h"
+
+class QTcpSocket;
+class QThread;
+class QTimer;
+
+// 设备控制通道
+// 所有设备的控制socket都运行在同一个控制I/O线程中，与GUI线程的负载无关：
+// - send可以在任意线程调用，消息进入无锁队列，一次事件循环内的消息合并成一次写入
+// - socket设置TCP_NODELAY，可选TCP_QUICKACK（仅Linux）
+// - 定期读取内核对控制连接的TCP往返时间估计（Linux TCP_INFO，Windows SIO_TCP_INFO），
+//   不发送任何消息，对设备没有副作用；其他平台不统计
+// 收到的设备消息通过deviceMsg信号投递
+class ControlChannel : public QObject
+{
+    Q_OBJECT
+public:
+    ControlChannel();
+    virtual ~ControlChannel();
+
+    // 在GUI线程调用，接管socket并把自己和socket移到控制I/O线程
+    // rttIntervalMs: 读取内核TCP往返时间估计的间隔，为0时不取样
+    bool start(QTcpSocket *socket, bool quickAck, int rttIntervalMs);
+    // 在GUI线程调用，返回时socket已关闭，之后deleteLater
+    // 不能和其他线程的send同时进行
+    void stop();
+
+    // 返回排队的字节数，通道未运行时返回0
+    qint64 send(const QByteArray &buffer);
+    // 只能在控制I/O线程中调用（群控广播），先写出排队的消息以保持顺序，返回false表示没有写入
+    bool writeDirect(const QByteArray &buffer);
+    qsc::ControlStats stats();
+
+    // 所有设备共享的控制I/O线程
+    static QThread *ioThread();
+    // 退出并等待控制I/O线程
+    static void stopIoThread();
+
+signals:
+    void deviceMsg(QSharedPointer<DeviceMsg> msg);
+
+private:
+    // 以下在控制I/O线程中运行
+    void open(QTcpSocket *socket, bool quickAck, int rttIntervalMs);
+    void close();
+    void flushQueue();
+    void onReadyRead();
+    void onRttTimer();
+    void setQuickAck();
+
+private:
+    MpscQueue<QByteArray> m_queue;
+    std::atomic<bool> m_running{false};
+    // 已投递flushQueue，还没开始执行
+    std::atomic<bool> m_flushPending{false};
+
+    // 以下只在控制I/O线程中访问
+    QPointer<QTcpSocket> m_socket;
+    QTimer *m_rttTimer = Q_NULLPTR;
+    bool m_quickAck = false;
+    DeviceMsgParser m_parser;
+
+    QMutex m_statsMutex;
+    qsc::ControlStats m_stats;
+};
+
+#endif // CONTROLCHANNEL_H
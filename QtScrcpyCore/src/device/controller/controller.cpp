@@ -1,5 +1,6 @@
 #include <QApplication>
 #include <QClipboard>
+#include <QDebug>
 
 #include "controller.h"
 #include "controlmsg.h"
@@ -14,16 +15,124 @@ Controller::Controller(std::function<qint64(const QByteArray&)> sendData, QStrin
     m_receiver = new Receiver(this);
     Q_ASSERT(m_receiver);
 
+    // 设备按显示刷新率采样触摸，默认约60Hz
+    m_moveTimer.setInterval(16);
+    m_moveTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_moveTimer, &QTimer::timeout, this, &Controller::onMoveTimer);
+
+    m_inputLane = InputScheduler::instance().createLane(m_sendData);
+
     updateScript(gameScript);
 }
 
-Controller::~Controller() {}
+Controller::~Controller()
+{
+    // 之后计时线程不会再调用m_sendData
+    InputScheduler::instance().closeLane(m_inputLane);
+    qDeleteAll(m_pendingMoves);
+    m_pendingMoves.clear();
+    if (m_coalescedMoves) {
+        qInfo() << "coalesced touch moves:" << m_coalescedMoves;
+    }
+}
 
 void Controller::postControlMsg(ControlMsg *controlMsg)
 {
-    if (controlMsg) {
-        QCoreApplication::postEvent(this, controlMsg);
+    if (!controlMsg) {
+        return;
+    }
+    if (!controlMsg->isTouchMove() || m_moveTimer.interval() <= 0) {
+        // DOWN/UP等消息不能越过之前的MOVE
+        flushPendingMoves();
+        sendNow(controlMsg);
+        return;
+    }
+
+    if (!m_moveTimer.isActive()) {
+        // 窗口内的第一个MOVE不等待
+        sendNow(controlMsg);
+        m_moveTimer.start();
+        return;
+    }
+
+    for (int i = 0; i < m_pendingMoves.size(); ++i) {
+        if (m_pendingMoves[i]->touchId() == controlMsg->touchId()) {
+            delete m_pendingMoves[i];
+            m_pendingMoves[i] = controlMsg;
+            m_coalescedMoves++;
+            return;
+        }
+    }
+    m_pendingMoves.append(controlMsg);
+}
+
+void Controller::setMoveCoalesceInterval(int ms)
+{
+    ms = qMax(0, ms);
+    if (ms == m_moveTimer.interval()) {
+        return;
+    }
+    if (ms == 0) {
+        m_moveTimer.stop();
+        flushPendingMoves();
+    }
+    m_moveTimer.setInterval(ms);
+}
+
+int Controller::moveCoalesceInterval() const
+{
+    return m_moveTimer.interval();
+}
+
+void Controller::scheduleControlMsg(ControlMsg *controlMsg, qint64 deadlineNs, quint64 gesture)
+{
+    if (!controlMsg) {
+        return;
+    }
+    InputScheduler::instance().schedule(m_inputLane, deadlineNs, gesture, controlMsg->serializeData());
+    delete controlMsg;
+}
+
+qint64 Controller::cancelScheduled(quint64 gesture)
+{
+    return InputScheduler::instance().cancel(m_inputLane, gesture);
+}
+
+bool Controller::deferScheduled(quint64 gesture, qint64 notBeforeNs, ControlMsg *controlMsg)
+{
+    const QByteArray buffer = controlMsg ? controlMsg->serializeData() : QByteArray();
+    delete controlMsg;
+    return InputScheduler::instance().defer(m_inputLane, gesture, notBeforeNs, buffer);
+}
+
+qsc::InputTimingStats Controller::inputTimingStats()
+{
+    return InputScheduler::instance().stats(m_inputLane);
+}
+
+void Controller::sendNow(ControlMsg *controlMsg)
+{
+    // 立即发送的消息也按提交顺序进入输入Lane，不会越过之前已经到期但还没发出的定时消息
+    InputScheduler::instance().schedule(m_inputLane, InputScheduler::nowNs(), 0, controlMsg->serializeData());
+    delete controlMsg;
+}
+
+void Controller::flushPendingMoves()
+{
+    for (ControlMsg *controlMsg : m_pendingMoves) {
+        sendNow(controlMsg);
     }
+    m_pendingMoves.clear();
+}
+
+void Controller::onMoveTimer()
+{
+    if (m_pendingMoves.isEmpty()) {
+        // 一个窗口内没有新的MOVE，下一个MOVE立即发送
+        m_moveTimer.stop();
+        return;
+    }
+    flushPendingMoves();
 }
 
 void Controller::recvDeviceMsg(DeviceMsg *deviceMsg)
@@ -221,30 +330,6 @@ void Controller::keyEvent(const QKeyEvent *from, const QSize &frameSize, const Q
     }
 }
 
-bool Controller::event(QEvent *event)
-{
-    if (event && static_cast<ControlMsg::Type>(event->type()) == ControlMsg::Control) {
-        ControlMsg *controlMsg = dynamic_cast<ControlMsg *>(event);
-        if (controlMsg) {
-            sendControl(controlMsg->serializeData());
-        }
-        return true;
-    }
-    return QObject::event(event);
-}
-
-bool Controller::sendControl(const QByteArray &buffer)
-{
-    if (buffer.isEmpty()) {
-        return false;
-    }
-    qint32 len = 0;
-    if (m_sendData) {
-        len = static_cast<qint32>(m_sendData(buffer));
-    }
-    return len == buffer.length() ? true : false;
-}
-
 void Controller::postKeyCodeClick(AndroidKeycode keycode)
 {
     ControlMsg *controlEventDown = new ControlMsg(ControlMsg::CMT_INJECT_KEYCODE);
@@ -4,8 +4,11 @@
 
 #include <QObject>
 #include <QPointer>
+#include <QTimer>
+#include <QVector>
 
 #include "inputconvertbase.h"
+#include "inputscheduler.h"
 
 class QTcpSocket;
 class Receiver;
@@ -18,7 +21,22 @@ public:
     Controller(std::function<qint64(const QByteArray&)> sendData, QString gameScript = "", QObject *parent = Q_NULLPTR);
     virtual ~Controller();
 
+    // 同一触摸点连续的MOVE按合并窗口只发送最新的位置，其他消息（包括DOWN/UP）之前先发出暂存的MOVE，不改变顺序
+    // 和scheduleControlMsg共用同一个输入Lane：按键等立即发送的消息不会越过之前提交的已到期触摸
     void postControlMsg(ControlMsg *controlMsg);
+    // 触摸MOVE的合并窗口(ms)，0表示不合并
+    // 窗口内的第一个MOVE立即发送，之后的在窗口结束时只发送每个触摸点最新的一个
+    void setMoveCoalesceInterval(int ms);
+    int moveCoalesceInterval() const;
+    // 在输入计时线程中按deadlineNs（InputScheduler::nowNs()）发送，不经过合并窗口
+    // gesture非0时可以用cancelScheduled取消还未发送的部分
+    void scheduleControlMsg(ControlMsg *controlMsg, qint64 deadlineNs, quint64 gesture = 0);
+    // 返回取消时刻，截止时间不晚于它的消息照常发送
+    qint64 cancelScheduled(quint64 gesture);
+    // 推迟gesture当前这一批中还未发送的消息到notBeforeNs，controlMsg非空时替换它们
+    // 已有消息发出或没有这一批时返回false
+    bool deferScheduled(quint64 gesture, qint64 notBeforeNs, ControlMsg *controlMsg = Q_NULLPTR);
+    qsc::InputTimingStats inputTimingStats();
     void recvDeviceMsg(DeviceMsg *deviceMsg);
     void test(QRect rc);
 
@@ -55,17 +73,23 @@ public:
 signals:
     void grabCursor(bool grab);
 
-protected:
-    bool event(QEvent *event);
-
 private:
-    bool sendControl(const QByteArray &buffer);
+    void sendNow(ControlMsg *controlMsg);
     void postKeyCodeClick(AndroidKeycode keycode);
+    void flushPendingMoves();
+    void onMoveTimer();
 
 private:
     QPointer<Receiver> m_receiver;
     QPointer<InputConvertBase> m_inputConvert;
     std::function<qint64(const QByteArray&)> m_sendData = Q_NULLPTR;
+
+    QTimer m_moveTimer;
+    // 每个触摸点最新的MOVE，按第一次暂存的顺序
+    QVector<ControlMsg *> m_pendingMoves;
+    quint64 m_coalescedMoves = 0;
+
+    std::shared_ptr<InputScheduler::Lane> m_inputLane;
 };
 
 #endif // CONTROLLER_H
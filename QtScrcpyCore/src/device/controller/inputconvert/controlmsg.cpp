@@ -23,6 +23,21 @@ ControlMsg::~ControlMsg()
     }
 }
 
+ControlMsg::ControlMsgType ControlMsg::controlMsgType() const
+{
+    return m_data.type;
+}
+
+bool ControlMsg::isTouchMove() const
+{
+    return CMT_INJECT_TOUCH == m_data.type && AMOTION_EVENT_ACTION_MOVE == m_data.injectTouch.action;
+}
+
+quint64 ControlMsg::touchId() const
+{
+    return CMT_INJECT_TOUCH == m_data.type ? m_data.injectTouch.id : 0;
+}
+
 void ControlMsg::setInjectKeycodeMsgData(AndroidKeyeventAction action, AndroidKeycode keycode, quint32 repeat, AndroidMetastate metastate)
 {
     m_data.injectKeycode.action = action;
@@ -91,6 +106,11 @@ void ControlMsg::setSetClipboardMsgData(QString &text, bool paste)
     m_data.setClipboard.sequence = 0;
 }
 
+void ControlMsg::setSetClipboardSequence(quint64 sequence)
+{
+    m_data.setClipboard.sequence = sequence;
+}
+
 void ControlMsg::setDisplayPowerData(bool on)
 {
     m_data.setDisplayPower.on = on;
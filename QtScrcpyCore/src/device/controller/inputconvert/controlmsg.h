@@ -68,11 +68,19 @@ public:
     void setInjectScrollMsgData(QRect position, float hScroll, float vScroll, AndroidMotioneventButtons buttons);
     void setGetClipboardMsgData(ControlMsg::GetClipboardCopyKey copyKey); 
     void setSetClipboardMsgData(QString &text, bool paste);
+    // 非0时设备设置剪贴板后回复DMT_ACK_CLIPBOARD
+    void setSetClipboardSequence(quint64 sequence);
     void setDisplayPowerData(bool on);
     void setBackOrScreenOnData(bool down);
 
     QByteArray serializeData();
 
+    ControlMsgType controlMsgType() const;
+    // CMT_INJECT_TOUCH且action为AMOTION_EVENT_ACTION_MOVE
+    bool isTouchMove() const;
+    // CMT_INJECT_TOUCH的触摸点id
+    quint64 touchId() const;
+
 private:
     void writePosition(QBuffer &buffer, const QRect &value);
     quint16 flostToU16fp(float f);
@@ -1,5 +1,6 @@
 #include "inputconvertbase.h"
 #include "controller.h"
+#include "inputscheduler.h"
 
 InputConvertBase::InputConvertBase(Controller *controller) : QObject(controller), m_controller(controller)
 {
@@ -14,3 +15,32 @@ void InputConvertBase::sendControlMsg(ControlMsg *msg)
         m_controller->postControlMsg(msg);
     }
 }
+
+void InputConvertBase::scheduleControlMsg(ControlMsg *msg, qint64 deadlineNs, quint64 gesture)
+{
+    if (!msg) {
+        return;
+    }
+    if (!m_controller) {
+        delete msg;
+        return;
+    }
+    m_controller->scheduleControlMsg(msg, deadlineNs, gesture);
+}
+
+qint64 InputConvertBase::cancelScheduled(quint64 gesture)
+{
+    if (!m_controller) {
+        return InputScheduler::nowNs();
+    }
+    return m_controller->cancelScheduled(gesture);
+}
+
+bool InputConvertBase::deferScheduled(quint64 gesture, qint64 notBeforeNs, ControlMsg *msg)
+{
+    if (!m_controller) {
+        delete msg;
+        return false;
+    }
+    return m_controller->deferScheduled(gesture, notBeforeNs, msg);
+}
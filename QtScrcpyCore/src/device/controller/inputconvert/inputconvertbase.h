@@ -31,6 +31,12 @@ signals:
 
 protected:
     void sendControlMsg(ControlMsg *msg);
+    // 交给输入计时线程，deadlineNs取自InputScheduler::nowNs()
+    void scheduleControlMsg(ControlMsg *msg, qint64 deadlineNs, quint64 gesture = 0);
+    // 返回取消时刻，截止时间不晚于它的消息照常发送
+    qint64 cancelScheduled(quint64 gesture);
+    // 推迟还未发出的这一批消息，msg非空时替换它们；已有消息发出时返回false
+    bool deferScheduled(quint64 gesture, qint64 notBeforeNs, ControlMsg *msg = Q_NULLPTR);
 
     QPointer<Controller> m_controller;
     // Qt reports repeated events as a boolean, but Android expects the actual
@@ -1,19 +1,20 @@
 #include <QDebug>
 #include <QCursor>
 #include <QGuiApplication>
-#include <QTimer>
 #include <QTime>
 #include <QRandomGenerator>
 
 #include "inputconvertgame.h"
+#include "inputscheduler.h"
 
 #define CURSOR_POS_CHECK 50
+#define MS_TO_NS(ms) (static_cast<qint64>(ms) * 1000000)
+// 小眼睛切换时抬起和重新按下的间隔
+#define SMALL_EYES_DELAY_NS MS_TO_NS(30)
+// 鼠标停止移动后抬起视角控制的触摸
+#define MOUSE_MOVE_IDLE_NS MS_TO_NS(500)
 
-InputConvertGame::InputConvertGame(Controller *controller) : InputConvertNormal(controller) {
-    m_ctrlSteerWheel.delayData.timer = new QTimer(this);
-    m_ctrlSteerWheel.delayData.timer->setSingleShot(true);
-    connect(m_ctrlSteerWheel.delayData.timer, &QTimer::timeout, this, &InputConvertGame::onSteerWheelTimer);
-}
+InputConvertGame::InputConvertGame(Controller *controller) : InputConvertNormal(controller) {}
 
 InputConvertGame::~InputConvertGame() {}
 
@@ -88,18 +89,10 @@ void InputConvertGame::keyEvent(const QKeyEvent *from, const QSize &frameSize, c
             m_ctrlMouseMove.smallEyes = (QEvent::KeyPress == from->type());
 
             if (QEvent::KeyPress == from->type()) {
-                m_processMouseMove = false;
-                int delay = 30;
-                QTimer::singleShot(delay, this, [this]() { mouseMoveStopTouch(); });
-                QTimer::singleShot(delay * 2, this, [this]() {
-                    mouseMoveStartTouch(nullptr);
-                    m_processMouseMove = true;
-                });
-
-                stopMouseMoveTimer();
+                cancelMouseMoveIdle();
+                restartMouseMoveTouch(SMALL_EYES_DELAY_NS);
             } else {
-                mouseMoveStopTouch();
-                mouseMoveStartTouch(nullptr);
+                restartMouseMoveTouch(0);
             }
             return;
         }
@@ -159,49 +152,57 @@ void InputConvertGame::updateSize(const QSize &frameSize, const QSize &showSize)
     m_showSize = showSize;
 }
 
-void InputConvertGame::sendTouchDownEvent(int id, QPointF pos)
+void InputConvertGame::sendTouchDownEvent(int id, QPointF pos, qint64 deadlineNs, quint64 gesture)
 {
-    sendTouchEvent(id, pos, AMOTION_EVENT_ACTION_DOWN);
+    sendTouchEvent(id, pos, AMOTION_EVENT_ACTION_DOWN, deadlineNs, gesture);
 }
 
-void InputConvertGame::sendTouchMoveEvent(int id, QPointF pos)
+void InputConvertGame::sendTouchMoveEvent(int id, QPointF pos, qint64 deadlineNs, quint64 gesture)
 {
-    sendTouchEvent(id, pos, AMOTION_EVENT_ACTION_MOVE);
+    sendTouchEvent(id, pos, AMOTION_EVENT_ACTION_MOVE, deadlineNs, gesture);
 }
 
-void InputConvertGame::sendTouchUpEvent(int id, QPointF pos)
+void InputConvertGame::sendTouchUpEvent(int id, QPointF pos, qint64 deadlineNs, quint64 gesture)
 {
-    sendTouchEvent(id, pos, AMOTION_EVENT_ACTION_UP);
+    sendTouchEvent(id, pos, AMOTION_EVENT_ACTION_UP, deadlineNs, gesture);
 }
 
-void InputConvertGame::sendTouchEvent(int id, QPointF pos, AndroidMotioneventAction action)
+void InputConvertGame::sendTouchEvent(int id, QPointF pos, AndroidMotioneventAction action, qint64 deadlineNs, quint64 gesture)
 {
     if (0 > id || MULTI_TOUCH_MAX_NUM - 1 < id) {
         Q_ASSERT(0);
         return;
     }
     //qDebug() << "id:" << id << " pos:" << pos << " action" << action;
-    ControlMsg *controlMsg = new ControlMsg(ControlMsg::CMT_INJECT_TOUCH);
-    if (!controlMsg) {
-        return;
-    }
-
     QPoint absolutePos = calcFrameAbsolutePos(pos).toPoint();
     static QPoint lastAbsolutePos = absolutePos;
     if (AMOTION_EVENT_ACTION_MOVE == action && lastAbsolutePos == absolutePos) {
-        delete controlMsg;
         return;
     }
     lastAbsolutePos = absolutePos;
 
+    ControlMsg *controlMsg = createTouchMsg(id, pos, action);
+    if (!controlMsg) {
+        return;
+    }
+    // 立即发送的也经过输入计时线程，不会越过之前排队的消息
+    scheduleControlMsg(controlMsg, deadlineNs > 0 ? deadlineNs : InputScheduler::nowNs(), gesture);
+}
+
+ControlMsg *InputConvertGame::createTouchMsg(int id, QPointF pos, AndroidMotioneventAction action)
+{
+    ControlMsg *controlMsg = new ControlMsg(ControlMsg::CMT_INJECT_TOUCH);
+    if (!controlMsg) {
+        return Q_NULLPTR;
+    }
     controlMsg->setInjectTouchMsgData(
         static_cast<quint64>(id),
         action,
         static_cast<AndroidMotioneventButtons>(0),
         static_cast<AndroidMotioneventButtons>(0),
-        QRect(absolutePos, m_frameSize),
+        QRect(calcFrameAbsolutePos(pos).toPoint(), m_frameSize),
         AMOTION_EVENT_ACTION_DOWN == action ? 1.0f : 0.0f);
-    sendControlMsg(controlMsg);
+    return controlMsg;
 }
 
 void InputConvertGame::sendKeyEvent(AndroidKeyeventAction action, AndroidKeycode keyCode) {
@@ -211,6 +212,7 @@ void InputConvertGame::sendKeyEvent(AndroidKeyeventAction action, AndroidKeycode
     }
 
     controlMsg->setInjectKeycodeMsgData(action, keyCode, 0, AMETA_NONE);
+    // 和触摸进入同一个输入Lane，不会越过之前提交的已到期触摸
     sendControlMsg(controlMsg);
 }
 
@@ -232,6 +234,7 @@ QPointF InputConvertGame::calcScreenAbsolutePos(QPointF relativePos)
 
 int InputConvertGame::attachTouchID(int key)
 {
+    releaseHeldTouchIDs();
     for (int i = 0; i < MULTI_TOUCH_MAX_NUM; i++) {
         if (0 == m_multiTouchID[i]) {
             m_multiTouchID[i] = key;
@@ -241,11 +244,17 @@ int InputConvertGame::attachTouchID(int key)
     return -1;
 }
 
-void InputConvertGame::detachTouchID(int key)
+void InputConvertGame::detachTouchID(int key, qint64 untilNs)
 {
     for (int i = 0; i < MULTI_TOUCH_MAX_NUM; i++) {
         if (key == m_multiTouchID[i]) {
-            m_multiTouchID[i] = 0;
+            if (untilNs > InputScheduler::nowNs()) {
+                // 抬起之前不能分配给其他按键，也不再属于这个按键
+                m_multiTouchID[i] = MULTI_TOUCH_HELD_ID;
+                m_heldTouchIDs.append(qMakePair(i, untilNs));
+            } else {
+                m_multiTouchID[i] = 0;
+            }
             return;
         }
     }
@@ -261,6 +270,17 @@ int InputConvertGame::getTouchID(int key)
     return -1;
 }
 
+void InputConvertGame::releaseHeldTouchIDs()
+{
+    const qint64 now = InputScheduler::nowNs();
+    for (int i = m_heldTouchIDs.size() - 1; i >= 0; --i) {
+        if (m_heldTouchIDs[i].second <= now) {
+            m_multiTouchID[m_heldTouchIDs[i].first] = 0;
+            m_heldTouchIDs.removeAt(i);
+        }
+    }
+}
+
 // -------- steer wheel event --------
 
 void InputConvertGame::getDelayQueue(const QPointF& start, const QPointF& end,
@@ -293,23 +313,30 @@ void InputConvertGame::getDelayQueue(const QPointF& start, const QPointF& end,
     queueTimer = queue2;
 }
 
-void InputConvertGame::onSteerWheelTimer() {
-    if(m_ctrlSteerWheel.delayData.queuePos.empty()) {
-        return;
-    }
-    int id = getTouchID(m_ctrlSteerWheel.touchKey);
-    m_ctrlSteerWheel.delayData.currentPos = m_ctrlSteerWheel.delayData.queuePos.dequeue();
-    sendTouchMoveEvent(id, m_ctrlSteerWheel.delayData.currentPos);
-
-    if(m_ctrlSteerWheel.delayData.queuePos.empty() && m_ctrlSteerWheel.delayData.pressedNum == 0) {
-        sendTouchUpEvent(id, m_ctrlSteerWheel.delayData.currentPos);
-        detachTouchID(m_ctrlSteerWheel.touchKey);
-        return;
+void InputConvertGame::scheduleTouchMoves(int id, quint64 gesture, const QPointF &startPos, qint64 startNs,
+                                          const QQueue<QPointF> &queuePos, const QQueue<quint32> &queueTimer, DelayPlan &plan)
+{
+    plan = DelayPlan();
+    plan.startPos = startPos;
+    qint64 deadline = startNs;
+    for (int i = 0; i < queuePos.size(); ++i) {
+        if (i > 0) {
+            deadline += MS_TO_NS(queueTimer[i - 1]);
+        }
+        plan.deadlines.append(deadline);
+        plan.positions.append(queuePos[i]);
+        sendTouchMoveEvent(id, queuePos[i], deadline, gesture);
     }
+    plan.endNs = deadline;
+}
 
-    if(!m_ctrlSteerWheel.delayData.queuePos.empty()) {
-        m_ctrlSteerWheel.delayData.timer->start(m_ctrlSteerWheel.delayData.queueTimer.dequeue());
+QPointF InputConvertGame::planPos(const DelayPlan &plan, qint64 nowNs) const
+{
+    QPointF pos = plan.startPos;
+    for (int i = 0; i < plan.deadlines.size() && plan.deadlines[i] <= nowNs; ++i) {
+        pos = plan.positions[i];
     }
+    return pos;
 }
 
 void InputConvertGame::processSteerWheel(const KeyMap::KeyMapNode &node, const QKeyEvent *from)
@@ -348,42 +375,36 @@ void InputConvertGame::processSteerWheel(const KeyMap::KeyMapNode &node, const Q
     }
     m_ctrlSteerWheel.delayData.pressedNum = pressedNum;
 
-    // last key release and timer no active, active timer to detouch
-    if (pressedNum == 0) {
-        if (m_ctrlSteerWheel.delayData.timer->isActive()) {
-            m_ctrlSteerWheel.delayData.timer->stop();
-            m_ctrlSteerWheel.delayData.queueTimer.clear();
-            m_ctrlSteerWheel.delayData.queuePos.clear();
-        }
+    // stop the pending moves, continue from the last position actually sent
+    const qint64 cancelNs = cancelScheduled(SG_STEER_WHEEL);
+    if (!m_ctrlSteerWheel.delayData.plan.deadlines.isEmpty()) {
+        m_ctrlSteerWheel.delayData.currentPos = planPos(m_ctrlSteerWheel.delayData.plan, cancelNs);
+    }
+    m_ctrlSteerWheel.delayData.plan = DelayPlan();
 
+    // last key release, detouch
+    if (pressedNum == 0) {
         sendTouchUpEvent(getTouchID(m_ctrlSteerWheel.touchKey), m_ctrlSteerWheel.delayData.currentPos);
         detachTouchID(m_ctrlSteerWheel.touchKey);
         return;
     }
 
-    // process steer wheel key event
-    m_ctrlSteerWheel.delayData.timer->stop();
-    m_ctrlSteerWheel.delayData.queueTimer.clear();
-    m_ctrlSteerWheel.delayData.queuePos.clear();
-
+    QQueue<QPointF> queuePos;
+    QQueue<quint32> queueTimer;
+    QPointF startPos = m_ctrlSteerWheel.delayData.currentPos;
     // first press, get key and touch down
     if (pressedNum == 1 && flag) {
         m_ctrlSteerWheel.touchKey = from->key();
         int id = attachTouchID(m_ctrlSteerWheel.touchKey);
         sendTouchDownEvent(id, node.data.steerWheel.centerPos);
-
-        getDelayQueue(node.data.steerWheel.centerPos, node.data.steerWheel.centerPos+offset,
-                      0.01f, 0.002f, 2, 8,
-                      m_ctrlSteerWheel.delayData.queuePos,
-                      m_ctrlSteerWheel.delayData.queueTimer);
-    } else {
-        getDelayQueue(m_ctrlSteerWheel.delayData.currentPos, node.data.steerWheel.centerPos+offset,
-                      0.01f, 0.002f, 2, 8,
-                      m_ctrlSteerWheel.delayData.queuePos,
-                      m_ctrlSteerWheel.delayData.queueTimer);
+        startPos = node.data.steerWheel.centerPos;
     }
-    m_ctrlSteerWheel.delayData.timer->start();
-    return;
+    getDelayQueue(startPos, node.data.steerWheel.centerPos+offset,
+                  0.01f, 0.002f, 2, 8,
+                  queuePos, queueTimer);
+    // 第一个位置立即发送（在按下之后）
+    scheduleTouchMoves(getTouchID(m_ctrlSteerWheel.touchKey), SG_STEER_WHEEL, startPos, InputScheduler::nowNs(),
+                       queuePos, queueTimer, m_ctrlSteerWheel.delayData.plan);
 }
 
 // -------- key event --------
@@ -419,82 +440,48 @@ void InputConvertGame::processKeyClickMulti(const KeyMap::DelayClickNode *nodes,
     }
 
     int key = from->key();
-    int delay = 0;
-    QPointF clickPos;
+    // 所有点击共用一个触摸点，最后一次抬起之后才释放
+    int id = attachTouchID(key);
+    const qint64 startNs = InputScheduler::nowNs();
+    qint64 delay = 0;
 
     for (int i = 0; i < count; i++) {
         delay += nodes[i].delay;
-        clickPos = nodes[i].pos;
-        QTimer::singleShot(delay, this, [this, key, clickPos]() {
-            int id = attachTouchID(key);
-            sendTouchDownEvent(id, clickPos);
-        });
+        sendTouchDownEvent(id, nodes[i].pos, startNs + MS_TO_NS(delay));
 
         // Don't up it too fast
         delay += 20;
-        QTimer::singleShot(delay, this, [this, key, clickPos]() {
-            int id = getTouchID(key);
-            sendTouchUpEvent(id, clickPos);
-            detachTouchID(key);
-        });
-    }
-}
-
-void InputConvertGame::onDragTimer() {
-    if(m_dragDelayData.queuePos.empty()) {
-        return;
-    }
-    int id = getTouchID(m_dragDelayData.pressKey);
-    m_dragDelayData.currentPos = m_dragDelayData.queuePos.dequeue();
-    sendTouchMoveEvent(id, m_dragDelayData.currentPos);
-
-    if(m_dragDelayData.queuePos.empty()) {
-        delete m_dragDelayData.timer;
-        m_dragDelayData.timer = nullptr;
-
-        sendTouchUpEvent(id, m_dragDelayData.currentPos);
-        detachTouchID(m_dragDelayData.pressKey);
-
-        m_dragDelayData.currentPos = QPointF();
-        m_dragDelayData.pressKey = 0;
-        return;
-    }
-
-    if(!m_dragDelayData.queuePos.empty()) {
-        m_dragDelayData.timer->start(m_dragDelayData.queueTimer.dequeue());
+        sendTouchUpEvent(id, nodes[i].pos, startNs + MS_TO_NS(delay));
     }
+    detachTouchID(key, startNs + MS_TO_NS(delay));
 }
 
 void InputConvertGame::processKeyDrag(const QPointF &startPos, QPointF endPos, quint32 startDelay, float dragSpeed, const QKeyEvent *from)
 {
     if (QEvent::KeyPress == from->type()) {
         // stop last
-        if (m_dragDelayData.timer && m_dragDelayData.timer->isActive()) {
-            m_dragDelayData.timer->stop();
-            delete m_dragDelayData.timer;
-            m_dragDelayData.timer = nullptr;
-            m_dragDelayData.queuePos.clear();
-            m_dragDelayData.queueTimer.clear();
-
-            sendTouchUpEvent(getTouchID(m_dragDelayData.pressKey), m_dragDelayData.currentPos);
-            detachTouchID(m_dragDelayData.pressKey);
-
-            m_dragDelayData.currentPos = QPointF();
+        if (m_dragDelayData.id >= 0) {
+            const qint64 cancelNs = cancelScheduled(SG_DRAG);
+            if (cancelNs < m_dragDelayData.plan.endNs) {
+                // 还没抬起
+                sendTouchUpEvent(m_dragDelayData.id, planPos(m_dragDelayData.plan, cancelNs));
+                for (int i = 0; i < m_heldTouchIDs.size(); ++i) {
+                    if (m_heldTouchIDs[i].first == m_dragDelayData.id) {
+                        m_heldTouchIDs.removeAt(i);
+                        break;
+                    }
+                }
+                m_multiTouchID[m_dragDelayData.id] = 0;
+            }
+            m_dragDelayData.plan = DelayPlan();
             m_dragDelayData.pressKey = 0;
+            m_dragDelayData.id = -1;
         }
 
         // start this
         int id = attachTouchID(from->key());
         sendTouchDownEvent(id, startPos);
 
-        m_dragDelayData.timer = new QTimer(this);
-        m_dragDelayData.timer->setSingleShot(true);
-        connect(m_dragDelayData.timer, &QTimer::timeout, this, &InputConvertGame::onDragTimer);
-        m_dragDelayData.pressKey = from->key();
-        m_dragDelayData.currentPos = startPos;
-        m_dragDelayData.queuePos.clear();
-        m_dragDelayData.queueTimer.clear();
-
         // Clamp dragSpeed to 0-1 range
         const float speed = qBound(0.0f, static_cast<float>(dragSpeed), 1.0f);
         
@@ -504,14 +491,22 @@ void InputConvertGame::processKeyDrag(const QPointF &startPos, QPointF endPos, q
         const quint32 minDelay = static_cast<quint32>(1 + (1.0f - speed) * 29);  // 1 to 30
         const quint32 maxDelay = minDelay + static_cast<quint32>((1.0f - speed) * 9) + 1;  // // min + (0 to 9) + 1
 
+        QQueue<QPointF> queuePos;
+        QQueue<quint32> queueTimer;
         getDelayQueue(startPos, endPos,
                       0.01f, 0.0005f,
                       minDelay,
                       maxDelay,
-                      m_dragDelayData.queuePos,
-                      m_dragDelayData.queueTimer);
-
-        m_dragDelayData.timer->start(startDelay);
+                      queuePos,
+                      queueTimer);
+
+        scheduleTouchMoves(id, SG_DRAG, startPos, InputScheduler::nowNs() + MS_TO_NS(startDelay),
+                           queuePos, queueTimer, m_dragDelayData.plan);
+        // 最后一个位置发出后抬起
+        sendTouchUpEvent(id, queuePos.isEmpty() ? startPos : queuePos.last(), m_dragDelayData.plan.endNs, SG_DRAG);
+        detachTouchID(from->key(), m_dragDelayData.plan.endNs);
+        m_dragDelayData.pressKey = from->key();
+        m_dragDelayData.id = id;
     }
 }
 
@@ -582,7 +577,7 @@ bool InputConvertGame::processMouseMove(const QMouseEvent *from)
         return true;
     }
 
-    if (!lastPos.isNull() && m_processMouseMove) {
+    if (!lastPos.isNull() && InputScheduler::nowNs() >= m_mouseMoveResumeNs) {
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
         QPointF distance_raw{from->localPos() - lastPos};
 #else
@@ -592,7 +587,6 @@ bool InputConvertGame::processMouseMove(const QMouseEvent *from)
         QPointF distance    {distance_raw.x() / speedRatio.x(), distance_raw.y() / speedRatio.y()};
 
         mouseMoveStartTouch(from);
-        startMouseMoveTimer();
 
         m_ctrlMouseMove.lastConverPos.setX(m_ctrlMouseMove.lastConverPos.x() + distance.x() / m_showSize.width());
         m_ctrlMouseMove.lastConverPos.setY(m_ctrlMouseMove.lastConverPos.y() + distance.y() / m_showSize.height());
@@ -600,13 +594,11 @@ bool InputConvertGame::processMouseMove(const QMouseEvent *from)
         if (m_ctrlMouseMove.lastConverPos.x() < 0.05 || m_ctrlMouseMove.lastConverPos.x() > 0.95 || m_ctrlMouseMove.lastConverPos.y() < 0.05
             || m_ctrlMouseMove.lastConverPos.y() > 0.95) {
             if (m_ctrlMouseMove.smallEyes) {
-                m_processMouseMove = false;
-                int delay = 30;
-                QTimer::singleShot(delay, this, [this]() { mouseMoveStopTouch(); });
-                QTimer::singleShot(delay * 2, this, [this]() {
-                    mouseMoveStartTouch(nullptr);
-                    m_processMouseMove = true;
-                });
+                // 这次移动还属于当前的触摸
+                sendTouchMoveEvent(getTouchID(Qt::ExtraButton24), m_ctrlMouseMove.lastConverPos);
+                restartMouseMoveTouch(SMALL_EYES_DELAY_NS);
+                armMouseMoveIdle();
+                return true;
             } else {
                 mouseMoveStopTouch();
                 m_ctrlMouseMove.ignoreCount = 5;
@@ -615,6 +607,7 @@ bool InputConvertGame::processMouseMove(const QMouseEvent *from)
         }
 
         sendTouchMoveEvent(getTouchID(Qt::ExtraButton24), m_ctrlMouseMove.lastConverPos);
+        armMouseMoveIdle();
     }
 
     return true;
@@ -659,40 +652,93 @@ void InputConvertGame::moveCursorTo(const QMouseEvent *from, const QPoint &local
     QCursor::setPos(globalPos);
 }
 
-void InputConvertGame::mouseMoveStartTouch(const QMouseEvent *from)
+void InputConvertGame::mouseMoveStartTouch(const QMouseEvent *from, qint64 deadlineNs)
 {
     Q_UNUSED(from)
-    if (!m_ctrlMouseMove.touching) {
+    if (!mouseMoveTouching()) {
+        if (deadlineNs <= 0) {
+            deadlineNs = qMax(InputScheduler::nowNs(), m_mouseMoveResumeNs);
+        }
         QPointF mouseMoveStartPos
             = m_ctrlMouseMove.smallEyes ? m_keyMap.getMouseMoveMap().data.mouseMove.smallEyes.pos : m_keyMap.getMouseMoveMap().data.mouseMove.startPos;
         int id = attachTouchID(Qt::ExtraButton24);
-        sendTouchDownEvent(id, mouseMoveStartPos);
+        sendTouchDownEvent(id, mouseMoveStartPos, deadlineNs);
         m_ctrlMouseMove.lastConverPos = mouseMoveStartPos;
         m_ctrlMouseMove.touching = true;
     }
 }
 
-void InputConvertGame::mouseMoveStopTouch()
+void InputConvertGame::mouseMoveStopTouch(qint64 deadlineNs)
 {
+    cancelMouseMoveIdle();
     if (m_ctrlMouseMove.touching) {
-        sendTouchUpEvent(getTouchID(Qt::ExtraButton24), m_ctrlMouseMove.lastConverPos);
+        if (deadlineNs <= 0) {
+            deadlineNs = qMax(InputScheduler::nowNs(), m_mouseMoveResumeNs);
+        }
+        sendTouchUpEvent(getTouchID(Qt::ExtraButton24), m_ctrlMouseMove.lastConverPos, deadlineNs);
+        detachTouchID(Qt::ExtraButton24, deadlineNs);
+        m_ctrlMouseMove.touching = false;
+    }
+}
+
+void InputConvertGame::restartMouseMoveTouch(qint64 delayNs)
+{
+    // 排在还未发出的重新按下之后
+    const qint64 startNs = qMax(InputScheduler::nowNs(), m_mouseMoveResumeNs);
+    mouseMoveStopTouch(startNs + delayNs);
+    mouseMoveStartTouch(nullptr, startNs + delayNs * 2);
+    m_mouseMoveResumeNs = startNs + delayNs * 2;
+}
+
+bool InputConvertGame::mouseMoveTouching()
+{
+    if (m_ctrlMouseMove.touching && m_ctrlMouseMove.idleDeadlineNs && InputScheduler::nowNs() >= m_ctrlMouseMove.idleDeadlineNs) {
+        // 空闲抬起已经到期，一定会发出；结束这一批，下一个空闲抬起不会被它影响
+        cancelScheduled(SG_MOUSE_MOVE_IDLE);
         detachTouchID(Qt::ExtraButton24);
         m_ctrlMouseMove.touching = false;
+        m_ctrlMouseMove.idleDeadlineNs = 0;
     }
+    return m_ctrlMouseMove.touching;
 }
 
-void InputConvertGame::startMouseMoveTimer()
+void InputConvertGame::armMouseMoveIdle()
 {
-    stopMouseMoveTimer();
-    m_ctrlMouseMove.timer = startTimer(500);
+    const qint64 idleDeadlineNs = qMax(InputScheduler::nowNs(), m_mouseMoveResumeNs) + MOUSE_MOVE_IDLE_NS;
+    if (m_ctrlMouseMove.idleDeadlineNs) {
+        // 只保留一个空闲抬起，推迟它并更新抬起位置，不用每次移动都取消再提交
+        ControlMsg *upMsg = createTouchMsg(getTouchID(Qt::ExtraButton24), m_ctrlMouseMove.lastConverPos, AMOTION_EVENT_ACTION_UP);
+        if (deferScheduled(SG_MOUSE_MOVE_IDLE, idleDeadlineNs, upMsg)) {
+            m_ctrlMouseMove.idleDeadlineNs = idleDeadlineNs;
+            return;
+        }
+        // 空闲抬起已经发出，结束这一批
+        cancelScheduled(SG_MOUSE_MOVE_IDLE);
+        if (m_ctrlMouseMove.touching) {
+            detachTouchID(Qt::ExtraButton24);
+            m_ctrlMouseMove.touching = false;
+        }
+        m_ctrlMouseMove.idleDeadlineNs = 0;
+    }
+    if (!m_ctrlMouseMove.touching) {
+        return;
+    }
+    m_ctrlMouseMove.idleDeadlineNs = idleDeadlineNs;
+    sendTouchUpEvent(getTouchID(Qt::ExtraButton24), m_ctrlMouseMove.lastConverPos, m_ctrlMouseMove.idleDeadlineNs, SG_MOUSE_MOVE_IDLE);
 }
 
-void InputConvertGame::stopMouseMoveTimer()
+void InputConvertGame::cancelMouseMoveIdle()
 {
-    if (0 != m_ctrlMouseMove.timer) {
-        killTimer(m_ctrlMouseMove.timer);
-        m_ctrlMouseMove.timer = 0;
+    if (!m_ctrlMouseMove.idleDeadlineNs) {
+        return;
+    }
+    const qint64 cancelNs = cancelScheduled(SG_MOUSE_MOVE_IDLE);
+    if (m_ctrlMouseMove.touching && cancelNs >= m_ctrlMouseMove.idleDeadlineNs) {
+        // 取消之前已经到期，空闲抬起照常发出
+        detachTouchID(Qt::ExtraButton24);
+        m_ctrlMouseMove.touching = false;
     }
+    m_ctrlMouseMove.idleDeadlineNs = 0;
 }
 
 bool InputConvertGame::switchGameMap()
@@ -710,7 +756,6 @@ bool InputConvertGame::switchGameMap()
     hideMouseCursor(m_gameMap);
 
     if (!m_gameMap) {
-        stopMouseMoveTimer();
         mouseMoveStopTouch();
     }
 
@@ -729,11 +774,3 @@ void InputConvertGame::hideMouseCursor(bool hide)
         QGuiApplication::restoreOverrideCursor();
     }
 }
-
-void InputConvertGame::timerEvent(QTimerEvent *event)
-{
-    if (m_ctrlMouseMove.timer == event->timerId()) {
-        stopMouseMoveTimer();
-        mouseMoveStopTouch();
-    }
-}
@@ -3,11 +3,14 @@
 
 #include <QPointF>
 #include <QQueue>
+#include <QVector>
 
 #include "inputconvertnormal.h"
 #include "keymap.h"
 
 #define MULTI_TOUCH_MAX_NUM 10
+// 触摸点已释放，但抬起消息还在输入计时线程中排队
+#define MULTI_TOUCH_HELD_ID -1
 class InputConvertGame : public InputConvertNormal
 {
     Q_OBJECT
@@ -23,19 +26,43 @@ public:
     void loadKeyMap(const QString &json);
 
 protected:
+    // 输入计时线程中可以一起取消的消息
+    enum ScheduleGesture
+    {
+        SG_NONE = 0,
+        SG_STEER_WHEEL,
+        SG_DRAG,
+        // 鼠标停止移动后抬起视角控制的触摸
+        SG_MOUSE_MOVE_IDLE,
+    };
+
+    // 已排队的插值轨迹，取消后据此得到设备已经收到的位置
+    struct DelayPlan
+    {
+        QPointF startPos;
+        QVector<qint64> deadlines;
+        QVector<QPointF> positions;
+        // 最后一条消息的截止时间
+        qint64 endNs = 0;
+    };
+
     void updateSize(const QSize &frameSize, const QSize &showSize);
-    void sendTouchDownEvent(int id, QPointF pos);
-    void sendTouchMoveEvent(int id, QPointF pos);
-    void sendTouchUpEvent(int id, QPointF pos);
-    void sendTouchEvent(int id, QPointF pos, AndroidMotioneventAction action);
+    // 触摸消息都交给输入计时线程发送，deadlineNs为0表示立即发送
+    void sendTouchDownEvent(int id, QPointF pos, qint64 deadlineNs = 0, quint64 gesture = SG_NONE);
+    void sendTouchMoveEvent(int id, QPointF pos, qint64 deadlineNs = 0, quint64 gesture = SG_NONE);
+    void sendTouchUpEvent(int id, QPointF pos, qint64 deadlineNs = 0, quint64 gesture = SG_NONE);
+    void sendTouchEvent(int id, QPointF pos, AndroidMotioneventAction action, qint64 deadlineNs, quint64 gesture);
+    ControlMsg *createTouchMsg(int id, QPointF pos, AndroidMotioneventAction action);
     void sendKeyEvent(AndroidKeyeventAction action, AndroidKeycode keyCode);
     QPointF calcFrameAbsolutePos(QPointF relativePos);
     QPointF calcScreenAbsolutePos(QPointF relativePos);
 
     // multi touch id
     int attachTouchID(int key);
-    void detachTouchID(int key);
+    // untilNs之后才能重新分配（抬起消息的截止时间）
+    void detachTouchID(int key, qint64 untilNs = 0);
     int getTouchID(int key);
+    void releaseHeldTouchIDs();
 
     // steer wheel
     void processSteerWheel(const KeyMap::KeyMapNode &node, const QKeyEvent *from);
@@ -56,10 +83,14 @@ protected:
     bool processMouseClick(const QMouseEvent *from);
     bool processMouseMove(const QMouseEvent *from);
     void moveCursorTo(const QMouseEvent *from, const QPoint &localPosPixel);
-    void mouseMoveStartTouch(const QMouseEvent *from);
-    void mouseMoveStopTouch();
-    void startMouseMoveTimer();
-    void stopMouseMoveTimer();
+    // deadlineNs为0时排在还未发出的重新按下之后
+    void mouseMoveStartTouch(const QMouseEvent *from, qint64 deadlineNs = 0);
+    void mouseMoveStopTouch(qint64 deadlineNs = 0);
+    // delayNs后抬起，再过delayNs在起始位置重新按下，期间不处理鼠标移动
+    void restartMouseMoveTouch(qint64 delayNs);
+    bool mouseMoveTouching();
+    void armMouseMoveIdle();
+    void cancelMouseMoveIdle();
 
     bool switchGameMap();
     bool checkCursorPos(const QMouseEvent *from);
@@ -69,13 +100,10 @@ protected:
                        const double& distanceStep, const double& posStepconst,
                        quint32 lowestTimer, quint32 highestTimer,
                        QQueue<QPointF>& queuePos, QQueue<quint32>& queueTimer);
-
-protected:
-    void timerEvent(QTimerEvent *event);
-
-private slots:
-    void onSteerWheelTimer();
-    void onDragTimer();
+    // 第一个位置在startNs发送，之后按queueTimer(ms)的间隔
+    void scheduleTouchMoves(int id, quint64 gesture, const QPointF &startPos, qint64 startNs,
+                            const QQueue<QPointF> &queuePos, const QQueue<quint32> &queueTimer, DelayPlan &plan);
+    QPointF planPos(const DelayPlan &plan, qint64 nowNs) const;
 
 private:
     QSize m_frameSize;
@@ -83,9 +111,12 @@ private:
     bool m_gameMap = false;
     bool m_needBackMouseMove = false;
     int m_multiTouchID[MULTI_TOUCH_MAX_NUM] = { 0 };
+    // MULTI_TOUCH_HELD_ID的触摸点和可以重新分配的时刻
+    QVector<QPair<int, qint64>> m_heldTouchIDs;
     KeyMap m_keyMap;
 
-    bool m_processMouseMove = true;
+    // 视角控制重新按下之前不处理鼠标移动
+    qint64 m_mouseMoveResumeNs = 0;
 
     // steer wheel
     struct
@@ -100,9 +131,7 @@ private:
         // for delay
         struct {
             QPointF currentPos;
-            QTimer* timer = nullptr;
-            QQueue<QPointF> queuePos;
-            QQueue<quint32> queueTimer;
+            DelayPlan plan;
             int pressedNum = 0;
         } delayData;
     } m_ctrlSteerWheel;
@@ -113,18 +142,18 @@ private:
         QPointF lastConverPos;
         QPointF lastPos = { 0.0, 0.0 };
         bool touching = false;
-        int timer = 0;
+        // 空闲抬起的截止时间，0表示没有
+        qint64 idleDeadlineNs = 0;
         bool smallEyes = false;
         int ignoreCount = 0;
     } m_ctrlMouseMove;
 
     // for drag delay
     struct {
-        QPointF currentPos;
-        QTimer* timer = nullptr;
-        QQueue<QPointF> queuePos;
-        QQueue<quint32> queueTimer;
+        DelayPlan plan;
         int pressKey = 0;
+        // 拖动占用的触摸点，抬起之前为MULTI_TOUCH_HELD_ID
+        int id = -1;
     } m_dragDelayData;
 };
 
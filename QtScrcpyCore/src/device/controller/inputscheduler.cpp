@@ -0,0 +1,369 @@
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QHash>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include "inputscheduler.h"
+#include "latencytracker.h"
+
+// 时间轮每格1ms，一圈256ms
+#define INPUT_WHEEL_TICK_NS 1000000
+#define INPUT_WHEEL_SLOTS 256
+// 唤醒延迟通常在几十到几百微秒，最后一段自旋等待
+#define INPUT_SPIN_NS 200000
+
+class InputScheduler::Lane
+{
+public:
+    QMutex mutex;
+    SendFunc sendFunc;
+    bool closed = false;
+    // 每个gesture当前这一批任务，取消后换成新的
+    QHash<quint64, std::shared_ptr<InputScheduler::Batch>> batches;
+
+    quint64 scheduled = 0;
+    quint64 sent = 0;
+    quint64 cancelled = 0;
+    LatencyTracker::Histogram jitter;
+};
+
+namespace {
+
+class InputTimingThread : public QThread
+{
+public:
+    explicit InputTimingThread(std::function<void()> loop) : m_loop(loop) {}
+
+protected:
+    void run() override { m_loop(); }
+
+private:
+    std::function<void()> m_loop;
+};
+
+}
+
+InputScheduler &InputScheduler::instance()
+{
+    static InputScheduler scheduler;
+    return scheduler;
+}
+
+qint64 InputScheduler::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+InputScheduler::InputScheduler()
+{
+    m_wheel.resize(INPUT_WHEEL_SLOTS);
+}
+
+InputScheduler::~InputScheduler()
+{
+    stop();
+}
+
+std::shared_ptr<InputScheduler::Lane> InputScheduler::createLane(SendFunc sendFunc)
+{
+    std::shared_ptr<Lane> lane(new Lane);
+    lane->sendFunc = sendFunc;
+    return lane;
+}
+
+void InputScheduler::closeLane(const std::shared_ptr<Lane> &lane)
+{
+    if (!lane) {
+        return;
+    }
+    // 正在发送时等待其结束
+    QMutexLocker locker(&lane->mutex);
+    lane->closed = true;
+    lane->sendFunc = nullptr;
+}
+
+void InputScheduler::schedule(const std::shared_ptr<Lane> &lane, qint64 deadlineNs, quint64 gesture, const QByteArray &buffer)
+{
+    if (!lane || buffer.isEmpty()) {
+        return;
+    }
+
+    Task task;
+    task.deadlineNs = deadlineNs;
+    task.lane = lane;
+    task.buffer = buffer;
+    {
+        QMutexLocker locker(&lane->mutex);
+        if (lane->closed) {
+            return;
+        }
+        if (gesture) {
+            std::shared_ptr<Batch> &batch = lane->batches[gesture];
+            if (!batch) {
+                batch = std::make_shared<Batch>();
+                batch->cancelNs = std::numeric_limits<qint64>::max();
+            }
+            task.batch = batch;
+        }
+        lane->scheduled++;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    startThread();
+    task.seq = m_seq++;
+    insert(task);
+    if (deadlineNs < m_waitUntilNs) {
+        m_cond.wakeOne();
+    }
+}
+
+qint64 InputScheduler::cancel(const std::shared_ptr<Lane> &lane, quint64 gesture)
+{
+    if (!lane || !gesture) {
+        return nowNs();
+    }
+    // 与fire互斥，取消时刻之前到期的任务即使还没发出也会照常发出
+    QMutexLocker locker(&lane->mutex);
+    const qint64 now = nowNs();
+    auto it = lane->batches.find(gesture);
+    if (it != lane->batches.end() && it.value()) {
+        it.value()->cancelNs = now;
+        it.value().reset();
+    }
+    return now;
+}
+
+bool InputScheduler::defer(const std::shared_ptr<Lane> &lane, quint64 gesture, qint64 notBeforeNs, const QByteArray &buffer)
+{
+    if (!lane || !gesture) {
+        return false;
+    }
+    // 与fire互斥，返回true时这一批还没有任务发出，之后也不会早于notBeforeNs发出
+    QMutexLocker locker(&lane->mutex);
+    auto it = lane->batches.find(gesture);
+    if (lane->closed || it == lane->batches.end() || !it.value() || it.value()->fired) {
+        return false;
+    }
+    it.value()->notBeforeNs = qMax(it.value()->notBeforeNs, notBeforeNs);
+    if (!buffer.isEmpty()) {
+        it.value()->buffer = buffer;
+    }
+    return true;
+}
+
+qsc::InputTimingStats InputScheduler::stats(const std::shared_ptr<Lane> &lane)
+{
+    qsc::InputTimingStats stats;
+    if (!lane) {
+        return stats;
+    }
+    QMutexLocker locker(&lane->mutex);
+    stats.scheduled = lane->scheduled;
+    stats.sent = lane->sent;
+    stats.cancelled = lane->cancelled;
+    stats.jitter = lane->jitter.percentiles();
+    return stats;
+}
+
+void InputScheduler::stop()
+{
+    QThread *thread = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        thread = m_thread;
+        m_thread = nullptr;
+        m_cond.wakeAll();
+    }
+    if (thread) {
+        thread->wait();
+        delete thread;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    for (auto &slot : m_wheel) {
+        slot.clear();
+    }
+    m_count = 0;
+}
+
+void InputScheduler::startThread()
+{
+    // called with m_mutex locked
+    if (m_thread) {
+        return;
+    }
+    m_quit = false;
+    m_currentTick = nowNs() / INPUT_WHEEL_TICK_NS;
+    m_waitUntilNs = std::numeric_limits<qint64>::max();
+    m_thread = new InputTimingThread([this]() {
+        timerLoop();
+    });
+    m_thread->setObjectName("InputTiming");
+    m_thread->start(QThread::TimeCriticalPriority);
+}
+
+void InputScheduler::timerLoop()
+{
+    std::vector<Task> due;
+    QMutexLocker locker(&m_mutex);
+    while (!m_quit) {
+        collectDue(nowNs(), due);
+        if (!due.empty()) {
+            locker.unlock();
+            std::sort(due.begin(), due.end(), [](const Task &a, const Task &b) {
+                return a.deadlineNs != b.deadlineNs ? a.deadlineNs < b.deadlineNs : a.seq < b.seq;
+            });
+            for (Task &task : due) {
+                fire(task);
+            }
+            // 在锁外释放Lane和消息
+            due.clear();
+            locker.relock();
+            continue;
+        }
+
+        const qint64 next = nextDeadline();
+        if (next < 0) {
+            m_waitUntilNs = std::numeric_limits<qint64>::max();
+            m_cond.wait(&m_mutex);
+            continue;
+        }
+
+        const qint64 remaining = next - nowNs();
+        if (remaining > INPUT_SPIN_NS) {
+            m_waitUntilNs = next;
+            QDeadlineTimer deadline(Qt::PreciseTimer);
+            deadline.setPreciseRemainingTime(0, remaining - INPUT_SPIN_NS, Qt::PreciseTimer);
+            m_cond.wait(&m_mutex, deadline);
+            continue;
+        }
+
+        // 期间提交的更早的任务最多晚INPUT_SPIN_NS
+        m_waitUntilNs = next;
+        locker.unlock();
+        while (nowNs() < next) {
+            QThread::yieldCurrentThread();
+        }
+        locker.relock();
+    }
+}
+
+void InputScheduler::insert(Task &task)
+{
+    // called with m_mutex locked
+    const qint64 nowTick = nowNs() / INPUT_WHEEL_TICK_NS;
+    if (0 == m_count && m_currentTick < nowTick) {
+        // 空闲时不用逐格转过去
+        m_currentTick = nowTick;
+    }
+    // 已经过期的任务放在当前格子
+    const qint64 tick = qMax(task.deadlineNs / INPUT_WHEEL_TICK_NS, m_currentTick);
+    task.rounds = (tick - m_currentTick) / INPUT_WHEEL_SLOTS;
+    m_wheel[static_cast<int>(tick % INPUT_WHEEL_SLOTS)].push_back(std::move(task));
+    m_count++;
+}
+
+void InputScheduler::collectDue(qint64 now, std::vector<Task> &due)
+{
+    // called with m_mutex locked
+    const qint64 nowTick = now / INPUT_WHEEL_TICK_NS;
+    // 已经过去的格子中本圈的任务全部到期
+    while (m_currentTick < nowTick && m_count > 0) {
+        std::vector<Task> &slot = m_wheel[static_cast<int>(m_currentTick % INPUT_WHEEL_SLOTS)];
+        size_t keep = 0;
+        for (size_t i = 0; i < slot.size(); ++i) {
+            if (slot[i].rounds > 0) {
+                slot[i].rounds--;
+                if (keep != i) {
+                    slot[keep] = std::move(slot[i]);
+                }
+                keep++;
+            } else {
+                due.push_back(std::move(slot[i]));
+                m_count--;
+            }
+        }
+        slot.resize(keep);
+        m_currentTick++;
+    }
+    if (0 == m_count) {
+        m_currentTick = nowTick;
+        return;
+    }
+
+    // 当前格子只取已经到期的
+    std::vector<Task> &slot = m_wheel[static_cast<int>(m_currentTick % INPUT_WHEEL_SLOTS)];
+    size_t keep = 0;
+    for (size_t i = 0; i < slot.size(); ++i) {
+        if (0 == slot[i].rounds && slot[i].deadlineNs <= now) {
+            due.push_back(std::move(slot[i]));
+            m_count--;
+        } else {
+            if (keep != i) {
+                slot[keep] = std::move(slot[i]);
+            }
+            keep++;
+        }
+    }
+    slot.resize(keep);
+}
+
+qint64 InputScheduler::nextDeadline()
+{
+    // called with m_mutex locked
+    if (0 == m_count) {
+        return -1;
+    }
+    // 第一个有本圈任务的格子里最早的截止时间
+    for (qint64 i = 0; i < INPUT_WHEEL_SLOTS; ++i) {
+        const std::vector<Task> &slot = m_wheel[static_cast<int>((m_currentTick + i) % INPUT_WHEEL_SLOTS)];
+        qint64 next = -1;
+        for (const Task &task : slot) {
+            if (0 == task.rounds && (next < 0 || task.deadlineNs < next)) {
+                next = task.deadlineNs;
+            }
+        }
+        if (next >= 0) {
+            return next;
+        }
+    }
+    // 只有下一圈之后的任务，转完这一圈再看
+    return (m_currentTick + INPUT_WHEEL_SLOTS) * INPUT_WHEEL_TICK_NS;
+}
+
+void InputScheduler::fire(Task &task)
+{
+    Lane *lane = task.lane.get();
+    QMutexLocker locker(&lane->mutex);
+    if (lane->closed) {
+        return;
+    }
+    if (task.batch && task.deadlineNs > task.batch->cancelNs) {
+        lane->cancelled++;
+        return;
+    }
+    if (task.batch && task.deadlineNs < task.batch->notBeforeNs) {
+        // 被推迟，按新的时刻放回时间轮，计时线程发送完这一轮后会重新计算等待时间
+        // 先取Lane锁再取m_mutex，其他地方不会持有m_mutex去取Lane锁
+        task.deadlineNs = task.batch->notBeforeNs;
+        QMutexLocker wheelLocker(&m_mutex);
+        insert(task);
+        return;
+    }
+
+    const qint64 sendNs = nowNs();
+    if (lane->sendFunc) {
+        lane->sendFunc(task.batch && !task.batch->buffer.isEmpty() ? task.batch->buffer : task.buffer);
+    }
+    if (task.batch) {
+        task.batch->fired = true;
+    }
+    lane->sent++;
+    lane->jitter.add((sendNs - task.deadlineNs) / 1000);
+}
@@ -0,0 +1,102 @@
+#ifndef INPUTSCHEDULER_H
+#define INPUTSCHEDULER_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "QtScrcpyCoreDef.h"
+
+class QThread;
+
+// 全局输入计时线程
+// 所有设备的定时/插值触摸消息（方向盘、拖动、连点、视角控制）都在这个线程中按时发送，不受GUI事件循环繁忙的影响：
+// - 时间轮（1ms一格，256格），截止时间为单调时钟的纳秒值，超出一圈的任务按圈数计数
+// - 粗略等待用条件变量，最后200us自旋，到期的任务按(截止时间, 提交顺序)发送
+// - 每个设备一个Lane，同一Lane的消息按截止时间和提交顺序发送，立即发送的消息也经过这里以保持顺序
+// - 同一Lane中gesture相同的任务可以一起取消：截止时间不晚于取消时刻的照常发送，之后的不再发送，
+//   调用方据此确定设备实际收到了哪些消息（任务到期时才移出时间轮）
+// - 也可以整体推迟：到期时发现被推迟的任务按新的时刻重新放回时间轮，不用每次取消再提交
+// 发送时记录实际发送时刻与截止时间的偏差（jitter）
+class InputScheduler
+{
+public:
+    typedef std::function<qint64(const QByteArray &buffer)> SendFunc;
+    class Lane;
+
+    static InputScheduler &instance();
+    // 单调时钟(ns)
+    static qint64 nowNs();
+
+    // sendFunc在输入计时线程中调用，必须线程安全
+    std::shared_ptr<Lane> createLane(SendFunc sendFunc);
+    // 返回后不会再调用该Lane的sendFunc
+    void closeLane(const std::shared_ptr<Lane> &lane);
+    // deadlineNs取自nowNs()，已过期的任务尽快发送；gesture为0的任务不能取消
+    void schedule(const std::shared_ptr<Lane> &lane, qint64 deadlineNs, quint64 gesture, const QByteArray &buffer);
+    // 返回取消时刻(ns)
+    qint64 cancel(const std::shared_ptr<Lane> &lane, quint64 gesture);
+    // 这一批中还未发送的任务不早于notBeforeNs发送，buffer非空时替换它们的消息（用于只有一个任务的批次）
+    // 没有未取消的这一批，或者其中已有任务发出时返回false，此时不推迟
+    bool defer(const std::shared_ptr<Lane> &lane, quint64 gesture, qint64 notBeforeNs, const QByteArray &buffer = QByteArray());
+    qsc::InputTimingStats stats(const std::shared_ptr<Lane> &lane);
+
+    // 退出并等待输入计时线程，未发送的任务被丢弃
+    void stop();
+
+private:
+    InputScheduler();
+    ~InputScheduler();
+    Q_DISABLE_COPY(InputScheduler)
+
+    // 同一gesture的一批任务，由Lane的mutex保护
+    struct Batch
+    {
+        // 被取消的时刻，未取消时为最大值
+        qint64 cancelNs = 0;
+        // 推迟到的时刻
+        qint64 notBeforeNs = 0;
+        // 替换的消息
+        QByteArray buffer;
+        // 已有任务发出
+        bool fired = false;
+    };
+
+    struct Task
+    {
+        qint64 deadlineNs = 0;
+        quint64 seq = 0;
+        std::shared_ptr<Batch> batch;
+        // 还要转过的圈数
+        qint64 rounds = 0;
+        std::shared_ptr<Lane> lane;
+        QByteArray buffer;
+    };
+
+    void startThread();
+    void timerLoop();
+    void insert(Task &task);
+    void collectDue(qint64 now, std::vector<Task> &due);
+    qint64 nextDeadline();
+    void fire(Task &task);
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    QVector<std::vector<Task>> m_wheel;
+    // 时间轮当前指向的格子（绝对tick）
+    qint64 m_currentTick = 0;
+    int m_count = 0;
+    quint64 m_seq = 0;
+    // 计时线程等待到的时刻，更早的任务需要唤醒它
+    qint64 m_waitUntilNs = 0;
+    QThread *m_thread = nullptr;
+    bool m_quit = false;
+};
+
+#endif // INPUTSCHEDULER_H
@@ -0,0 +1,67 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// 无锁多生产者单消费者队列（Vyukov侵入式链表）
+// push可以在任意线程调用，pop只能在一个消费者线程中调用
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+    {
+        Node *stub = new Node();
+        m_head.store(stub, std::memory_order_relaxed);
+        m_tail = stub;
+    }
+
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(value)) {
+        }
+        delete m_tail;
+    }
+
+    void push(T value)
+    {
+        Node *node = new Node();
+        node->value = std::move(value);
+        Node *prev = m_head.exchange(node, std::memory_order_acq_rel);
+        // 在这之前消费者看不到node，pop返回false，不会丢失
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(T &value)
+    {
+        Node *tail = m_tail;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = std::move(next->value);
+        next->value = T();
+        // next成为新的哨兵节点
+        m_tail = next;
+        delete tail;
+        return true;
+    }
+
+private:
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    struct Node
+    {
+        std::atomic<Node *> next{nullptr};
+        T value;
+    };
+
+    std::atomic<Node *> m_head;
+    // 只在消费者线程中访问
+    Node *m_tail = nullptr;
+};
+
+#endif // MPSCQUEUE_H
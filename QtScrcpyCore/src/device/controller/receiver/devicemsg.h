@@ -1,12 +1,15 @@
 #ifndef DEVICEMSG_H
 #define DEVICEMSG_H
 
-#include <QBuffer>
+#include <QByteArray>
+#include <QObject>
 
 #define DEVICE_MSG_MAX_SIZE (1 << 18) // 256k
 // type: 1 byte; length: 4 bytes
 #define DEVICE_MSG_TEXT_MAX_LENGTH (DEVICE_MSG_MAX_SIZE - 5)
 
+class DeviceMsgParser;
+
 class DeviceMsg : public QObject
 {
     Q_OBJECT
@@ -16,28 +19,34 @@ public:
         DMT_NULL = -1,
         // 和服务端对应
         DMT_GET_CLIPBOARD = 0,
+        DMT_ACK_CLIPBOARD = 1,
+        DMT_UHID_OUTPUT = 2,
     };
     explicit DeviceMsg(QObject *parent = nullptr);
     virtual ~DeviceMsg();
 
     DeviceMsg::DeviceMsgType type();
     void getClipboardMsgData(QString &text);
-
-    qint32 deserialize(QByteArray &byteArray);
+    // 剪贴板文本的原始UTF-8数据，不做转换
+    const QByteArray &getClipboardMsgUtf8();
+    // CMT_SET_CLIPBOARD中的sequence
+    quint64 getAckClipboardSequence();
+    // 发给HID设备的输出报告（例如键盘LED）
+    void getUhidOutputMsgData(quint16 &id, QByteArray &data);
 
 private:
+    // 由DeviceMsgParser边接收边填充
+    friend class DeviceMsgParser;
+
     struct DeviceMsgData
     {
         DeviceMsgType type = DMT_NULL;
-        union
-        {
-            struct
-            {
-                char *text = Q_NULLPTR;
-            } clipboardMsg;
-        };
-        DeviceMsgData() {}
-        ~DeviceMsgData() {}
+        // DMT_GET_CLIPBOARD: text; DMT_UHID_OUTPUT: data
+        QByteArray payload;
+        // DMT_ACK_CLIPBOARD
+        quint64 sequence = 0;
+        // DMT_UHID_OUTPUT
+        quint16 uhidId = 0;
     };
 
     DeviceMsgData m_data;
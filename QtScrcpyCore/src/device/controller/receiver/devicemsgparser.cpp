@@ -0,0 +1,232 @@
+#include <QDebug>
+
+#include <cstring>
+
+#include "devicemsgparser.h"
+
+namespace {
+
+quint16 read16be(const char *buf)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(buf);
+    return static_cast<quint16>((p[0] << 8) | p[1]);
+}
+
+quint32 read32be(const char *buf)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(buf);
+    return (static_cast<quint32>(p[0]) << 24) | (static_cast<quint32>(p[1]) << 16) | (static_cast<quint32>(p[2]) << 8) | p[3];
+}
+
+quint64 read64be(const char *buf)
+{
+    return (static_cast<quint64>(read32be(buf)) << 32) | read32be(buf + 4);
+}
+
+}
+
+DeviceMsgParser::DeviceMsgParser(int ringSize)
+{
+    // 取2的幂，位置直接用掩码取模
+    int size = 16;
+    while (size < ringSize) {
+        size <<= 1;
+    }
+    m_ring.resize(size);
+    m_mask = static_cast<quint64>(size - 1);
+}
+
+char *DeviceMsgParser::writePointer(qint64 &len)
+{
+    const quint64 capacity = static_cast<quint64>(m_ring.size());
+    const quint64 free = capacity - (m_writePos - m_readPos);
+    const quint64 offset = m_writePos & m_mask;
+    // 到缓冲区末尾为止，回绕的部分下次再写
+    len = static_cast<qint64>(qMin(free, capacity - offset));
+    return m_ring.data() + offset;
+}
+
+void DeviceMsgParser::commitWrite(qint64 len)
+{
+    if (len > 0) {
+        m_writePos += static_cast<quint64>(len);
+    }
+}
+
+qint64 DeviceMsgParser::write(const char *data, qint64 len)
+{
+    qint64 written = 0;
+    while (written < len) {
+        qint64 space = 0;
+        char *ptr = writePointer(space);
+        if (space <= 0) {
+            break;
+        }
+        const qint64 n = qMin(space, len - written);
+        memcpy(ptr, data + written, static_cast<size_t>(n));
+        commitWrite(n);
+        written += n;
+    }
+    return written;
+}
+
+bool DeviceMsgParser::parse(const Handler &handler)
+{
+    while (true) {
+        switch (m_state) {
+        case PS_TYPE: {
+            char type = 0;
+            if (!read(&type, 1)) {
+                return true;
+            }
+            if (!startMessage(type)) {
+                m_state = PS_ERROR;
+                return false;
+            }
+            break;
+        }
+        case PS_HEADER:
+            m_headerReceived += static_cast<int>(read(m_header + m_headerReceived, m_headerSize - m_headerReceived));
+            if (m_headerReceived < m_headerSize) {
+                // wait for the rest of the header
+                return true;
+            }
+            finishHeader();
+            if (PS_ERROR == m_state) {
+                return false;
+            }
+            if (PS_TYPE == m_state) {
+                finishMessage(handler);
+            }
+            break;
+        case PS_BODY: {
+            QByteArray &payload = m_msg->m_data.payload;
+            m_bodyReceived += static_cast<int>(read(payload.data() + m_bodyReceived, payload.size() - m_bodyReceived));
+            if (m_bodyReceived < payload.size()) {
+                // wait for the rest of the body
+                return true;
+            }
+            m_state = PS_TYPE;
+            finishMessage(handler);
+            break;
+        }
+        case PS_ERROR:
+        default:
+            return false;
+        }
+    }
+}
+
+void DeviceMsgParser::reset()
+{
+    m_readPos = 0;
+    m_writePos = 0;
+    m_state = PS_TYPE;
+    m_msg.reset();
+    m_headerSize = 0;
+    m_headerReceived = 0;
+    m_bodyReceived = 0;
+}
+
+bool DeviceMsgParser::hasError() const
+{
+    return PS_ERROR == m_state;
+}
+
+qint64 DeviceMsgParser::buffered() const
+{
+    return static_cast<qint64>(m_writePos - m_readPos);
+}
+
+quint64 DeviceMsgParser::parsedMessages() const
+{
+    return m_parsedMessages;
+}
+
+qint64 DeviceMsgParser::read(char *data, qint64 len)
+{
+    len = qMin(len, buffered());
+    if (len <= 0) {
+        return 0;
+    }
+    const quint64 offset = m_readPos & m_mask;
+    const qint64 first = qMin(len, static_cast<qint64>(static_cast<quint64>(m_ring.size()) - offset));
+    memcpy(data, m_ring.constData() + offset, static_cast<size_t>(first));
+    if (first < len) {
+        memcpy(data + first, m_ring.constData(), static_cast<size_t>(len - first));
+    }
+    m_readPos += static_cast<quint64>(len);
+    return len;
+}
+
+bool DeviceMsgParser::startMessage(char type)
+{
+    switch (static_cast<DeviceMsg::DeviceMsgType>(type)) {
+    case DeviceMsg::DMT_GET_CLIPBOARD:
+        // length: 4 bytes
+        m_headerSize = 4;
+        break;
+    case DeviceMsg::DMT_ACK_CLIPBOARD:
+        // sequence: 8 bytes
+        m_headerSize = 8;
+        break;
+    case DeviceMsg::DMT_UHID_OUTPUT:
+        // id: 2 bytes; size: 2 bytes
+        m_headerSize = 4;
+        break;
+    default:
+        qWarning("Unsupported device msg type: %d", static_cast<int>(type));
+        return false;
+    }
+
+    m_msg.reset(new DeviceMsg());
+    m_msg->m_data.type = static_cast<DeviceMsg::DeviceMsgType>(type);
+    m_headerReceived = 0;
+    m_bodyReceived = 0;
+    m_state = PS_HEADER;
+    return true;
+}
+
+void DeviceMsgParser::finishHeader()
+{
+    DeviceMsg::DeviceMsgData &data = m_msg->m_data;
+    int bodySize = 0;
+    switch (data.type) {
+    case DeviceMsg::DMT_GET_CLIPBOARD: {
+        const quint32 len = read32be(m_header);
+        if (len > DEVICE_MSG_TEXT_MAX_LENGTH) {
+            qWarning("Device clipboard too large: %u", len);
+            m_state = PS_ERROR;
+            return;
+        }
+        bodySize = static_cast<int>(len);
+        break;
+    }
+    case DeviceMsg::DMT_ACK_CLIPBOARD:
+        data.sequence = read64be(m_header);
+        break;
+    case DeviceMsg::DMT_UHID_OUTPUT:
+        data.uhidId = read16be(m_header);
+        bodySize = read16be(m_header + 2);
+        break;
+    default:
+        break;
+    }
+
+    if (bodySize > 0) {
+        data.payload.resize(bodySize);
+        m_state = PS_BODY;
+    } else {
+        m_state = PS_TYPE;
+    }
+}
+
+void DeviceMsgParser::finishMessage(const Handler &handler)
+{
+    QSharedPointer<DeviceMsg> msg;
+    msg.swap(m_msg);
+    m_parsedMessages++;
+    if (handler) {
+        handler(msg);
+    }
+}
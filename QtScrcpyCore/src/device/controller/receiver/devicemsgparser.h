@@ -0,0 +1,74 @@
+#ifndef DEVICEMSGPARSER_H
+#define DEVICEMSGPARSER_H
+
+#include <QSharedPointer>
+#include <QVector>
+
+#include <functional>
+
+#include "devicemsg.h"
+
+// 环形缓冲区的默认大小，消息头最多9字节，消息体边收边拷贝，不需要容纳整条消息
+#define DEVICE_MSG_RING_SIZE (1 << 16) // 64k
+
+// 设备消息的增量解析器
+// 每个socket一个，数据直接读入环形缓冲区（writePointer/commitWrite），parse只处理新到达的字节：
+// - 消息头收齐后只解析一次，不完整的消息不会重新解析
+// - 剪贴板和UHID数据按消息头中的长度预分配，每个字节只从环形缓冲区拷贝一次
+// 不依赖socket和事件循环，可以单独做模糊测试和性能测试
+class DeviceMsgParser
+{
+public:
+    using Handler = std::function<void(const QSharedPointer<DeviceMsg> &msg)>;
+
+    explicit DeviceMsgParser(int ringSize = DEVICE_MSG_RING_SIZE);
+
+    // 环形缓冲区中可以直接写入的连续空间，len返回其大小，缓冲区满时为0
+    char *writePointer(qint64 &len);
+    // 已写入writePointer的字节数
+    void commitWrite(qint64 len);
+    // 拷贝写入，返回实际写入的字节数，缓冲区满时小于len
+    qint64 write(const char *data, qint64 len);
+
+    // 解析所有已写入的字节，每收齐一条消息调用一次handler
+    // 返回false表示遇到未知消息或非法长度，流无法恢复，需要reset
+    bool parse(const Handler &handler);
+    void reset();
+
+    bool hasError() const;
+    // 环形缓冲区中还未解析的字节数
+    qint64 buffered() const;
+    quint64 parsedMessages() const;
+
+private:
+    enum ParseState
+    {
+        PS_TYPE = 0,
+        PS_HEADER,
+        PS_BODY,
+        PS_ERROR,
+    };
+
+    qint64 read(char *data, qint64 len);
+    bool startMessage(char type);
+    void finishHeader();
+    void finishMessage(const Handler &handler);
+
+private:
+    QVector<char> m_ring;
+    quint64 m_mask = 0;
+    // 单调递增，取模后是环形缓冲区中的位置
+    quint64 m_readPos = 0;
+    quint64 m_writePos = 0;
+
+    ParseState m_state = PS_TYPE;
+    QSharedPointer<DeviceMsg> m_msg;
+    // 消息类型之后的定长部分
+    char m_header[8];
+    int m_headerSize = 0;
+    int m_headerReceived = 0;
+    int m_bodyReceived = 0;
+    quint64 m_parsedMessages = 0;
+};
+
+#endif // DEVICEMSGPARSER_H
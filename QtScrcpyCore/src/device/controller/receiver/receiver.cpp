@@ -24,6 +24,9 @@ void Receiver::recvDeviceMsg(DeviceMsg *deviceMsg)
         board->setText(text);
         break;
     }
+    case DeviceMsg::DMT_UHID_OUTPUT:
+        // 没有创建UHID设备，不会有需要处理的输出报告
+        break;
     default:
         break;
     }
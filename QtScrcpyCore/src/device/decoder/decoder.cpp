@@ -1,15 +1,19 @@
 #include <QDebug>
 
 #include "compat.h"
+#include "decodescheduler.h"
 #include "decoder.h"
+#include "gopcache.h"
+#include "latencytracker.h"
 #include "videobuffer.h"
 
-Decoder::Decoder(std::function<void(int, int, uint8_t*, uint8_t*, uint8_t*, int, int, int)> onFrame, QObject *parent)
+Decoder::Decoder(std::function<void(const qsc::FrameBufferPtr &)> onFrame, QObject *parent)
     : QObject(parent)
     , m_vb(new VideoBuffer())
     , m_onFrame(onFrame)
 {
     m_vb->init();
+    m_dispatcher.setConverter(&m_converter);
     connect(this, &Decoder::newFrame, this, &Decoder::onNewFrame, Qt::QueuedConnection);
     connect(m_vb, &VideoBuffer::updateFPS, this, &Decoder::updateFPS);
 }
@@ -19,12 +23,12 @@ Decoder::~Decoder() {
     delete m_vb;
 }
 
-bool Decoder::open()
+bool Decoder::open(AVCodecID codecId)
 {
     // codec
-    const AVCodec* codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    const AVCodec* codec = avcodec_find_decoder(codecId);
     if (!codec) {
-        qCritical("H.264 decoder not found");
+        qCritical("%s decoder not found", avcodec_get_name(codecId));
         return false;
     }
 
@@ -34,11 +38,27 @@ bool Decoder::open()
         qCritical("Could not allocate decoder context");
         return false;
     }
+    // decoded planes come from pooled, refcounted buffers so that frames can be
+    // handed to observers and renderers without copying
+    m_framePool.install(m_codecCtx);
     if (avcodec_open2(m_codecCtx, codec, NULL) < 0) {
-        qCritical("Could not open H.264 codec");
+        qCritical("Could not open %s codec", codec->name);
         return false;
     }
     m_isCodecCtxOpen = true;
+
+    // new codec context, the mode is applied again on the first packet
+    m_appliedMode = qsc::DECODE_FULL;
+    m_priming = false;
+    m_resync = false;
+    m_pendingExtradata.clear();
+    m_changeDetector.reset();
+
+    m_streamId = DecodeScheduler::instance().registerStream([this](const AVPacket *packet) {
+        if (!decode(packet)) {
+            qCritical("Could not decode packet");
+        }
+    }, m_focused);
     return true;
 }
 
@@ -48,6 +68,17 @@ void Decoder::close()
         m_vb->interrupt();
     }
 
+    // wait for the worker to leave the codec context before freeing it
+    if (m_streamId >= 0) {
+        qsc::DecodeStats s = stats();
+        qInfo() << "decoder" << s.codec << "packets:" << s.decodedPackets << "bytes:" << s.decodedBytes
+                << "avg decode us:" << s.avgDecodeUs << "frame buffer allocations:" << m_framePool.allocations()
+                << "conversions:" << m_converter.conversions() << "shared:" << m_converter.hits()
+                << "elided:" << s.elidedFrames << "partial:" << s.partialFrames << "primed:" << m_primes.load() << "times" << s.primedPackets << "packets";
+        DecodeScheduler::instance().unregisterStream(m_streamId);
+        m_streamId = -1;
+    }
+
     if (!m_codecCtx) {
         return;
     }
@@ -58,10 +89,170 @@ void Decoder::close()
 }
 
 bool Decoder::push(const AVPacket *packet)
+{
+    if (m_streamId < 0) {
+        return false;
+    }
+
+    const qsc::DecodeMode mode = static_cast<qsc::DecodeMode>(m_mode.load());
+    const bool isKey = packet->flags & AV_PKT_FLAG_KEY;
+    // dropped before they reach the scheduler, so paused or key frame only
+    // devices cost no decode time at all
+    if (mode == qsc::DECODE_PAUSED || (mode == qsc::DECODE_KEYFRAME_ONLY && !isKey)) {
+        // the reference chain is broken from here on
+        m_resync = true;
+        keepExtradata(packet);
+        return true;
+    }
+    if (m_resync && !isKey) {
+        // back to FULL or SKIP_NONREF in the middle of a group
+        if (primeFromCache(packet)) {
+            // the cached key frame carries the latest SPS/PPS
+            m_resync = false;
+            m_pendingExtradata.clear();
+            return true;
+        }
+        // nothing usable cached, resume on the next key frame
+        keepExtradata(packet);
+        return true;
+    }
+    m_resync = false;
+
+    if (m_pendingExtradata.isEmpty()) {
+        return DecodeScheduler::instance().push(m_streamId, packet);
+    }
+
+    // a dropped packet carried new SPS/PPS, hand it over with this one
+    AVPacket *ref = av_packet_alloc();
+    if (!ref || av_packet_ref(ref, packet)) {
+        av_packet_free(&ref);
+        return false;
+    }
+    if (!av_packet_get_side_data(ref, AV_PKT_DATA_NEW_EXTRADATA, Q_NULLPTR)) {
+        uint8_t *extradata = av_packet_new_side_data(ref, AV_PKT_DATA_NEW_EXTRADATA, m_pendingExtradata.size());
+        if (extradata) {
+            memcpy(extradata, m_pendingExtradata.constData(), static_cast<size_t>(m_pendingExtradata.size()));
+        }
+    }
+    m_pendingExtradata.clear();
+    bool ok = DecodeScheduler::instance().push(m_streamId, ref);
+    av_packet_free(&ref);
+    return ok;
+}
+
+void Decoder::keepExtradata(const AVPacket *packet)
+{
+    QTSCRCPY_LAVC_SIDE_DATA_SIZE_T size = 0;
+    const uint8_t *extradata = av_packet_get_side_data(packet, AV_PKT_DATA_NEW_EXTRADATA, &size);
+    if (extradata && size > 0) {
+        m_pendingExtradata = QByteArray(reinterpret_cast<const char *>(extradata), static_cast<int>(size));
+    }
+}
+
+bool Decoder::primeFromCache(const AVPacket *packet)
+{
+    if (!m_gopCache) {
+        return false;
+    }
+    QVector<AVPacket *> packets;
+    if (!m_gopCache->snapshot(packets)) {
+        return false;
+    }
+    // the demuxer caches a packet before handing it to the decoder, so a
+    // complete group ends with this one
+    const AVPacket *last = packets.last();
+    if (last->pts != packet->pts || last->size != packet->size) {
+        for (AVPacket *cached : packets) {
+            av_packet_free(&cached);
+        }
+        return false;
+    }
+    // only the last one is shown, the others just rebuild the references
+    for (int i = 0; i < packets.size() - 1; ++i) {
+        packets[i]->flags |= AV_PKT_FLAG_DISCARD;
+    }
+    // 每次恢复或新视图都会补解，只计入停止时的统计
+    m_primes++;
+    m_primedPackets += static_cast<quint64>(packets.size());
+    return DecodeScheduler::instance().prime(m_streamId, packets);
+}
+
+void Decoder::setDecodeMode(qsc::DecodeMode mode)
+{
+    if (m_mode.exchange(mode) != mode) {
+        qInfo() << "decode mode ->" << mode;
+    }
+}
+
+qsc::DecodeMode Decoder::decodeMode()
+{
+    return static_cast<qsc::DecodeMode>(m_mode.load());
+}
+
+void Decoder::applyDecodeMode(qsc::DecodeMode mode)
+{
+    switch (mode) {
+    case qsc::DECODE_SKIP_NONREF:
+        // skipped frames are never referenced; reference frames keep the
+        // loop filter, otherwise the missing deblocking would propagate
+        // through every following P-frame until the next key frame
+        m_codecCtx->skip_frame = AVDISCARD_NONREF;
+        m_codecCtx->skip_loop_filter = AVDISCARD_NONREF;
+        break;
+    case qsc::DECODE_KEYFRAME_ONLY:
+        m_codecCtx->skip_frame = AVDISCARD_NONKEY;
+        m_codecCtx->skip_loop_filter = AVDISCARD_DEFAULT;
+        break;
+    case qsc::DECODE_PAUSED:
+        // no packet reaches the decoder
+        break;
+    default:
+        m_codecCtx->skip_frame = AVDISCARD_DEFAULT;
+        m_codecCtx->skip_loop_filter = AVDISCARD_DEFAULT;
+        break;
+    }
+}
+
+void Decoder::setFocused(bool focused)
+{
+    m_focused = focused;
+    if (m_streamId >= 0) {
+        DecodeScheduler::instance().setFocused(m_streamId, focused);
+    }
+}
+
+qsc::DecodeStats Decoder::stats()
+{
+    if (m_streamId < 0) {
+        return qsc::DecodeStats();
+    }
+    qsc::DecodeStats stats = DecodeScheduler::instance().stats(m_streamId);
+    if (m_codecCtx) {
+        stats.codec = avcodec_get_name(m_codecCtx->codec_id);
+    }
+    stats.elidedFrames = m_changeDetector.elidedFrames();
+    stats.partialFrames = m_changeDetector.partialFrames();
+    stats.primedPackets = m_primedPackets.load();
+    return stats;
+}
+
+bool Decoder::decode(const AVPacket *packet)
 {
     if (!m_codecCtx || !m_vb) {
         return false;
     }
+
+    const qsc::DecodeMode mode = static_cast<qsc::DecodeMode>(m_mode.load());
+    const bool priming = packet->flags & AV_PKT_FLAG_DISCARD;
+    if (mode != m_appliedMode || priming != m_priming) {
+        applyDecodeMode(mode);
+        m_appliedMode = mode;
+        m_priming = priming;
+        if (priming && m_codecCtx->skip_frame < AVDISCARD_NONREF) {
+            // nothing of a primed frame is shown, only the references matter
+            m_codecCtx->skip_frame = AVDISCARD_NONREF;
+        }
+    }
     AVFrame *decodingFrame = m_vb->decodingFrame();
 #ifdef QTSCRCPY_LAVF_HAS_NEW_ENCODING_DECODING_API
     int ret = -1;
@@ -76,7 +267,9 @@ bool Decoder::push(const AVPacket *packet)
     }
     if (!ret) {
         // a frame was received
-        pushFrame();
+        if (!priming) {
+            pushFrame();
+        }
 
         //emit getOneFrame(yuvDecoderFrame->data[0], yuvDecoderFrame->data[1], yuvDecoderFrame->data[2],
         //        yuvDecoderFrame->linesize[0], yuvDecoderFrame->linesize[1], yuvDecoderFrame->linesize[2]);
@@ -113,19 +306,54 @@ bool Decoder::push(const AVPacket *packet)
         qCritical("Could not decode video packet: %d", len);
         return false;
     }
-    if (gotPicture) {
+    if (gotPicture && !priming) {
         pushFrame();
     }
 #endif
     return true;
 }
 
-void Decoder::peekFrame(std::function<void (int, int, uint8_t *)> onFrame)
+AVFrame *Decoder::refFrame()
 {
     if (!m_vb) {
-        return;
+        return Q_NULLPTR;
     }
-    m_vb->peekRenderedFrame(onFrame);
+    return m_vb->refRenderedFrame();
+}
+
+qsc::FrameBufferPtr Decoder::latestFrame()
+{
+    AVFrame *frame = refFrame();
+    if (!frame) {
+        return qsc::FrameBufferPtr();
+    }
+    return FramePool::wrapFrame(frame);
+}
+
+void Decoder::setGopCache(QSharedPointer<GopCache> cache)
+{
+    m_gopCache = cache;
+}
+
+void Decoder::addFrameObserver(qsc::DeviceObserver *observer, qsc::FrameAffinity affinity)
+{
+    m_dispatcher.addObserver(observer, affinity, latestFrame());
+}
+
+void Decoder::removeFrameObserver(qsc::DeviceObserver *observer)
+{
+    m_dispatcher.removeObserver(observer);
+}
+
+void Decoder::setLatencyTracker(QSharedPointer<LatencyTracker> tracker)
+{
+    m_latency = tracker;
+    m_dispatcher.setLatencyTracker(tracker);
+}
+
+qsc::FrameBufferPtr Decoder::convertFrame(const qsc::FrameBufferPtr &frame, const qsc::FrameFormat &format)
+{
+    return m_converter.convert(frame, format);
 }
 
 void Decoder::pushFrame()
@@ -133,6 +361,18 @@ void Decoder::pushFrame()
     if (!m_vb) {
         return;
     }
+    AVFrame *decodingFrame = m_vb->decodingFrame();
+    // 内容id和变化区域挂在opaque_ref上，观察者据此跳过已显示过的画面、只更新变化的区域
+    const bool unchanged = m_changeDetector.update(decodingFrame);
+    if (unchanged && !m_changeDetector.refreshDue()) {
+        // 静止画面：不分发也不唤醒GUI线程，解码帧槽位留给下一帧
+        return;
+    }
+    if (m_latency) {
+        m_latency->mark(decodingFrame->pts, qsc::LS_DECODE);
+    }
+    // the decoding frame still belongs to this thread until it is offered
+    m_dispatcher.dispatch(decodingFrame);
     bool previousFrameSkipped = true;
     m_vb->offerDecodedFrame(previousFrameSkipped);
     if (previousFrameSkipped) {
@@ -147,8 +387,16 @@ void Decoder::onNewFrame() {
         return;
     }
 
+    // 读者锁内只引用帧，观察者在锁外处理
     m_vb->lock();
-    const AVFrame *frame = m_vb->consumeRenderedFrame();
-    m_onFrame(frame->width, frame->height, frame->data[0], frame->data[1], frame->data[2], frame->linesize[0], frame->linesize[1], frame->linesize[2]);
+    qsc::FrameBufferPtr frame = FramePool::refFrame(m_vb->consumeRenderedFrame());
     m_vb->unLock();
+    if (!frame) {
+        return;
+    }
+
+    m_onFrame(frame);
+    if (m_latency) {
+        m_latency->mark(frame->pts, qsc::LS_CONVERT);
+    }
 }
@@ -1,6 +1,10 @@
 #ifndef DECODER_H
 #define DECODER_H
+#include <QByteArray>
 #include <QObject>
+#include <QSharedPointer>
+
+#include <atomic>
 
 extern "C"
 {
@@ -9,18 +13,45 @@ extern "C"
 
 #include <functional>
 
+#include "QtScrcpyCoreDef.h"
+#include "framechangedetector.h"
+#include "frameconverter.h"
+#include "framedispatcher.h"
+#include "framepool.h"
+
 class VideoBuffer;
+class LatencyTracker;
+class GopCache;
 class Decoder : public QObject
 {
     Q_OBJECT
 public:
-    Decoder(std::function<void(int width, int height, uint8_t* dataY, uint8_t* dataU, uint8_t* dataV, int linesizeY, int linesizeU, int linesizeV)> onFrame, QObject *parent = Q_NULLPTR);
+    // onFrame在Decoder所在线程调用，frame引用解码器缓冲区，可以在回调之外继续持有
+    Decoder(std::function<void(const qsc::FrameBufferPtr &frame)> onFrame, QObject *parent = Q_NULLPTR);
     virtual ~Decoder();
 
-    bool open();
+    bool open(AVCodecID codecId = AV_CODEC_ID_H264);
     void close();
+    // queue the packet on the shared DecodeScheduler, decoding happens on a worker thread
     bool push(const AVPacket *packet);
-    void peekFrame(std::function<void(int width, int height, uint8_t* dataRGB32)> onFrame);
+    void setFocused(bool focused);
+    qsc::DecodeStats stats();
+    // applied to the codec context before the next decoded packet
+    void setDecodeMode(qsc::DecodeMode mode);
+    qsc::DecodeMode decodeMode();
+    // reference to the latest decoded frame, the caller must av_frame_free it
+    AVFrame *refFrame();
+    // the latest decoded frame, empty before the first one
+    qsc::FrameBufferPtr latestFrame();
+    // resume from a paused or key frame only mode by decoding the cached group
+    // of pictures instead of waiting for the next key frame
+    void setGopCache(QSharedPointer<GopCache> cache);
+    // observers receiving onFrame off the GUI thread, see qsc::FrameAffinity
+    void addFrameObserver(qsc::DeviceObserver *observer, qsc::FrameAffinity affinity);
+    void removeFrameObserver(qsc::DeviceObserver *observer);
+    void setLatencyTracker(QSharedPointer<LatencyTracker> tracker);
+    // 按观察者请求的规格转换，同一帧同一规格在所有观察者之间只转换一次
+    qsc::FrameBufferPtr convertFrame(const qsc::FrameBufferPtr &frame, const qsc::FrameFormat &format);
 
 signals:
     void updateFPS(quint32 fps);
@@ -32,13 +63,42 @@ signals:
     void newFrame();
 
 private:
+    // runs on a DecodeScheduler worker thread
+    bool decode(const AVPacket *packet);
+    void applyDecodeMode(qsc::DecodeMode mode);
     void pushFrame();
+    // keep the SPS/PPS of a dropped packet for the next decoded one
+    void keepExtradata(const AVPacket *packet);
+    // queue the cached group of pictures ending with packet, false if it is not available
+    bool primeFromCache(const AVPacket *packet);
 
 private:
     VideoBuffer *m_vb = Q_NULLPTR;
     AVCodecContext *m_codecCtx = Q_NULLPTR;
     bool m_isCodecCtxOpen = false;
-    std::function<void(int, int, uint8_t*, uint8_t*, uint8_t*, int, int, int)> m_onFrame = Q_NULLPTR;
+    int m_streamId = -1;
+    bool m_focused = false;
+
+    std::atomic<int> m_mode{qsc::DECODE_FULL};
+    // only accessed on the decode worker
+    qsc::DecodeMode m_appliedMode = qsc::DECODE_FULL;
+    // only accessed on the decode worker: decoding cached packets that are not shown
+    bool m_priming = false;
+    // only accessed by push(): packets were dropped, wait for a key frame
+    bool m_resync = false;
+    QByteArray m_pendingExtradata;
+    QSharedPointer<GopCache> m_gopCache;
+    std::atomic<quint64> m_primes{0};
+    std::atomic<quint64> m_primedPackets{0};
+    // get_buffer2 of m_codecCtx
+    FramePool m_framePool;
+    // shared by the GUI thread observers and m_dispatcher, must outlive it
+    FrameConverter m_converter;
+    FrameDispatcher m_dispatcher;
+    // only accessed on the decode worker, except the elided counter
+    FrameChangeDetector m_changeDetector;
+    QSharedPointer<LatencyTracker> m_latency;
+    std::function<void(const qsc::FrameBufferPtr &)> m_onFrame = Q_NULLPTR;
 };
 
 #endif // DECODER_H
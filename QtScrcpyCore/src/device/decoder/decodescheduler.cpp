@@ -0,0 +1,297 @@
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <algorithm>
+
+#include "decodescheduler.h"
+
+// about 2 seconds of video at 60 fps
+#define DECODE_QUEUE_MAX 120
+
+struct DecodeScheduler::Stream
+{
+    DecodeFunc decodeFunc;
+    std::deque<AVPacket *> queue;
+    bool focused = false;
+    // in m_runQueue
+    bool scheduled = false;
+    // being decoded by a worker
+    bool busy = false;
+    bool removing = false;
+    // the queue overflowed, drop until the next key frame
+    bool waitKeyFrame = false;
+    // primed packets at the front of the queue, not counted against DECODE_QUEUE_MAX
+    int primedPackets = 0;
+
+    int maxQueueDepth = 0;
+    quint64 decodedPackets = 0;
+    quint64 droppedPackets = 0;
+    quint64 decodedBytes = 0;
+    qint64 totalDecodeUs = 0;
+    qint64 maxDecodeUs = 0;
+
+    void clearQueue()
+    {
+        for (AVPacket *packet : queue) {
+            av_packet_free(&packet);
+        }
+        droppedPackets += queue.size();
+        queue.clear();
+        primedPackets = 0;
+    }
+};
+
+namespace {
+
+class DecodeWorker : public QThread
+{
+public:
+    explicit DecodeWorker(std::function<void()> loop) : m_loop(loop) {}
+
+protected:
+    void run() override { m_loop(); }
+
+private:
+    std::function<void()> m_loop;
+};
+
+}
+
+DecodeScheduler &DecodeScheduler::instance()
+{
+    static DecodeScheduler scheduler;
+    return scheduler;
+}
+
+DecodeScheduler::DecodeScheduler() {}
+
+DecodeScheduler::~DecodeScheduler()
+{
+    stop();
+}
+
+void DecodeScheduler::startWorkers()
+{
+    // called with m_mutex locked
+    if (!m_workers.isEmpty()) {
+        return;
+    }
+    m_quit = false;
+    int count = qMax(1, QThread::idealThreadCount());
+    for (int i = 0; i < count; ++i) {
+        QThread *worker = new DecodeWorker([this]() {
+            workerLoop();
+        });
+        worker->setObjectName(QString("DecodeWorker-%1").arg(i));
+        worker->start();
+        m_workers.append(worker);
+    }
+    qInfo() << "decode scheduler started with" << count << "workers";
+}
+
+void DecodeScheduler::stop()
+{
+    QList<QThread *> workers;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        workers = m_workers;
+        m_workers.clear();
+        m_workCond.wakeAll();
+    }
+    for (QThread *worker : workers) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+int DecodeScheduler::registerStream(DecodeFunc decodeFunc, bool focused)
+{
+    QMutexLocker locker(&m_mutex);
+    startWorkers();
+
+    Stream *stream = new Stream;
+    stream->decodeFunc = decodeFunc;
+    stream->focused = focused;
+    int id = m_nextId++;
+    m_streams.insert(id, stream);
+    return id;
+}
+
+void DecodeScheduler::unregisterStream(int id)
+{
+    QMutexLocker locker(&m_mutex);
+    Stream *stream = m_streams.value(id, Q_NULLPTR);
+    if (!stream) {
+        return;
+    }
+
+    stream->removing = true;
+    stream->clearQueue();
+    m_runQueue.erase(std::remove(m_runQueue.begin(), m_runQueue.end(), id), m_runQueue.end());
+    while (stream->busy) {
+        m_idleCond.wait(&m_mutex);
+    }
+
+    m_streams.remove(id);
+    delete stream;
+}
+
+bool DecodeScheduler::push(int id, const AVPacket *packet)
+{
+    QMutexLocker locker(&m_mutex);
+    Stream *stream = m_streams.value(id, Q_NULLPTR);
+    if (!stream || stream->removing) {
+        return false;
+    }
+
+    const bool isKey = packet->flags & AV_PKT_FLAG_KEY;
+    if (!isKey && static_cast<int>(stream->queue.size()) - stream->primedPackets >= DECODE_QUEUE_MAX) {
+        // the decoder cannot keep up, dropping single packets would break the
+        // reference chain anyway, so drop the backlog and resync on a key frame
+        qWarning() << "decode queue overflow, drop" << stream->queue.size() << "packets";
+        stream->clearQueue();
+        stream->waitKeyFrame = true;
+    }
+    if (stream->waitKeyFrame) {
+        if (!isKey) {
+            stream->droppedPackets++;
+            return true;
+        }
+        stream->waitKeyFrame = false;
+    }
+
+    AVPacket *ref = av_packet_alloc();
+    if (!ref || av_packet_ref(ref, packet)) {
+        av_packet_free(&ref);
+        qCritical("Could not ref packet");
+        return false;
+    }
+    stream->queue.push_back(ref);
+    stream->maxQueueDepth = qMax(stream->maxQueueDepth, static_cast<int>(stream->queue.size()));
+
+    if (!stream->scheduled && !stream->busy) {
+        schedule(id, stream);
+    }
+    return true;
+}
+
+bool DecodeScheduler::prime(int id, const QVector<AVPacket *> &packets)
+{
+    QMutexLocker locker(&m_mutex);
+    Stream *stream = m_streams.value(id, Q_NULLPTR);
+    if (!stream || stream->removing || packets.isEmpty()) {
+        for (AVPacket *packet : packets) {
+            av_packet_free(&packet);
+        }
+        return false;
+    }
+
+    // anything still queued is older than the cached key frame
+    stream->clearQueue();
+    stream->waitKeyFrame = false;
+    for (AVPacket *packet : packets) {
+        stream->queue.push_back(packet);
+    }
+    stream->primedPackets = packets.size();
+    stream->maxQueueDepth = qMax(stream->maxQueueDepth, static_cast<int>(stream->queue.size()));
+
+    if (!stream->scheduled && !stream->busy) {
+        schedule(id, stream);
+    }
+    return true;
+}
+
+void DecodeScheduler::setFocused(int id, bool focused)
+{
+    QMutexLocker locker(&m_mutex);
+    Stream *stream = m_streams.value(id, Q_NULLPTR);
+    if (stream) {
+        stream->focused = focused;
+    }
+}
+
+qsc::DecodeStats DecodeScheduler::stats(int id)
+{
+    qsc::DecodeStats stats;
+    QMutexLocker locker(&m_mutex);
+    Stream *stream = m_streams.value(id, Q_NULLPTR);
+    if (!stream) {
+        return stats;
+    }
+    stats.queueDepth = static_cast<int>(stream->queue.size());
+    stats.maxQueueDepth = stream->maxQueueDepth;
+    stats.decodedPackets = stream->decodedPackets;
+    stats.droppedPackets = stream->droppedPackets;
+    stats.decodedBytes = stream->decodedBytes;
+    stats.avgDecodeUs = stream->decodedPackets ? stream->totalDecodeUs / static_cast<qint64>(stream->decodedPackets) : 0;
+    stats.maxDecodeUs = stream->maxDecodeUs;
+    return stats;
+}
+
+void DecodeScheduler::schedule(int id, Stream *stream)
+{
+    // called with m_mutex locked
+    stream->scheduled = true;
+    if (stream->focused) {
+        m_runQueue.push_front(id);
+    } else {
+        m_runQueue.push_back(id);
+    }
+    m_workCond.wakeOne();
+}
+
+void DecodeScheduler::workerLoop()
+{
+    QElapsedTimer timer;
+    QMutexLocker locker(&m_mutex);
+    for (;;) {
+        while (!m_quit && m_runQueue.empty()) {
+            m_workCond.wait(&m_mutex);
+        }
+        if (m_quit) {
+            break;
+        }
+
+        int id = m_runQueue.front();
+        m_runQueue.pop_front();
+        Stream *stream = m_streams.value(id, Q_NULLPTR);
+        if (!stream) {
+            continue;
+        }
+        stream->scheduled = false;
+        if (stream->queue.empty()) {
+            continue;
+        }
+
+        // one packet per turn, so that every stream makes progress
+        AVPacket *packet = stream->queue.front();
+        stream->queue.pop_front();
+        if (stream->primedPackets > 0) {
+            stream->primedPackets--;
+        }
+        stream->busy = true;
+
+        locker.unlock();
+        timer.start();
+        stream->decodeFunc(packet);
+        qint64 decodeUs = timer.nsecsElapsed() / 1000;
+        const int packetSize = packet->size;
+        av_packet_free(&packet);
+        locker.relock();
+
+        stream->busy = false;
+        stream->decodedPackets++;
+        stream->decodedBytes += static_cast<quint64>(packetSize);
+        stream->totalDecodeUs += decodeUs;
+        stream->maxDecodeUs = qMax(stream->maxDecodeUs, decodeUs);
+
+        if (stream->removing) {
+            m_idleCond.wakeAll();
+        } else if (!stream->queue.empty()) {
+            schedule(id, stream);
+        }
+    }
+}
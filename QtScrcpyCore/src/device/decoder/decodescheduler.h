@@ -0,0 +1,71 @@
+#ifndef DECODESCHEDULER_H
+#define DECODESCHEDULER_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <deque>
+#include <functional>
+
+#include "QtScrcpyCoreDef.h"
+
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+}
+
+class QThread;
+
+// 全局解码调度器
+// 按CPU核数创建解码线程，所有设备的解码上下文在这些线程上复用：
+// - 每个设备一个有界输入队列，队列满时丢弃积压并等待下一个关键帧
+// - 设备之间按数据包轮转，同一设备同一时刻只在一个线程上解码
+// - 焦点设备优先调度
+class DecodeScheduler
+{
+public:
+    typedef std::function<void(const AVPacket *packet)> DecodeFunc;
+
+    static DecodeScheduler &instance();
+
+    // 返回流id，decodeFunc在解码线程中调用
+    int registerStream(DecodeFunc decodeFunc, bool focused = false);
+    // 丢弃排队的数据包，并等待正在进行的解码结束
+    void unregisterStream(int id);
+    // 引用packet并加入队列，不阻塞
+    bool push(int id, const AVPacket *packet);
+    // 用packets替换排队的数据包（第一个为关键帧），接管packets的所有权
+    // 预热的数据包不计入队列上限
+    bool prime(int id, const QVector<AVPacket *> &packets);
+    void setFocused(int id, bool focused);
+    qsc::DecodeStats stats(int id);
+
+    // 退出并等待所有解码线程
+    void stop();
+
+private:
+    DecodeScheduler();
+    ~DecodeScheduler();
+    Q_DISABLE_COPY(DecodeScheduler)
+
+    struct Stream;
+    void startWorkers();
+    void schedule(int id, Stream *stream);
+    void workerLoop();
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_workCond;
+    QWaitCondition m_idleCond;
+    QHash<int, Stream *> m_streams;
+    // 待调度的流，每次取出一个数据包后重新排到队尾
+    std::deque<int> m_runQueue;
+    QList<QThread *> m_workers;
+    int m_nextId = 0;
+    bool m_quit = false;
+};
+
+#endif // DECODESCHEDULER_H
@@ -3,7 +3,7 @@
 
 #include "fpscounter.h"
 
-FpsCounter::FpsCounter(QObject *parent) : QObject(parent) {}
+FpsCounter::FpsCounter(QObject *parent) : QObject(parent), m_counterTimer(0), m_rendered(0), m_skipped(0) {}
 
 FpsCounter::~FpsCounter() {}
 
@@ -21,25 +21,25 @@ void FpsCounter::stop()
 
 bool FpsCounter::isStarted()
 {
-    return m_counterTimer;
+    return m_counterTimer.load(std::memory_order_relaxed) != 0;
 }
 
 void FpsCounter::addRenderedFrame()
 {
-    m_rendered++;
+    m_rendered.fetch_add(1, std::memory_order_relaxed);
 }
 
 void FpsCounter::addSkippedFrame()
 {
-    m_skipped++;
+    m_skipped.fetch_add(1, std::memory_order_relaxed);
 }
 
 void FpsCounter::timerEvent(QTimerEvent *event)
 {
-    if (event && m_counterTimer == event->timerId()) {
-        m_curRendered = m_rendered;
-        m_curSkipped = m_skipped;
-        resetCounter();
+    if (event && m_counterTimer.load(std::memory_order_relaxed) == event->timerId()) {
+        // 读取并清零，避免丢失两次读取之间累加的帧
+        m_curRendered = m_rendered.exchange(0, std::memory_order_relaxed);
+        m_curSkipped = m_skipped.exchange(0, std::memory_order_relaxed);
         emit updateFPS(m_curRendered);
         //qInfo("FPS:%d Discard:%d", m_curRendered, m_skipped);
     }
@@ -53,14 +53,14 @@ void FpsCounter::startCounterTimer()
 
 void FpsCounter::stopCounterTimer()
 {
-    if (m_counterTimer) {
-        killTimer(m_counterTimer);
-        m_counterTimer = 0;
+    qint32 timer = m_counterTimer.exchange(0);
+    if (timer) {
+        killTimer(timer);
     }
 }
 
 void FpsCounter::resetCounter()
 {
-    m_rendered = 0;
-    m_skipped = 0;
+    m_rendered.store(0, std::memory_order_relaxed);
+    m_skipped.store(0, std::memory_order_relaxed);
 }
@@ -2,6 +2,8 @@
 #define FPSCOUNTER_H
 #include <QObject>
 
+#include <atomic>
+
 class FpsCounter : public QObject
 {
     Q_OBJECT
@@ -27,12 +29,13 @@ private:
     void resetCounter();
 
 private:
-    qint32 m_counterTimer = 0;
+    // 计数在解码/渲染线程累加，在本对象所在线程的定时器中读取清零
+    std::atomic<qint32> m_counterTimer;
     quint32 m_curRendered = 0;
     quint32 m_curSkipped = 0;
 
-    quint32 m_rendered = 0;
-    quint32 m_skipped = 0;
+    std::atomic<quint32> m_rendered;
+    std::atomic<quint32> m_skipped;
 };
 
 #endif // FPSCOUNTER_H
@@ -0,0 +1,228 @@
+#include <QDebug>
+
+#include <cstring>
+#include <new>
+
+#include "framechangedetector.h"
+
+// 静止画面最多每隔这么久重新分发一次
+#define CHANGE_REFRESH_MS 250
+// 比较块的边长（Y平面像素），8的倍数
+#define CHANGE_BLOCK_SIZE 64
+// 变化面积超过这个比例时整帧上传
+#define CHANGE_FULL_RATIO 0.5
+
+static qsc::FrameRect makeRect(int x, int y, int width, int height)
+{
+    qsc::FrameRect rect;
+    rect.x = x;
+    rect.y = y;
+    rect.width = width;
+    rect.height = height;
+    return rect;
+}
+
+FrameChangeDetector::FrameChangeDetector() : m_elided(0), m_partial(0)
+{
+    m_metaPool = av_buffer_pool_init(static_cast<int>(sizeof(FrameMeta)), Q_NULLPTR);
+}
+
+FrameChangeDetector::~FrameChangeDetector()
+{
+    if (m_metaPool) {
+        // 仍挂在帧上的FrameMeta释放时归还
+        av_buffer_pool_uninit(&m_metaPool);
+    }
+}
+
+void FrameChangeDetector::reset()
+{
+    m_width = 0;
+    m_height = 0;
+    m_sinceRefresh.invalidate();
+}
+
+const FrameMeta *FrameChangeDetector::meta(const AVFrame *frame)
+{
+    if (!frame || !frame->opaque_ref || static_cast<size_t>(frame->opaque_ref->size) < sizeof(FrameMeta)) {
+        return Q_NULLPTR;
+    }
+    return reinterpret_cast<const FrameMeta *>(frame->opaque_ref->data);
+}
+
+bool FrameChangeDetector::update(AVFrame *frame)
+{
+    const int width = frame->width;
+    const int height = frame->height;
+    const bool sameSize = width == m_width && height == m_height;
+    if (!sameSize) {
+        m_width = width;
+        m_height = height;
+        m_cols = (width + CHANGE_BLOCK_SIZE - 1) / CHANGE_BLOCK_SIZE;
+        m_rows = (height + CHANGE_BLOCK_SIZE - 1) / CHANGE_BLOCK_SIZE;
+        m_prevBlocks.assign(static_cast<size_t>(m_cols) * m_rows, 0);
+    }
+    m_blocks.resize(static_cast<size_t>(m_cols) * m_rows);
+    hashBlocks(frame->data[0], frame->linesize[0], width, height);
+
+    const bool unchanged = sameSize && m_contentId > 0 && m_blocks == m_prevBlocks;
+    qsc::FrameRect rects[FRAME_MAX_DIRTY_RECTS];
+    int rectCount = 0;
+    if (unchanged) {
+        m_elided++;
+    } else {
+        if (sameSize && m_contentId > 0) {
+            rectCount = collectRects(width, height, rects);
+            if (rectCount > 0) {
+                m_partial++;
+            }
+        }
+        m_blocks.swap(m_prevBlocks);
+        m_contentId++;
+        m_sinceRefresh.start();
+    }
+
+    av_buffer_unref(&frame->opaque_ref);
+    frame->opaque_ref = m_metaPool ? av_buffer_pool_get(m_metaPool) : Q_NULLPTR;
+    if (frame->opaque_ref) {
+        FrameMeta *meta = new (frame->opaque_ref->data) FrameMeta;
+        meta->contentId = m_contentId;
+        meta->rectCount = rectCount;
+        for (int i = 0; i < rectCount; ++i) {
+            meta->rects[i] = rects[i];
+        }
+    }
+    return unchanged;
+}
+
+bool FrameChangeDetector::refreshDue()
+{
+    if (m_sinceRefresh.isValid() && m_sinceRefresh.elapsed() < CHANGE_REFRESH_MS) {
+        return false;
+    }
+    m_sinceRefresh.start();
+    return true;
+}
+
+void FrameChangeDetector::hashBlocks(const uint8_t *data, int linesize, int width, int height)
+{
+    // 每块一个累加器，同一行里各块互不依赖；只用于和上一帧比较，不需要抗碰撞
+    const quint64 prime = 0x9E3779B97F4A7C15ULL;
+    const int fullCols = width / CHANGE_BLOCK_SIZE;
+    const int tailBytes = width - fullCols * CHANGE_BLOCK_SIZE;
+    for (int row = 0; row < m_rows; ++row) {
+        quint64 *acc = m_blocks.data() + static_cast<size_t>(row) * m_cols;
+        for (int col = 0; col < m_cols; ++col) {
+            acc[col] = static_cast<quint64>(row * m_cols + col + 1);
+        }
+        const int yEnd = qMin(height, (row + 1) * CHANGE_BLOCK_SIZE);
+        for (int y = row * CHANGE_BLOCK_SIZE; y < yEnd; ++y) {
+            const uint8_t *line = data + static_cast<qptrdiff>(y) * linesize;
+            for (int col = 0; col < fullCols; ++col) {
+                const uint8_t *block = line + col * CHANGE_BLOCK_SIZE;
+                quint64 h = acc[col];
+                for (int i = 0; i < CHANGE_BLOCK_SIZE; i += 8) {
+                    quint64 word;
+                    memcpy(&word, block + i, sizeof(word));
+                    h = (h ^ word) * prime;
+                }
+                acc[col] = h;
+            }
+            if (tailBytes) {
+                quint64 h = acc[fullCols];
+                const uint8_t *block = line + fullCols * CHANGE_BLOCK_SIZE;
+                int i = 0;
+                for (; i + 8 <= tailBytes; i += 8) {
+                    quint64 word;
+                    memcpy(&word, block + i, sizeof(word));
+                    h = (h ^ word) * prime;
+                }
+                if (i < tailBytes) {
+                    quint64 word = 0;
+                    memcpy(&word, block + i, static_cast<size_t>(tailBytes - i));
+                    h = (h ^ word) * prime;
+                }
+                acc[fullCols] = h;
+            }
+        }
+    }
+}
+
+int FrameChangeDetector::collectRects(int width, int height, qsc::FrameRect *rects)
+{
+    // 每行块中连续变化的块合并成一段，和上一行相同跨度的段向下延伸
+    int count = 0;
+    bool overflow = false;
+    qint64 dirtyBlocks = 0;
+    int minCol = m_cols, maxCol = -1, minRow = m_rows, maxRow = -1;
+    // 上一行每个矩形的起始列和结束列，用于纵向合并
+    int open[FRAME_MAX_DIRTY_RECTS];
+    int openCount = 0;
+    for (int row = 0; row < m_rows; ++row) {
+        const size_t base = static_cast<size_t>(row) * m_cols;
+        int nextOpen[FRAME_MAX_DIRTY_RECTS];
+        int nextOpenCount = 0;
+        int col = 0;
+        while (col < m_cols) {
+            if (m_blocks[base + col] == m_prevBlocks[base + col]) {
+                ++col;
+                continue;
+            }
+            const int start = col;
+            while (col < m_cols && m_blocks[base + col] != m_prevBlocks[base + col]) {
+                ++col;
+            }
+            dirtyBlocks += col - start;
+            minCol = qMin(minCol, start);
+            maxCol = qMax(maxCol, col - 1);
+            minRow = qMin(minRow, row);
+            maxRow = qMax(maxRow, row);
+            if (overflow) {
+                continue;
+            }
+
+            int merged = -1;
+            for (int i = 0; i < openCount; ++i) {
+                const qsc::FrameRect &r = rects[open[i]];
+                if (r.x == start && r.width == col - start) {
+                    merged = open[i];
+                    break;
+                }
+            }
+            if (merged >= 0) {
+                rects[merged].height++;
+                nextOpen[nextOpenCount++] = merged;
+            } else if (count < FRAME_MAX_DIRTY_RECTS && nextOpenCount < FRAME_MAX_DIRTY_RECTS) {
+                // 先以块为单位记录，最后换算成像素
+                rects[count] = makeRect(start, row, col - start, 1);
+                nextOpen[nextOpenCount++] = count++;
+            } else {
+                overflow = true;
+            }
+        }
+        memcpy(open, nextOpen, sizeof(int) * static_cast<size_t>(nextOpenCount));
+        openCount = nextOpenCount;
+    }
+
+    if (dirtyBlocks == 0 || dirtyBlocks > CHANGE_FULL_RATIO * m_cols * m_rows) {
+        return 0;
+    }
+    if (overflow) {
+        // 矩形太多时退化为包围盒
+        rects[0] = makeRect(minCol, minRow, maxCol - minCol + 1, maxRow - minRow + 1);
+        count = 1;
+        if (rects[0].width * rects[0].height > CHANGE_FULL_RATIO * m_cols * m_rows) {
+            return 0;
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        qsc::FrameRect &r = rects[i];
+        const int x = r.x * CHANGE_BLOCK_SIZE;
+        const int y = r.y * CHANGE_BLOCK_SIZE;
+        r.width = qMin(width, (r.x + r.width) * CHANGE_BLOCK_SIZE) - x;
+        r.height = qMin(height, (r.y + r.height) * CHANGE_BLOCK_SIZE) - y;
+        r.x = x;
+        r.y = y;
+    }
+    return count;
+}
@@ -0,0 +1,74 @@
+#ifndef FRAMECHANGEDETECTOR_H
+#define FRAMECHANGEDETECTOR_H
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+#include <atomic>
+#include <vector>
+
+#include "QtScrcpyCoreDef.h"
+
+extern "C"
+{
+#include "libavutil/buffer.h"
+#include "libavutil/frame.h"
+}
+
+#define FRAME_MAX_DIRTY_RECTS 16
+
+// 随AVFrame::opaque_ref传递的帧信息，av_frame_ref会一起引用
+struct FrameMeta
+{
+    quint64 contentId = 0;
+    // 相对contentId-1的变化区域，0表示整帧
+    int rectCount = 0;
+    qsc::FrameRect rects[FRAME_MAX_DIRTY_RECTS];
+};
+
+// 解码输出的画面变化检测，只在解码线程中调用update
+// Y平面按块哈希（每块64位），与上一帧逐块比较：
+// - 所有块都相同时画面未变化，内容id不变；息屏、桌面等静止画面
+//   （例如repeat-previous-frame-after重复发送的帧）据此跳过分发、转换和上传
+// - 否则变化的块合并成少量矩形随帧传递，渲染端只上传这些区域；
+//   变化面积超过阈值时不带矩形（整帧上传更便宜）
+class FrameChangeDetector
+{
+public:
+    FrameChangeDetector();
+    ~FrameChangeDetector();
+
+    // 检测并把FrameMeta挂到frame->opaque_ref上，返回true表示画面与上一帧相同
+    bool update(AVFrame *frame);
+    // 画面内容id，内容变化时递增，从1开始
+    quint64 contentId() const { return m_contentId; }
+    // 内容相同的帧仍需按这个间隔分发一次：被观察者按帧率跳过的最后一个变化帧需要补发，
+    // 规格变化（例如显示区域缩放）的观察者也靠它收到新尺寸的帧
+    bool refreshDue();
+    void reset();
+
+    quint64 elidedFrames() const { return m_elided.load(); }
+    quint64 partialFrames() const { return m_partial.load(); }
+
+    // frame上的FrameMeta，没有时返回空
+    static const FrameMeta *meta(const AVFrame *frame);
+
+private:
+    void hashBlocks(const uint8_t *data, int linesize, int width, int height);
+    int collectRects(int width, int height, qsc::FrameRect *rects);
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    int m_cols = 0;
+    int m_rows = 0;
+    std::vector<quint64> m_blocks;
+    std::vector<quint64> m_prevBlocks;
+    quint64 m_contentId = 0;
+    AVBufferPool *m_metaPool = Q_NULLPTR;
+    QElapsedTimer m_sinceRefresh;
+    std::atomic<quint64> m_elided;
+    std::atomic<quint64> m_partial;
+};
+
+#endif // FRAMECHANGEDETECTOR_H
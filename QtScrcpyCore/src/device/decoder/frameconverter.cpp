@@ -0,0 +1,236 @@
+#include <QDebug>
+#include <QMutexLocker>
+
+#include "frameconverter.h"
+
+extern "C"
+{
+#include "libavutil/buffer.h"
+#include "libavutil/imgutils.h"
+#include "libswscale/swscale.h"
+}
+
+// 一段时间没有观察者请求的规格被回收
+#define CONVERTER_ENTRY_EXPIRE_MS 2000
+#define CONVERTER_ALIGN 32
+
+struct FrameConverter::Entry
+{
+    qsc::FramePixelFormat format = qsc::PF_I420;
+    int width = 0;
+    int height = 0;
+    qint64 lastUsedMs = 0;
+
+    // 以下成员由mutex保护
+    QMutex mutex;
+    struct SwsContext *sws = Q_NULLPTR;
+    AVBufferPool *pool = Q_NULLPTR;
+    int poolSize = 0;
+    // 最近一次转换的源帧，按平面地址和PTS识别（不同线程可能持有同一帧的不同引用），
+    // 画面内容相同的帧直接复用上一次的结果
+    const uint8_t *srcData = Q_NULLPTR;
+    qint64 srcPts = -1;
+    quint64 srcContentId = 0;
+    qsc::FrameBufferPtr result;
+
+    ~Entry()
+    {
+        if (sws) {
+            sws_freeContext(sws);
+        }
+        if (pool) {
+            // 仍被观察者持有的缓冲在释放时归还，最后一个归还后池才真正释放
+            av_buffer_pool_uninit(&pool);
+        }
+    }
+};
+
+static AVPixelFormat toAVPixelFormat(qsc::FramePixelFormat format)
+{
+    switch (format) {
+    case qsc::PF_NV12:
+        return AV_PIX_FMT_NV12;
+    case qsc::PF_ARGB:
+        // libyuv的ARGB在内存中是B,G,R,A
+        return AV_PIX_FMT_BGRA;
+    case qsc::PF_RGBA:
+        return AV_PIX_FMT_RGBA;
+    default:
+        return AV_PIX_FMT_YUV420P;
+    }
+}
+
+void FrameConverter::scaleRects(const std::vector<qsc::FrameRect> &rects, int srcWidth, int srcHeight, qsc::FrameBuffer &out)
+{
+    out.dirtyRects.clear();
+    if (rects.empty() || srcWidth <= 0 || srcHeight <= 0) {
+        return;
+    }
+    // 向外取整，缩放滤波会读到相邻像素，再多扩一个像素；色度格式按2对齐
+    const int align = (out.format == qsc::PF_I420 || out.format == qsc::PF_NV12) ? 2 : 1;
+    out.dirtyRects.reserve(rects.size());
+    for (const qsc::FrameRect &r : rects) {
+        int x0 = static_cast<int>(static_cast<qint64>(r.x) * out.width / srcWidth) - 1;
+        int y0 = static_cast<int>(static_cast<qint64>(r.y) * out.height / srcHeight) - 1;
+        int x1 = static_cast<int>((static_cast<qint64>(r.x + r.width) * out.width + srcWidth - 1) / srcWidth) + 1;
+        int y1 = static_cast<int>((static_cast<qint64>(r.y + r.height) * out.height + srcHeight - 1) / srcHeight) + 1;
+        x0 = qMax(0, x0 / align * align);
+        y0 = qMax(0, y0 / align * align);
+        x1 = qMin(out.width, (x1 + align - 1) / align * align);
+        y1 = qMin(out.height, (y1 + align - 1) / align * align);
+        if (x1 <= x0 || y1 <= y0) {
+            continue;
+        }
+        qsc::FrameRect scaled;
+        scaled.x = x0;
+        scaled.y = y0;
+        scaled.width = x1 - x0;
+        scaled.height = y1 - y0;
+        out.dirtyRects.push_back(scaled);
+    }
+}
+
+FrameConverter::FrameConverter() : m_conversions(0), m_hits(0)
+{
+    m_clock.start();
+}
+
+FrameConverter::~FrameConverter() {}
+
+quint64 FrameConverter::conversions() const
+{
+    return m_conversions.load();
+}
+
+quint64 FrameConverter::hits() const
+{
+    return m_hits.load();
+}
+
+qsc::FrameBufferPtr FrameConverter::convert(const qsc::FrameBufferPtr &frame, const qsc::FrameFormat &format)
+{
+    if (!frame || frame->format != qsc::PF_I420) {
+        return frame;
+    }
+
+    int width = frame->width;
+    int height = frame->height;
+    if (format.width > 0 && format.height > 0) {
+        width = format.width;
+        height = format.height;
+        if (format.format == qsc::PF_I420 || format.format == qsc::PF_NV12) {
+            // 色度平面按2x2采样
+            width = qMax(2, width & ~1);
+            height = qMax(2, height & ~1);
+        }
+    }
+    if (format.format == qsc::PF_I420 && width == frame->width && height == frame->height) {
+        return frame;
+    }
+
+    std::shared_ptr<Entry> e = entry(format.format, width, height);
+    QMutexLocker locker(&e->mutex);
+    if (e->result && ((e->srcData == frame->data[0] && e->srcPts == frame->pts)
+                      || (frame->contentId && e->srcContentId == frame->contentId))) {
+        m_hits++;
+        return e->result;
+    }
+    qsc::FrameBufferPtr result = convertEntry(*e, frame);
+    if (result) {
+        m_conversions++;
+        e->srcData = frame->data[0];
+        e->srcPts = frame->pts;
+        e->srcContentId = frame->contentId;
+        e->result = result;
+    }
+    return result;
+}
+
+std::shared_ptr<FrameConverter::Entry> FrameConverter::entry(qsc::FramePixelFormat format, int width, int height)
+{
+    QMutexLocker locker(&m_mutex);
+    const qint64 nowMs = m_clock.elapsed();
+    std::shared_ptr<Entry> found;
+    for (int i = m_entries.size() - 1; i >= 0; --i) {
+        const std::shared_ptr<Entry> &e = m_entries[i];
+        if (e->format == format && e->width == width && e->height == height) {
+            found = e;
+            e->lastUsedMs = nowMs;
+        } else if (nowMs - e->lastUsedMs > CONVERTER_ENTRY_EXPIRE_MS) {
+            // 正在转换的线程持有自己的引用
+            m_entries.removeAt(i);
+        }
+    }
+    if (!found) {
+        found = std::make_shared<Entry>();
+        found->format = format;
+        found->width = width;
+        found->height = height;
+        found->lastUsedMs = nowMs;
+        m_entries.append(found);
+        qInfo("frame converter: new format %d %dx%d, %d in use", format, width, height, m_entries.size());
+    }
+    return found;
+}
+
+qsc::FrameBufferPtr FrameConverter::convertEntry(Entry &e, const qsc::FrameBufferPtr &frame)
+{
+    // called with e.mutex locked
+    const AVPixelFormat dstFormat = toAVPixelFormat(e.format);
+    // 缩小时用区域平均，画面细节（文字）更稳定
+    const int flags = (e.width < frame->width || e.height < frame->height) ? SWS_AREA : SWS_BILINEAR;
+    e.sws = sws_getCachedContext(e.sws, frame->width, frame->height, AV_PIX_FMT_YUV420P,
+                                 e.width, e.height, dstFormat, flags, Q_NULLPTR, Q_NULLPTR, Q_NULLPTR);
+    if (!e.sws) {
+        qCritical("Could not init frame conversion");
+        return qsc::FrameBufferPtr();
+    }
+
+    const int size = av_image_get_buffer_size(dstFormat, e.width, e.height, CONVERTER_ALIGN);
+    if (size <= 0) {
+        return qsc::FrameBufferPtr();
+    }
+    if (!e.pool || e.poolSize != size) {
+        if (e.pool) {
+            av_buffer_pool_uninit(&e.pool);
+        }
+        e.pool = av_buffer_pool_init(size, Q_NULLPTR);
+        e.poolSize = e.pool ? size : 0;
+        if (!e.pool) {
+            qCritical("Could not create conversion pool");
+            return qsc::FrameBufferPtr();
+        }
+    }
+
+    AVBufferRef *buffer = av_buffer_pool_get(e.pool);
+    if (!buffer) {
+        return qsc::FrameBufferPtr();
+    }
+    std::shared_ptr<qsc::FrameBuffer> out = std::make_shared<qsc::FrameBuffer>();
+    out->holder = std::shared_ptr<AVBufferRef>(buffer, [](AVBufferRef *ref) {
+        av_buffer_unref(&ref);
+    });
+
+    uint8_t *dstData[4] = { Q_NULLPTR, Q_NULLPTR, Q_NULLPTR, Q_NULLPTR };
+    int dstLinesize[4] = { 0, 0, 0, 0 };
+    if (av_image_fill_arrays(dstData, dstLinesize, buffer->data, dstFormat, e.width, e.height, CONVERTER_ALIGN) < 0) {
+        return qsc::FrameBufferPtr();
+    }
+    const uint8_t *const srcData[4] = { frame->data[0], frame->data[1], frame->data[2], Q_NULLPTR };
+    const int srcLinesize[4] = { frame->linesize[0], frame->linesize[1], frame->linesize[2], 0 };
+    sws_scale(e.sws, srcData, srcLinesize, 0, frame->height, dstData, dstLinesize);
+
+    out->format = e.format;
+    out->width = e.width;
+    out->height = e.height;
+    out->sourceWidth = frame->sourceWidth;
+    out->sourceHeight = frame->sourceHeight;
+    out->pts = frame->pts;
+    out->contentId = frame->contentId;
+    scaleRects(frame->dirtyRects, frame->width, frame->height, *out);
+    for (int i = 0; i < 3; ++i) {
+        out->data[i] = dstData[i];
+        out->linesize[i] = dstLinesize[i];
+    }
+    return out;
+}
@@ -0,0 +1,45 @@
+#ifndef FRAMECONVERTER_H
+#define FRAMECONVERTER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+
+#include <atomic>
+#include <memory>
+
+#include "QtScrcpyCoreDef.h"
+
+// 观察者请求的帧格式转换，按(格式, 尺寸)缓存每一帧的转换结果：
+// 同一设备上请求相同规格的观察者，不论在哪个线程接收，每帧只转换一次并共享结果
+// 不同规格可以在不同线程上并行转换，同一规格串行（后到的直接命中缓存）
+class FrameConverter
+{
+public:
+    FrameConverter();
+    ~FrameConverter();
+
+    // 返回按format转换后的帧，与源帧规格相同时直接返回源帧，失败返回空
+    // frame必须是解码器输出的PF_I420帧
+    qsc::FrameBufferPtr convert(const qsc::FrameBufferPtr &frame, const qsc::FrameFormat &format);
+
+    // 实际执行的转换次数和命中缓存的次数
+    quint64 conversions() const;
+    quint64 hits() const;
+
+private:
+    struct Entry;
+    std::shared_ptr<Entry> entry(qsc::FramePixelFormat format, int width, int height);
+    qsc::FrameBufferPtr convertEntry(Entry &entry, const qsc::FrameBufferPtr &frame);
+    // 把源帧的变化区域换算到out的尺寸
+    static void scaleRects(const std::vector<qsc::FrameRect> &rects, int srcWidth, int srcHeight, qsc::FrameBuffer &out);
+
+private:
+    QMutex m_mutex;
+    QList<std::shared_ptr<Entry>> m_entries;
+    QElapsedTimer m_clock;
+    std::atomic<quint64> m_conversions;
+    std::atomic<quint64> m_hits;
+};
+
+#endif // FRAMECONVERTER_H
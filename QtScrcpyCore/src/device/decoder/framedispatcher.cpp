@@ -0,0 +1,295 @@
+#include <QDebug>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include "frameconverter.h"
+#include "framedispatcher.h"
+#include "framepool.h"
+#include "latencytracker.h"
+
+namespace {
+
+class SinkTask : public QRunnable
+{
+public:
+    explicit SinkTask(std::function<void()> func) : m_func(func) {}
+    void run() override { m_func(); }
+
+private:
+    std::function<void()> m_func;
+};
+
+class ConversionPool : public QThreadPool
+{
+public:
+    ConversionPool()
+    {
+        setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+        setExpiryTimeout(-1);
+    }
+};
+
+}
+
+struct FrameDispatcher::Sink
+{
+    qsc::DeviceObserver *observer = Q_NULLPTR;
+    qsc::FrameAffinity affinity = qsc::FA_GUI_THREAD;
+    QSharedPointer<LatencyTracker> latency;
+    FrameConverter *converter = Q_NULLPTR;
+
+    // 以下成员由mutex保护
+    QMutex mutex;
+    QWaitCondition idleCond;
+    // 等待转换线程处理的最新一帧
+    qsc::FrameBufferPtr pending;
+    // 已投递到线程池
+    bool scheduled = false;
+    // 正在调用onFrame，busyThread为调用所在的线程
+    bool busy = false;
+    QThread *busyThread = Q_NULLPTR;
+    bool removed = false;
+    quint64 delivered = 0;
+    quint64 dropped = 0;
+    // 按观察者的maxFps跳过或画面未变化的帧，只在deliver中访问
+    quint64 throttled = 0;
+    FrameGate gate;
+};
+
+FrameDispatcher::FrameDispatcher() : m_count(0) {}
+
+FrameDispatcher::~FrameDispatcher()
+{
+    QList<std::shared_ptr<Sink>> sinks;
+    {
+        QMutexLocker locker(&m_mutex);
+        sinks = m_sinks;
+    }
+    for (const auto &sink : sinks) {
+        removeObserver(sink->observer);
+    }
+}
+
+QThreadPool *FrameDispatcher::conversionPool()
+{
+    static ConversionPool pool;
+    return &pool;
+}
+
+void FrameDispatcher::addObserver(qsc::DeviceObserver *observer, qsc::FrameAffinity affinity,
+                                  const qsc::FrameBufferPtr &latest)
+{
+    if (!observer || affinity == qsc::FA_GUI_THREAD) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    for (const auto &sink : m_sinks) {
+        if (sink->observer == observer) {
+            sink->affinity = affinity;
+            return;
+        }
+    }
+    std::shared_ptr<Sink> sink(new Sink);
+    sink->observer = observer;
+    sink->affinity = affinity;
+    sink->latency = m_latency;
+    sink->converter = m_converter;
+    m_sinks.append(sink);
+    m_count = m_sinks.size();
+
+    // 解码线程上的观察者不能在这里调用
+    if (latest && affinity == qsc::FA_WORKER_POOL) {
+        QMutexLocker sinkLocker(&sink->mutex);
+        sink->pending = latest;
+        sink->scheduled = true;
+        post(sink);
+    }
+}
+
+void FrameDispatcher::removeObserver(qsc::DeviceObserver *observer)
+{
+    std::shared_ptr<Sink> sink;
+    {
+        // 持有m_mutex时dispatch不会运行，解码线程上的观察者在这之后不会再被调用
+        QMutexLocker locker(&m_mutex);
+        for (int i = 0; i < m_sinks.size(); ++i) {
+            if (m_sinks[i]->observer == observer) {
+                sink = m_sinks.takeAt(i);
+                break;
+            }
+        }
+        m_count = m_sinks.size();
+    }
+    if (!sink) {
+        return;
+    }
+
+    QMutexLocker locker(&sink->mutex);
+    sink->removed = true;
+    sink->pending.reset();
+    if (sink->busy && sink->busyThread == QThread::currentThread()) {
+        // 在onFrame中注销自己：不能等待自己返回，之后不会再调用它，onFrame返回后Sink随最后一个引用释放
+        return;
+    }
+    // 等待正在进行的onFrame返回，已投递但未开始的任务会直接退出
+    while (sink->busy) {
+        sink->idleCond.wait(&sink->mutex);
+    }
+    qInfo("frame observer removed: delivered %llu dropped %llu throttled %llu", sink->delivered, sink->dropped, sink->throttled);
+}
+
+void FrameDispatcher::setLatencyTracker(QSharedPointer<LatencyTracker> tracker)
+{
+    QMutexLocker locker(&m_mutex);
+    m_latency = tracker;
+}
+
+void FrameDispatcher::setConverter(FrameConverter *converter)
+{
+    QMutexLocker locker(&m_mutex);
+    m_converter = converter;
+}
+
+bool FrameDispatcher::isEmpty() const
+{
+    return m_count.load() == 0;
+}
+
+void FrameDispatcher::dispatch(const AVFrame *frame)
+{
+    if (isEmpty() || !frame) {
+        return;
+    }
+
+    // 在锁内只复制观察者列表，onFrame在锁外调用，观察者可以在其中注销自己或者等待其他线程
+    QList<std::shared_ptr<Sink>> sinks;
+    QList<qsc::FrameAffinity> affinities;
+    {
+        QMutexLocker locker(&m_mutex);
+        sinks = m_sinks;
+        for (const auto &sink : m_sinks) {
+            affinities.append(sink->affinity);
+        }
+    }
+    if (sinks.isEmpty()) {
+        return;
+    }
+    const qsc::FrameBufferPtr buffer = FramePool::refFrame(frame);
+    if (!buffer) {
+        return;
+    }
+    for (int i = 0; i < sinks.size(); ++i) {
+        const std::shared_ptr<Sink> &sink = sinks[i];
+        if (affinities[i] == qsc::FA_DECODE_THREAD) {
+            {
+                QMutexLocker sinkLocker(&sink->mutex);
+                if (sink->removed) {
+                    continue;
+                }
+                if (sink->busy) {
+                    // 刚从线程池切换过来，上一帧还在处理，保持onFrame串行
+                    sink->dropped++;
+                    continue;
+                }
+                sink->busy = true;
+                sink->busyThread = QThread::currentThread();
+            }
+
+            const bool delivered = deliver(sink, buffer);
+
+            QMutexLocker sinkLocker(&sink->mutex);
+            sink->busy = false;
+            sink->busyThread = Q_NULLPTR;
+            if (delivered) {
+                sink->delivered++;
+            }
+            if (sink->removed) {
+                sink->idleCond.wakeAll();
+            }
+            continue;
+        }
+
+        QMutexLocker sinkLocker(&sink->mutex);
+        if (sink->removed) {
+            continue;
+        }
+        if (sink->pending) {
+            // 上一帧还没被处理，直接替换
+            sink->dropped++;
+        }
+        sink->pending = buffer;
+        if (!sink->scheduled) {
+            sink->scheduled = true;
+            post(sink);
+        }
+    }
+}
+
+void FrameDispatcher::post(const std::shared_ptr<Sink> &sink)
+{
+    conversionPool()->start(new SinkTask([sink]() {
+        runSink(sink);
+    }));
+}
+
+void FrameDispatcher::runSink(const std::shared_ptr<Sink> &sink)
+{
+    qsc::FrameBufferPtr frame;
+    {
+        QMutexLocker locker(&sink->mutex);
+        if (sink->removed || !sink->pending) {
+            sink->scheduled = false;
+            return;
+        }
+        frame.swap(sink->pending);
+        sink->busy = true;
+        sink->busyThread = QThread::currentThread();
+    }
+
+    const bool delivered = deliver(sink, frame);
+    frame.reset();
+
+    QMutexLocker locker(&sink->mutex);
+    sink->busy = false;
+    sink->busyThread = Q_NULLPTR;
+    if (delivered) {
+        sink->delivered++;
+    }
+    if (sink->removed) {
+        sink->scheduled = false;
+        sink->idleCond.wakeAll();
+    } else if (sink->pending) {
+        // 处理期间又来了新帧，重新排队，让其他观察者也有机会运行
+        post(sink);
+    } else {
+        sink->scheduled = false;
+    }
+}
+
+bool FrameDispatcher::deliver(const std::shared_ptr<Sink> &sink, const qsc::FrameBufferPtr &frame)
+{
+    // frameFormat()和onFrameBuffer在同一线程中串行调用
+    const qsc::FrameFormat format = sink->observer->frameFormat();
+    if (!sink->gate.accept(sink->observer, *frame, format)) {
+        sink->throttled++;
+        return false;
+    }
+    qsc::FrameBufferPtr converted = frame;
+    if (sink->converter) {
+        converted = sink->converter->convert(frame, format);
+        if (!converted) {
+            return false;
+        }
+    }
+    // 同一观察者的onFrame是串行的，framePts不会被并发修改
+    sink->observer->setFramePts(frame->pts);
+    sink->observer->onFrameBuffer(converted);
+    if (sink->latency) {
+        sink->latency->mark(frame->pts, qsc::LS_CONVERT);
+    }
+    return true;
+}
@@ -0,0 +1,68 @@
+#ifndef FRAMEDISPATCHER_H
+#define FRAMEDISPATCHER_H
+
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+
+#include <atomic>
+#include <memory>
+
+#include "QtScrcpyCore.h"
+#include "framegate.h"
+
+extern "C"
+{
+#include "libavutil/frame.h"
+}
+
+class QThreadPool;
+class LatencyTracker;
+class FrameConverter;
+
+// 把解码帧分发给不在GUI线程接收的观察者
+// - FA_DECODE_THREAD：在解码线程中同步调用，调用时不持有分发锁
+// - FA_WORKER_POOL：投递到共享的转换线程池，每个观察者同一时刻最多一个任务，
+//   上一帧还没处理时新帧直接替换它（丢弃旧帧，不排队）
+// 每帧只引用一次解码器缓冲区，所有观察者共享同一个qsc::FrameBufferPtr；
+// 观察者的frameFormat()在投递时经FrameConverter转换，相同规格共享转换结果
+class FrameDispatcher
+{
+public:
+    FrameDispatcher();
+    ~FrameDispatcher();
+
+    // latest不为空时立即投递给新的FA_WORKER_POOL观察者，不必等到下一帧（静止画面可能很久没有新帧）
+    void addObserver(qsc::DeviceObserver *observer, qsc::FrameAffinity affinity,
+                     const qsc::FrameBufferPtr &latest = qsc::FrameBufferPtr());
+    // 返回时该观察者不会再被调用，并且等到正在进行的onFrame返回
+    // 在该观察者自己的onFrame中调用时不等待，本次onFrame返回后不会再调用它
+    void removeObserver(qsc::DeviceObserver *observer);
+    bool isEmpty() const;
+    // 观察者onFrame返回时记录LS_CONVERT，在添加观察者之前设置
+    void setLatencyTracker(QSharedPointer<LatencyTracker> tracker);
+    // 在添加观察者之前设置，converter的生命周期必须长于FrameDispatcher
+    void setConverter(FrameConverter *converter);
+
+    // 在解码线程中调用，需要时引用frame
+    void dispatch(const AVFrame *frame);
+
+    // 所有设备共享的转换线程池
+    static QThreadPool *conversionPool();
+
+private:
+    struct Sink;
+    static void post(const std::shared_ptr<Sink> &sink);
+    static void runSink(const std::shared_ptr<Sink> &sink);
+    // 返回false表示按观察者的maxFps跳过或转换失败
+    static bool deliver(const std::shared_ptr<Sink> &sink, const qsc::FrameBufferPtr &frame);
+
+private:
+    QMutex m_mutex;
+    QList<std::shared_ptr<Sink>> m_sinks;
+    std::atomic<int> m_count;
+    QSharedPointer<LatencyTracker> m_latency;
+    FrameConverter *m_converter = Q_NULLPTR;
+};
+
+#endif // FRAMEDISPATCHER_H
@@ -0,0 +1,39 @@
+#include "framegate.h"
+
+bool FrameGate::accept(qsc::DeviceObserver *observer, const qsc::FrameBuffer &frame, const qsc::FrameFormat &format)
+{
+    if (!format.receiveFrames) {
+        return false;
+    }
+    if (frame.contentId && frame.contentId == m_lastContentId && format.format == m_lastFormat
+        && format.width == m_lastWidth && format.height == m_lastHeight) {
+        observer->m_unchangedFrames.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (format.maxFps > 0 && frame.pts >= 0) {
+        const qint64 intervalUs = 1000000 / format.maxFps;
+        if (format.maxFps != m_cadenceFps || m_nextDuePts < 0 || frame.pts < m_nextDuePts - 2 * intervalUs) {
+            // 帧率限制变化、首帧或PTS回退（重新连接），从这一帧重新计时
+            m_cadenceFps = format.maxFps;
+            m_nextDuePts = frame.pts;
+        }
+        if (frame.pts < m_nextDuePts - intervalUs / 8) {
+            observer->m_decimatedFrames.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_nextDuePts += intervalUs;
+        if (m_nextDuePts <= frame.pts) {
+            // 源帧间隔大于限制（或中间长时间没有帧），不补发
+            m_nextDuePts = frame.pts + intervalUs;
+        }
+    } else {
+        m_cadenceFps = 0;
+        m_nextDuePts = -1;
+    }
+    m_lastContentId = frame.contentId;
+    m_lastFormat = format.format;
+    m_lastWidth = format.width;
+    m_lastHeight = format.height;
+    observer->m_deliveredFrames.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
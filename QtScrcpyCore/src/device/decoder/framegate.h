@@ -0,0 +1,30 @@
+#ifndef FRAMEGATE_H
+#define FRAMEGATE_H
+
+#include "QtScrcpyCore.h"
+
+// 一个设备投递给一个观察者的策略和状态，返回false表示跳过这一帧：
+// - format.receiveFrames为false
+// - 画面和请求的规格（尺寸、像素格式）都与已投递给该观察者的上一帧相同（静止画面）；
+//   规格变化时（例如显示区域缩放）照常投递，观察者才能收到新尺寸的帧
+// - 按format.maxFps抽帧：按PTS维护下一帧的到期时间，每投递一帧到期时间前进一个间隔，
+//   而不是从实际投递的帧重新计时，这样60fps的源限到25fps时得到均匀的25fps，而不是20fps；
+//   容忍1/8间隔的抖动，避免30fps的源在30fps限制下被隔帧丢弃
+// 状态按设备保存，同一观察者注册到多个设备时各设备的PTS互不干扰；结果计入观察者的deliveryStats
+// 只在该观察者的投递线程中访问
+class FrameGate
+{
+public:
+    bool accept(qsc::DeviceObserver *observer, const qsc::FrameBuffer &frame, const qsc::FrameFormat &format);
+
+private:
+    qint64 m_nextDuePts = -1;
+    int m_cadenceFps = 0;
+    quint64 m_lastContentId = 0;
+    // 上一次投递时请求的规格
+    qsc::FramePixelFormat m_lastFormat = qsc::PF_I420;
+    int m_lastWidth = 0;
+    int m_lastHeight = 0;
+};
+
+#endif // FRAMEGATE_H
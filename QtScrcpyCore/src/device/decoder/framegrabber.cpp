@@ -0,0 +1,267 @@
+#include <QBuffer>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QRunnable>
+#include <QTimer>
+
+#include "framegrabber.h"
+
+namespace {
+
+class GrabTask : public QRunnable
+{
+public:
+    explicit GrabTask(std::function<void()> func) : m_func(func) {}
+    void run() override { m_func(); }
+
+private:
+    std::function<void()> m_func;
+};
+
+}
+
+struct FrameGrabber::Burst
+{
+    qsc::ScreenshotParams params;
+    qsc::ScreenshotCallback callback = Q_NULLPTR;
+    QString fileDir;
+    QString filePrefix;
+    int taken = 0;
+    QTimer *timer = Q_NULLPTR;
+};
+
+struct FrameGrabber::Pending
+{
+    qsc::ScreenshotCallback callback = Q_NULLPTR;
+    int index = 0;
+    qsc::ScreenshotFormat format = qsc::SF_PNG;
+    // 已经回调过（结果或者stop时的失败）
+    bool done = false;
+};
+
+FrameGrabber::FrameGrabber(std::function<AVFrame *()> frameSource, QObject *parent)
+    : QObject(parent)
+    , m_frameSource(frameSource)
+{
+    // 单线程保证转换上下文按顺序复用
+    m_pool.setMaxThreadCount(1);
+}
+
+FrameGrabber::~FrameGrabber()
+{
+    stop();
+    m_pool.waitForDone();
+    m_convert.deInit();
+    if (m_rgbFrame) {
+        av_frame_free(&m_rgbFrame);
+    }
+}
+
+void FrameGrabber::grab(const qsc::ScreenshotParams &params, const QString &fileDir, const QString &filePrefix, qsc::ScreenshotCallback callback)
+{
+    Burst *burst = new Burst;
+    burst->params = params;
+    burst->params.burstCount = qMax(1, params.burstCount);
+    burst->callback = callback;
+    burst->fileDir = fileDir;
+    burst->filePrefix = filePrefix;
+
+    if (burst->params.burstCount > 1) {
+        burst->timer = new QTimer(this);
+        burst->timer->setInterval(qMax(0, params.burstIntervalMs));
+        connect(burst->timer, &QTimer::timeout, this, [this, burst]() {
+            capture(burst);
+        });
+        m_bursts.append(burst);
+        burst->timer->start();
+    }
+
+    // 第一帧立即截取
+    capture(burst);
+}
+
+void FrameGrabber::stop()
+{
+    // 先取出再回调，回调中可能重新发起截图
+    const QList<std::shared_ptr<Pending>> pendings = m_pending;
+    m_pending.clear();
+    for (const auto &pending : pendings) {
+        pending->done = true;
+        if (pending->callback) {
+            qsc::ScreenshotResult result;
+            result.index = pending->index;
+            result.format = pending->format;
+            pending->callback(result);
+        }
+    }
+
+    const QList<Burst *> bursts = m_bursts;
+    m_bursts.clear();
+    for (Burst *burst : bursts) {
+        burst->timer->stop();
+        burst->timer->deleteLater();
+        // 未截取的部分以失败结果通知调用方
+        if (burst->callback) {
+            qsc::ScreenshotResult result;
+            result.index = burst->taken;
+            result.format = burst->params.format;
+            burst->callback(result);
+        }
+        delete burst;
+    }
+}
+
+void FrameGrabber::capture(Burst *burst)
+{
+    const int index = burst->taken++;
+    const bool finished = burst->taken >= burst->params.burstCount;
+
+    // 在锁内只做引用计数拷贝
+    AVFrame *frame = m_frameSource ? m_frameSource() : Q_NULLPTR;
+
+    QString filePath;
+    if (burst->params.saveToFile && !burst->fileDir.isEmpty()) {
+        QString fileName = burst->filePrefix + QDateTime::currentDateTime().toString("_yyyyMMdd_hhmmss_zzz");
+        if (burst->params.burstCount > 1) {
+            fileName += QString("_%1").arg(index);
+        }
+        fileName.replace(":", "_");
+        fileName.replace(".", "_");
+        switch (burst->params.format) {
+        case qsc::SF_JPEG:
+            fileName += ".jpg";
+            break;
+        case qsc::SF_RAW:
+            fileName += ".rgb32";
+            break;
+        default:
+            fileName += ".png";
+            break;
+        }
+        filePath = QDir(burst->fileDir).absoluteFilePath(fileName);
+    } else if (burst->params.saveToFile) {
+        qWarning() << "please select record save path!!!";
+    }
+
+    if (frame) {
+        const qsc::ScreenshotParams params = burst->params;
+        std::shared_ptr<Pending> pending(new Pending);
+        pending->callback = burst->callback;
+        pending->index = index;
+        pending->format = params.format;
+        m_pending.append(pending);
+        m_pool.start(new GrabTask([this, frame, params, filePath, pending]() {
+            process(frame, params, filePath, pending);
+        }));
+    } else {
+        qWarning() << "screenshot: no frame available";
+        if (burst->callback) {
+            qsc::ScreenshotResult result;
+            result.index = index;
+            result.format = burst->params.format;
+            burst->callback(result);
+        }
+    }
+
+    if (finished) {
+        if (burst->timer) {
+            m_bursts.removeOne(burst);
+            burst->timer->stop();
+            burst->timer->deleteLater();
+        }
+        delete burst;
+    }
+}
+
+void FrameGrabber::process(AVFrame *frame, const qsc::ScreenshotParams &params, const QString &filePath, const std::shared_ptr<Pending> &pending)
+{
+    qsc::ScreenshotResult result;
+    result.index = pending->index;
+    result.format = params.format;
+    result.width = frame->width;
+    result.height = frame->height;
+
+    QImage image;
+    bool ret = convert(frame, image);
+    av_frame_free(&frame);
+
+    if (ret) {
+        if (params.format == qsc::SF_RAW) {
+            result.data = QByteArray(reinterpret_cast<const char *>(image.constBits()), image.bytesPerLine() * image.height());
+        } else {
+            QBuffer buffer(&result.data);
+            buffer.open(QIODevice::WriteOnly);
+            ret = image.save(&buffer, params.format == qsc::SF_JPEG ? "JPG" : "PNG", params.quality);
+        }
+    }
+
+    if (ret && !filePath.isEmpty()) {
+        QFile file(filePath);
+        ret = file.open(QIODevice::WriteOnly) && file.write(result.data) == result.data.size();
+        if (ret) {
+            result.filePath = filePath;
+            qInfo() << "screenshot save to " << filePath;
+        } else {
+            qWarning() << "screenshot save failed: " << filePath;
+        }
+    }
+    result.success = ret;
+
+    // 回调投递回FrameGrabber所在线程，stop之后到达的结果被丢弃
+    QMetaObject::invokeMethod(this, [this, pending, result]() {
+        if (pending->done) {
+            return;
+        }
+        pending->done = true;
+        m_pending.removeOne(pending);
+        if (pending->callback) {
+            pending->callback(result);
+        }
+    }, Qt::QueuedConnection);
+}
+
+bool FrameGrabber::convert(AVFrame *frame, QImage &image)
+{
+    const int width = frame->width;
+    const int height = frame->height;
+    const AVPixelFormat format = static_cast<AVPixelFormat>(frame->format);
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+
+    // 转换上下文按尺寸和格式缓存，只在变化时重建
+    int srcWidth = 0;
+    int srcHeight = 0;
+    AVPixelFormat srcFormat = AV_PIX_FMT_NONE;
+    m_convert.getSrcFrameInfo(srcWidth, srcHeight, srcFormat);
+    if (!m_convert.isInit() || srcWidth != width || srcHeight != height || srcFormat != format) {
+        m_convert.deInit();
+        m_convert.setSrcFrameInfo(width, height, format);
+        m_convert.setDstFrameInfo(width, height, AV_PIX_FMT_RGB32);
+        if (!m_convert.init()) {
+            qCritical("screenshot: could not init frame convert");
+            return false;
+        }
+    }
+
+    if (!m_rgbFrame) {
+        m_rgbFrame = av_frame_alloc();
+        if (!m_rgbFrame) {
+            return false;
+        }
+    }
+
+    // AV_PIX_FMT_RGB32与QImage::Format_RGB32内存布局一致，直接写入QImage
+    image = QImage(width, height, QImage::Format_RGB32);
+    if (image.isNull()) {
+        return false;
+    }
+    m_rgbFrame->data[0] = image.bits();
+    m_rgbFrame->linesize[0] = image.bytesPerLine();
+    bool ret = m_convert.convert(frame, m_rgbFrame);
+    m_rgbFrame->data[0] = Q_NULLPTR;
+    return ret;
+}
@@ -0,0 +1,53 @@
+#ifndef FRAMEGRABBER_H
+#define FRAMEGRABBER_H
+#include <QObject>
+#include <QThreadPool>
+
+#include <functional>
+#include <memory>
+
+#include "QtScrcpyCoreDef.h"
+#include "avframeconvert.h"
+
+class QImage;
+
+// 异步截图
+// 帧通过frameSource在锁内做引用计数拷贝（av_frame_ref），
+// 格式转换和PNG/JPEG编码在单线程的工作池中完成，不阻塞解码和UI
+class FrameGrabber : public QObject
+{
+    Q_OBJECT
+public:
+    // frameSource返回当前渲染帧的引用，由FrameGrabber负责释放
+    FrameGrabber(std::function<AVFrame *()> frameSource, QObject *parent = Q_NULLPTR);
+    virtual ~FrameGrabber();
+
+    // fileDir/filePrefix: 保存目录和文件名前缀，saveToFile为false时不使用
+    void grab(const qsc::ScreenshotParams &params, const QString &fileDir, const QString &filePrefix, qsc::ScreenshotCallback callback);
+    // 在拥有者开始销毁之前调用，同步回调所有未完成的截图：
+    // - 正在转换/编码的截图以失败结果回调，之后工作线程的结果被丢弃
+    // - 未完成的连拍以一个失败结果（index为第一张未截取的序号）回调
+    // 析构时也会调用；析构不处理事件队列，已投递但还没执行的结果回调不会再触发
+    void stop();
+
+private:
+    struct Burst;
+    struct Pending;
+    void capture(Burst *burst);
+    // 在工作线程中执行
+    void process(AVFrame *frame, const qsc::ScreenshotParams &params, const QString &filePath, const std::shared_ptr<Pending> &pending);
+    bool convert(AVFrame *frame, QImage &image);
+
+private:
+    std::function<AVFrame *()> m_frameSource;
+    QThreadPool m_pool;
+    QList<Burst *> m_bursts;
+    // 已交给工作线程、还没回调的截图，只在FrameGrabber所在线程访问
+    QList<std::shared_ptr<Pending>> m_pending;
+
+    // 以下仅在工作线程中访问，工作池只有一个线程，因此无需加锁
+    AVFrameConvert m_convert;
+    AVFrame *m_rgbFrame = Q_NULLPTR;
+};
+
+#endif // FRAMEGRABBER_H
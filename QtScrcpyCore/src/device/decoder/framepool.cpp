@@ -0,0 +1,188 @@
+#include <QDebug>
+#include <QMutexLocker>
+
+#include "framechangedetector.h"
+#include "framepool.h"
+
+extern "C"
+{
+#include "libavutil/imgutils.h"
+#include "libavutil/pixdesc.h"
+}
+
+// linesize and plane start alignment, enough for AVX-512 and GPU uploads
+#define FRAME_POOL_ALIGN 64
+
+FramePool::FramePool() : m_allocations(0) {}
+
+FramePool::~FramePool()
+{
+    releasePools();
+}
+
+void FramePool::install(AVCodecContext *codecCtx)
+{
+    codecCtx->opaque = this;
+    codecCtx->get_buffer2 = &FramePool::getBuffer;
+}
+
+quint64 FramePool::allocations() const
+{
+    return m_allocations.load();
+}
+
+qsc::FrameBufferPtr FramePool::wrapFrame(AVFrame *frame)
+{
+    if (!frame) {
+        return qsc::FrameBufferPtr();
+    }
+    std::shared_ptr<qsc::FrameBuffer> buffer = std::make_shared<qsc::FrameBuffer>();
+    buffer->width = frame->width;
+    buffer->height = frame->height;
+    buffer->sourceWidth = frame->width;
+    buffer->sourceHeight = frame->height;
+    for (int i = 0; i < 3; ++i) {
+        buffer->data[i] = frame->data[i];
+        buffer->linesize[i] = frame->linesize[i];
+    }
+    buffer->pts = frame->pts;
+    const FrameMeta *meta = FrameChangeDetector::meta(frame);
+    if (meta) {
+        buffer->contentId = meta->contentId;
+        buffer->dirtyRects.assign(meta->rects, meta->rects + meta->rectCount);
+    }
+    buffer->holder = std::shared_ptr<AVFrame>(frame, [](AVFrame *f) {
+        av_frame_free(&f);
+    });
+    return buffer;
+}
+
+qsc::FrameBufferPtr FramePool::refFrame(const AVFrame *frame)
+{
+    if (!frame) {
+        return qsc::FrameBufferPtr();
+    }
+    AVFrame *ref = av_frame_alloc();
+    if (!ref || av_frame_ref(ref, frame) < 0) {
+        av_frame_free(&ref);
+        qCritical("Could not ref frame");
+        return qsc::FrameBufferPtr();
+    }
+    return wrapFrame(ref);
+}
+
+int FramePool::getBuffer(AVCodecContext *codecCtx, AVFrame *frame, int flags)
+{
+    FramePool *pool = static_cast<FramePool *>(codecCtx->opaque);
+    if (pool && codecCtx->codec && (codecCtx->codec->capabilities & AV_CODEC_CAP_DR1)) {
+        if (pool->fillFrame(codecCtx, frame) >= 0) {
+            return 0;
+        }
+    }
+    // hardware or unusual formats
+    return avcodec_default_get_buffer2(codecCtx, frame, flags);
+}
+
+AVBufferRef *FramePool::allocBuffer(void *opaque, QTSCRCPY_LAVU_BUFFER_SIZE_T size)
+{
+    FramePool *pool = static_cast<FramePool *>(opaque);
+    ++pool->m_allocations;
+    // the plane start is aligned to FRAME_POOL_ALIGN in fillFrame
+    return av_buffer_alloc(size);
+}
+
+int FramePool::fillFrame(AVCodecContext *codecCtx, AVFrame *frame)
+{
+    const AVPixelFormat format = static_cast<AVPixelFormat>(frame->format);
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+        return -1;
+    }
+    const int planes = av_pix_fmt_count_planes(format);
+    if (planes <= 0 || planes > 4) {
+        return -1;
+    }
+
+    // the codec may write past the visible size (macroblock padding, edge emulation)
+    int width = frame->width;
+    int height = frame->height;
+    int linesizeAlign[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(codecCtx, &width, &height, linesizeAlign);
+
+    int linesizes[4] = { 0, 0, 0, 0 };
+    int ret = av_image_fill_linesizes(linesizes, format, width);
+    if (ret < 0) {
+        return ret;
+    }
+
+    int sizes[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < planes; ++i) {
+        linesizes[i] = FFALIGN(linesizes[i], FRAME_POOL_ALIGN);
+        const int planeHeight = (i == 1 || i == 2) ? AV_CEIL_RSHIFT(height, desc->log2_chroma_h) : height;
+        // some decoders read 16 bytes past the end of a plane,
+        // the extra FRAME_POOL_ALIGN - 1 bytes leave room to align the plane start below
+        sizes[i] = linesizes[i] * planeHeight + 16 + FRAME_POOL_ALIGN - 1;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!ensurePools(sizes, planes)) {
+        return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < planes; ++i) {
+        frame->buf[i] = av_buffer_pool_get(m_pools[i]);
+        if (!frame->buf[i]) {
+            for (int j = 0; j < i; ++j) {
+                av_buffer_unref(&frame->buf[j]);
+            }
+            return AVERROR(ENOMEM);
+        }
+        // av_malloc only guarantees its own alignment (16/32/64 depending on the build),
+        // align the plane start so that every row is FRAME_POOL_ALIGN aligned
+        frame->data[i] = reinterpret_cast<uint8_t *>(FFALIGN(reinterpret_cast<uintptr_t>(frame->buf[i]->data), static_cast<uintptr_t>(FRAME_POOL_ALIGN)));
+        frame->linesize[i] = linesizes[i];
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+bool FramePool::ensurePools(const int sizes[4], int planes)
+{
+    // called with m_mutex locked
+    bool match = true;
+    for (int i = 0; i < 4; ++i) {
+        const int size = i < planes ? sizes[i] : 0;
+        if (m_poolSizes[i] != size || (size && !m_pools[i])) {
+            match = false;
+            break;
+        }
+    }
+    if (match) {
+        return true;
+    }
+
+    // size or format changed, buffers still referenced by the old pools are
+    // released to them and freed with them
+    releasePools();
+    for (int i = 0; i < planes; ++i) {
+        m_pools[i] = av_buffer_pool_init2(sizes[i], this, &FramePool::allocBuffer, Q_NULLPTR);
+        if (!m_pools[i]) {
+            qCritical("Could not create frame pool");
+            releasePools();
+            return false;
+        }
+        m_poolSizes[i] = sizes[i];
+    }
+    qInfo() << "frame pool plane sizes:" << sizes[0] << (planes > 1 ? sizes[1] : 0) << (planes > 2 ? sizes[2] : 0);
+    return true;
+}
+
+void FramePool::releasePools()
+{
+    for (int i = 0; i < 4; ++i) {
+        if (m_pools[i]) {
+            // freed once the last buffer is returned
+            av_buffer_pool_uninit(&m_pools[i]);
+        }
+        m_poolSizes[i] = 0;
+    }
+}
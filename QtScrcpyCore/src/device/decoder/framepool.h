@@ -0,0 +1,51 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <QMutex>
+
+#include <atomic>
+
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+}
+
+#include "QtScrcpyCoreDef.h"
+#include "compat.h"
+
+// 解码帧缓冲池，作为AVCodecContext的get_buffer2
+// 每个平面一个AVBufferPool，按64字节对齐，尺寸/格式变化时重建；
+// 帧被观察者和渲染线程长期持有时缓冲不会被复用，池会按需增长，
+// 全部引用释放后回到池中
+class FramePool
+{
+public:
+    FramePool();
+    ~FramePool();
+
+    // 安装到codecCtx（使用codecCtx->opaque），在avcodec_open2之前调用
+    void install(AVCodecContext *codecCtx);
+
+    // 新分配的缓冲数（池未命中）
+    quint64 allocations() const;
+
+    // 把解码帧包装为qsc::FrameBuffer，接管frame的所有权，不拷贝像素
+    static qsc::FrameBufferPtr wrapFrame(AVFrame *frame);
+    // 引用frame的缓冲区后包装，失败返回空
+    static qsc::FrameBufferPtr refFrame(const AVFrame *frame);
+
+private:
+    static int getBuffer(AVCodecContext *codecCtx, AVFrame *frame, int flags);
+    static AVBufferRef *allocBuffer(void *opaque, QTSCRCPY_LAVU_BUFFER_SIZE_T size);
+    int fillFrame(AVCodecContext *codecCtx, AVFrame *frame);
+    bool ensurePools(const int sizes[4], int planes);
+    void releasePools();
+
+private:
+    QMutex m_mutex;
+    AVBufferPool *m_pools[4] = { Q_NULLPTR, Q_NULLPTR, Q_NULLPTR, Q_NULLPTR };
+    int m_poolSizes[4] = { 0, 0, 0, 0 };
+    std::atomic<quint64> m_allocations;
+};
+
+#endif // FRAMEPOOL_H
@@ -1,13 +1,27 @@
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
 #include "videobuffer.h"
-#include "avframeconvert.h"
 extern "C"
 {
 #include "libavformat/avformat.h"
 #include "libavutil/avutil.h"
-#include "libavutil/imgutils.h"
 }
 
-VideoBuffer::VideoBuffer(QObject *parent) : QObject(parent) {
+// m_middle中标记中间槽的帧尚未被消费
+#define SLOT_FRESH 0x4
+#define SLOT_INDEX_MASK 0x3
+
+VideoBuffer::VideoBuffer(QObject *parent)
+    : QObject(parent)
+    , m_middle(2)
+    , m_offered(0)
+    , m_consumed(0)
+    , m_skipped(0)
+    , m_totalOfferNs(0)
+    , m_maxOfferNs(0)
+{
     connect(&m_fpsCounter, &FpsCounter::updateFPS, this, &VideoBuffer::updateFPS);
 }
 
@@ -15,49 +29,56 @@ VideoBuffer::~VideoBuffer() {}
 
 bool VideoBuffer::init()
 {
-    m_decodingFrame = av_frame_alloc();
-    if (!m_decodingFrame) {
-        goto error;
-    }
-
-    m_renderingframe = av_frame_alloc();
-    if (!m_renderingframe) {
-        goto error;
+    for (int i = 0; i < 3; ++i) {
+        m_frames[i] = av_frame_alloc();
+        if (!m_frames[i]) {
+            deInit();
+            return false;
+        }
     }
 
-    // there is initially no rendering frame, so consider it has already been
-    // consumed
-    m_renderingFrameConsumed = true;
+    // there is initially no rendering frame, so the middle slot is not fresh
+    m_writeIndex = 0;
+    m_readIndex = 1;
+    m_middle.store(2);
+    m_interrupted = false;
+    m_offered = 0;
+    m_consumed = 0;
+    m_skipped = 0;
+    m_totalOfferNs = 0;
+    m_maxOfferNs = 0;
 
     m_fpsCounter.start();
     return true;
-
-error:
-    deInit();
-    return false;
 }
 
 void VideoBuffer::deInit()
 {
-    if (m_decodingFrame) {
-        av_frame_free(&m_decodingFrame);
-        m_decodingFrame = Q_NULLPTR;
+    if (m_frames[0]) {
+        HandoffStats stats = handoffStats();
+        qInfo("video buffer handoff: offered %llu consumed %llu skipped %llu, offer avg %lld ns max %lld ns",
+              stats.offered, stats.consumed, stats.skipped,
+              stats.offered ? stats.totalOfferNs / static_cast<qint64>(stats.offered) : 0, stats.maxOfferNs);
     }
-    if (m_renderingframe) {
-        av_frame_free(&m_renderingframe);
-        m_renderingframe = Q_NULLPTR;
+
+    QMutexLocker locker(&m_readerMutex);
+    for (int i = 0; i < 3; ++i) {
+        if (m_frames[i]) {
+            av_frame_free(&m_frames[i]);
+            m_frames[i] = Q_NULLPTR;
+        }
     }
     m_fpsCounter.stop();
 }
 
 void VideoBuffer::lock()
 {
-    m_mutex.lock();
+    m_readerMutex.lock();
 }
 
 void VideoBuffer::unLock()
 {
-    m_mutex.unlock();
+    m_readerMutex.unlock();
 }
 
 void VideoBuffer::setRenderExpiredFrames(bool renderExpiredFrames)
@@ -67,108 +88,108 @@ void VideoBuffer::setRenderExpiredFrames(bool renderExpiredFrames)
 
 AVFrame *VideoBuffer::decodingFrame()
 {
-    return m_decodingFrame;
+    return m_frames[m_writeIndex];
 }
 
 void VideoBuffer::offerDecodedFrame(bool &previousFrameSkipped)
 {
-    m_mutex.lock();
+    QElapsedTimer timer;
+    timer.start();
 
     if (m_renderExpiredFrames) {
         // if m_renderExpiredFrames is enable, then the decoder must wait for the current
         // frame to be consumed
-        while (!m_renderingFrameConsumed && !m_interrupted) {
-            m_renderingFrameConsumedCond.wait(&m_mutex);
+        QMutexLocker locker(&m_consumedMutex);
+        while ((m_middle.load(std::memory_order_acquire) & SLOT_FRESH) && !m_interrupted) {
+            m_renderingFrameConsumedCond.wait(&m_consumedMutex);
         }
-    } else {
-        if (m_fpsCounter.isStarted() && !m_renderingFrameConsumed) {
+    }
+
+    // 发布写槽，换回上一个中间槽作为新的写槽
+    // 如果换回的槽仍带FRESH标记，说明它没有被消费，读者已经不会再看到它
+    int previous = m_middle.exchange(m_writeIndex | SLOT_FRESH, std::memory_order_acq_rel);
+    m_writeIndex = previous & SLOT_INDEX_MASK;
+    previousFrameSkipped = previous & SLOT_FRESH;
+
+    if (previousFrameSkipped) {
+        m_skipped.fetch_add(1, std::memory_order_relaxed);
+        if (m_fpsCounter.isStarted()) {
             m_fpsCounter.addSkippedFrame();
         }
     }
+    m_offered.fetch_add(1, std::memory_order_relaxed);
 
-    swap();
-    previousFrameSkipped = !m_renderingFrameConsumed;
-    m_renderingFrameConsumed = false;
-    m_mutex.unlock();
+    qint64 elapsed = timer.nsecsElapsed();
+    m_totalOfferNs.fetch_add(elapsed, std::memory_order_relaxed);
+    qint64 maxNs = m_maxOfferNs.load(std::memory_order_relaxed);
+    while (elapsed > maxNs && !m_maxOfferNs.compare_exchange_weak(maxNs, elapsed, std::memory_order_relaxed)) {
+    }
 }
 
 const AVFrame *VideoBuffer::consumeRenderedFrame()
 {
-    Q_ASSERT(!m_renderingFrameConsumed);
-    m_renderingFrameConsumed = true;
+    if (!(m_middle.load(std::memory_order_acquire) & SLOT_FRESH)) {
+        return Q_NULLPTR;
+    }
+
+    // 取走中间槽，把旧的读槽还回去（不带FRESH标记）
+    int previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+    m_readIndex = previous & SLOT_INDEX_MASK;
+
+    m_consumed.fetch_add(1, std::memory_order_relaxed);
     if (m_fpsCounter.isStarted()) {
         m_fpsCounter.addRenderedFrame();
     }
     if (m_renderExpiredFrames) {
         // if m_renderExpiredFrames is enable, then notify the decoder the current frame is
         // consumed, so that it may push a new one
+        QMutexLocker locker(&m_consumedMutex);
         m_renderingFrameConsumedCond.wakeOne();
     }
-    return m_renderingframe;
+    return m_frames[m_readIndex];
 }
 
-void VideoBuffer::peekRenderedFrame(std::function<void(int width, int height, uint8_t* dataRGB32)> onFrame)
+AVFrame *VideoBuffer::refRenderedFrame()
 {
-    if (!onFrame) {
-        return;
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        return Q_NULLPTR;
     }
 
+    // 读槽只会被读者替换，持有读者锁即可安全引用，不影响解码线程
     lock();
-    auto frame = m_renderingframe;
-    int width = frame->width;
-    int height = frame->height;
-    int linesize = frame->linesize[0];
-
-    // create buffer
-    uint8_t* rgbBuffer = new uint8_t[linesize * height * 4];
-    AVFrame *rgbFrame = av_frame_alloc();
-    if (!rgbFrame) {
-        delete [] rgbBuffer;
-        return;
+    int ret = -1;
+    AVFrame *renderingFrame = m_frames[m_readIndex];
+    if (renderingFrame && renderingFrame->width > 0 && renderingFrame->height > 0) {
+        ret = av_frame_ref(frame, renderingFrame);
     }
-
-    // bind buffer to AVFrame
-    av_image_fill_arrays(rgbFrame->data, rgbFrame->linesize, rgbBuffer, AV_PIX_FMT_RGB32, width, height, 4);
-
-    // convert
-    AVFrameConvert convert;
-    convert.setSrcFrameInfo(width, height, AV_PIX_FMT_YUV420P);
-    convert.setDstFrameInfo(width, height, AV_PIX_FMT_RGB32);
-    bool ret = false;
-    ret = convert.init();
-    if (!ret) {
-        delete [] rgbBuffer;
-        av_free(rgbFrame);
-        return;
-    }
-    ret = convert.convert(frame, rgbFrame);
-    if (!ret) {
-        delete [] rgbBuffer;
-        av_free(rgbFrame);
-        return;
-    }
-    convert.deInit();
-    av_free(rgbFrame);
     unLock();
 
-    onFrame(width, height, rgbBuffer);
-    delete [] rgbBuffer;
+    if (ret < 0) {
+        av_frame_free(&frame);
+        return Q_NULLPTR;
+    }
+    return frame;
 }
 
 void VideoBuffer::interrupt()
 {
     if (m_renderExpiredFrames) {
-        m_mutex.lock();
+        m_consumedMutex.lock();
         m_interrupted = true;
-        m_mutex.unlock();
+        m_consumedMutex.unlock();
         // wake up blocking wait
         m_renderingFrameConsumedCond.wakeOne();
     }
 }
 
-void VideoBuffer::swap()
+VideoBuffer::HandoffStats VideoBuffer::handoffStats() const
 {
-    AVFrame *tmp = m_decodingFrame;
-    m_decodingFrame = m_renderingframe;
-    m_renderingframe = tmp;
+    HandoffStats stats;
+    stats.offered = m_offered.load(std::memory_order_relaxed);
+    stats.consumed = m_consumed.load(std::memory_order_relaxed);
+    stats.skipped = m_skipped.load(std::memory_order_relaxed);
+    stats.totalOfferNs = m_totalOfferNs.load(std::memory_order_relaxed);
+    stats.maxOfferNs = m_maxOfferNs.load(std::memory_order_relaxed);
+    return stats;
 }
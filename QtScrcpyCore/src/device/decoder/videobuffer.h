@@ -5,56 +5,86 @@
 #include <QWaitCondition>
 #include <QObject>
 
-#include <functional>
+#include <atomic>
+
 #include "fpscounter.h"
 
 // forward declarations
 typedef struct AVFrame AVFrame;
 
+// 解码线程与渲染线程之间的三缓冲交接：
+// - 解码线程独占写槽，交付时与中间槽原子交换，永远不会等待读者
+// - 读者取帧时与中间槽原子交换，总是拿到最新的完整帧，不会等待解码线程
+// - 中间槽带"未消费"标记，交付时标记仍在即为跳帧
 class VideoBuffer : public QObject
 {
     Q_OBJECT
 public:
+    // 交接统计，用于对比交接开销
+    struct HandoffStats
+    {
+        quint64 offered = 0;
+        quint64 consumed = 0;
+        // 未被消费就被新帧覆盖的帧数
+        quint64 skipped = 0;
+        // offerDecodedFrame的累计/最大耗时
+        qint64 totalOfferNs = 0;
+        qint64 maxOfferNs = 0;
+    };
+
     VideoBuffer(QObject *parent = Q_NULLPTR);
     virtual ~VideoBuffer();
 
     bool init();
     void deInit();
+    // serialize the readers (consumeRenderedFrame/refRenderedFrame)
+    // the decoder never takes this lock
     void lock();
     void unLock();
     void setRenderExpiredFrames(bool renderExpiredFrames);
 
     AVFrame *decodingFrame();
-    // set the decoder frame as ready for rendering
-    // this function locks m_mutex during its execution
-    // returns true if the previous frame had been consumed
+    // set the decoder frame as ready for rendering, and get a free slot for the next one
+    // never blocks unless m_renderExpiredFrames is enabled
+    // previousFrameSkipped is true if the previous frame had not been consumed
     void offerDecodedFrame(bool &previousFrameSkipped);
 
-    // mark the rendering frame as consumed and return it
-    // MUST be called with m_mutex locked!!!
-    // the caller is expected to render the returned frame to some texture before
-    // unlocking m_mutex
+    // take the latest offered frame and return it, Q_NULLPTR if nothing new was offered
+    // MUST be called with lock() held!!!
+    // the returned frame stays valid until the next consumeRenderedFrame
     const AVFrame *consumeRenderedFrame();
 
-    void peekRenderedFrame(std::function<void(int width, int height, uint8_t* dataRGB32)> onFrame);
+    // return a new reference to the last consumed frame (av_frame_ref, no pixel copy)
+    // the caller owns the returned frame and must release it with av_frame_free
+    AVFrame *refRenderedFrame();
 
     // wake up and avoid any blocking call
     void interrupt();
 
+    HandoffStats handoffStats() const;
+
 signals:
     void updateFPS(quint32 fps);
 
 private:
-    void swap();
-
-private:
-    AVFrame *m_decodingFrame = Q_NULLPTR;
-    AVFrame *m_renderingframe = Q_NULLPTR;
-    QMutex m_mutex;
-    bool m_renderingFrameConsumed = true;
+    AVFrame *m_frames[3] = { Q_NULLPTR, Q_NULLPTR, Q_NULLPTR };
+    // 写槽只由解码线程访问，读槽只在m_readerMutex内访问
+    int m_writeIndex = 0;
+    int m_readIndex = 1;
+    // 中间槽下标 | FRESH标记
+    std::atomic<int> m_middle;
+    QMutex m_readerMutex;
     FpsCounter m_fpsCounter;
 
+    std::atomic<quint64> m_offered;
+    std::atomic<quint64> m_consumed;
+    std::atomic<quint64> m_skipped;
+    std::atomic<qint64> m_totalOfferNs;
+    std::atomic<qint64> m_maxOfferNs;
+
+    // 只有m_renderExpiredFrames开启时解码线程才需要等待消费
     bool m_renderExpiredFrames = false;
+    QMutex m_consumedMutex;
     QWaitCondition m_renderingFrameConsumedCond;
 
     // interrupted is not used if expired frames are not rendered
@@ -1,8 +1,14 @@
 #include <QDebug>
+#include <QThread>
 #include <QTime>
 
+#include <atomic>
+
 #include "compat.h"
 #include "demuxer.h"
+#include "gopcache.h"
+#include "latencytracker.h"
+#include "streamreactor.h"
 #include "videosocket.h"
 
 #define HEADER_SIZE 12
@@ -12,13 +18,91 @@
 
 #define SC_PACKET_PTS_MASK (SC_PACKET_FLAG_KEY_FRAME - 1)
 
+// codec ids in the stream header, the codec name in ASCII
+#define SC_CODEC_ID_H264 UINT32_C(0x68323634) // "h264"
+#define SC_CODEC_ID_H265 UINT32_C(0x68323635) // "h265"
+#define SC_CODEC_ID_AV1  UINT32_C(0x00617631) // "av1"
+
+// packet pool sizing
+#define PACKET_POOL_INIT_SIZE    (64 * 1024)
+#define PACKET_POOL_MAX_SIZE     (4 * 1024 * 1024)
+#define PACKET_POOL_ALIGN        (16 * 1024)
+#define PACKET_POOL_WINDOW       128
+// grow the pool buffers when more than 1/20 of the packets in a window do not fit
+#define PACKET_POOL_OVERSIZE_DIV 20
+
 typedef qint32 (*ReadPacketFunc)(void *, quint8 *, qint32);
 
+struct Demuxer::PacketPoolCounters : public QEnableSharedFromThis<Demuxer::PacketPoolCounters>
+{
+    // set by the pool allocator, only touched on the demuxer thread
+    bool allocated = false;
+
+    std::atomic<quint64> hits{0};
+    std::atomic<quint64> misses{0};
+    std::atomic<qint64> liveBytes{0};
+    std::atomic<qint64> peakBytes{0};
+    std::atomic<qint32> bufferSize{0};
+
+    void addBytes(qint64 bytes)
+    {
+        qint64 live = (liveBytes += bytes);
+        qint64 peak = peakBytes.load();
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live)) {
+        }
+    }
+};
+
+namespace {
+
+// pool buffers may be released after the demuxer is gone (e.g. queued in the recorder),
+// so each buffer keeps the counters alive on its own
+struct PooledBuffer
+{
+    QSharedPointer<Demuxer::PacketPoolCounters> counters;
+    qint64 size;
+};
+
+void pooledBufferFree(void *opaque, uint8_t *data)
+{
+    PooledBuffer *buffer = static_cast<PooledBuffer *>(opaque);
+    buffer->counters->addBytes(-buffer->size);
+    delete buffer;
+    av_free(data);
+}
+
+// called by av_buffer_pool_get() when no recycled buffer is available
+AVBufferRef *packetPoolAlloc(void *opaque, QTSCRCPY_LAVU_BUFFER_SIZE_T size)
+{
+    Demuxer::PacketPoolCounters *counters = static_cast<Demuxer::PacketPoolCounters *>(opaque);
+    uint8_t *data = static_cast<uint8_t *>(av_malloc(size));
+    if (!data) {
+        return Q_NULLPTR;
+    }
+    PooledBuffer *buffer = new PooledBuffer{ counters->sharedFromThis(), static_cast<qint64>(size) };
+    AVBufferRef *ref = av_buffer_create(data, size, pooledBufferFree, buffer, 0);
+    if (!ref) {
+        delete buffer;
+        av_free(data);
+        return Q_NULLPTR;
+    }
+    counters->addBytes(static_cast<qint64>(size));
+    counters->allocated = true;
+    return ref;
+}
+
+}
+
 Demuxer::Demuxer(QObject *parent)
-    : QThread(parent)
+    : QObject(parent)
+    , m_gopCache(new GopCache)
+    , m_poolCounters(new PacketPoolCounters)
 {}
 
-Demuxer::~Demuxer() {}
+Demuxer::~Demuxer()
+{
+    stopDecode();
+}
 
 static void avLogCallback(void *avcl, int level, const char *fmt, va_list vl)
 {
@@ -64,12 +148,12 @@ bool Demuxer::init()
 
 void Demuxer::deInit()
 {
+    StreamReactor::instance().stop();
     avformat_network_deinit(); // ignore failure
 }
 
 void Demuxer::installVideoSocket(VideoSocket *videoSocket)
 {
-    videoSocket->moveToThread(this);
     m_videoSocket = videoSocket;
 }
 
@@ -78,6 +162,41 @@ void Demuxer::setFrameSize(const QSize &frameSize)
     m_frameSize = frameSize;
 }
 
+void Demuxer::setLatencyTracker(QSharedPointer<LatencyTracker> tracker)
+{
+    m_latency = tracker;
+}
+
+AVCodecID Demuxer::toAVCodecId(quint32 codecId, const QString &fallback)
+{
+    switch (codecId) {
+    case SC_CODEC_ID_H264:
+        return AV_CODEC_ID_H264;
+    case SC_CODEC_ID_H265:
+        return AV_CODEC_ID_HEVC;
+    case SC_CODEC_ID_AV1:
+        return AV_CODEC_ID_AV1;
+    default:
+        break;
+    }
+
+    if (codecId) {
+        qWarning("unknown video codec id 0x%08x, use %s", codecId, fallback.toUtf8().constData());
+    }
+    if (fallback == "h265") {
+        return AV_CODEC_ID_HEVC;
+    }
+    if (fallback == "av1") {
+        return AV_CODEC_ID_AV1;
+    }
+    return AV_CODEC_ID_H264;
+}
+
+void Demuxer::setCodecId(AVCodecID codecId)
+{
+    m_codecId = codecId;
+}
+
 static quint32 bufferRead32be(quint8 *buf)
 {
     return static_cast<quint32>((buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3]);
@@ -90,110 +209,262 @@ static quint64 bufferRead64be(quint8 *buf)
     return (static_cast<quint64>(msb) << 32) | lsb;
 }
 
-qint32 Demuxer::recvData(quint8 *buf, qint32 bufSize)
+bool Demuxer::startDecode()
 {
-    if (!buf || !m_videoSocket) {
-        return 0;
+    if (!m_videoSocket || m_thread) {
+        return false;
     }
 
-    qint32 len = m_videoSocket->subThreadRecvData(buf, bufSize);
-    return len;
+    m_thread = StreamReactor::instance().acquire();
+    m_context = new QObject();
+    m_context->moveToThread(m_thread);
+    m_videoSocket->moveToThread(m_thread);
+
+    QMetaObject::invokeMethod(m_context, [this]() {
+        if (!startStream()) {
+            stopStream();
+        }
+    }, Qt::QueuedConnection);
+    return true;
 }
 
-bool Demuxer::startDecode()
+void Demuxer::stopDecode()
 {
-    if (!m_videoSocket) {
-        return false;
+    if (!m_thread) {
+        return;
     }
-    start();
-    return true;
+
+    if (QThread::currentThread() == m_thread || !m_thread->isRunning()) {
+        stopStream();
+    } else {
+        QMetaObject::invokeMethod(m_context, [this]() {
+            stopStream();
+        }, Qt::BlockingQueuedConnection);
+    }
+
+    m_context->deleteLater();
+    m_context = Q_NULLPTR;
+    StreamReactor::instance().release(m_thread);
+    m_thread = Q_NULLPTR;
 }
 
-void Demuxer::stopDecode()
+QSharedPointer<GopCache> Demuxer::gopCache() const
+{
+    return m_gopCache;
+}
+
+Demuxer::PacketPoolStats Demuxer::packetPoolStats() const
+{
+    PacketPoolStats stats;
+    stats.hits = m_poolCounters->hits.load();
+    stats.misses = m_poolCounters->misses.load();
+    stats.peakBytes = m_poolCounters->peakBytes.load();
+    stats.bufferSize = m_poolCounters->bufferSize.load();
+    return stats;
+}
+
+void Demuxer::resetPacketPool(qint32 bufferSize)
 {
-    wait();
+    if (m_packetPool) {
+        // buffers still referenced elsewhere are freed once released
+        av_buffer_pool_uninit(&m_packetPool);
+    }
+    m_packetPoolBufferSize = 0;
+    m_poolCounters->bufferSize = 0;
+    if (bufferSize <= 0) {
+        return;
+    }
+
+    m_packetPool = av_buffer_pool_init2(bufferSize + AV_INPUT_BUFFER_PADDING_SIZE, m_poolCounters.data(), packetPoolAlloc, Q_NULLPTR);
+    if (!m_packetPool) {
+        qWarning("Could not create packet pool");
+        return;
+    }
+    m_packetPoolBufferSize = bufferSize;
+    m_poolCounters->bufferSize = bufferSize;
 }
 
-void Demuxer::run()
+void Demuxer::updatePacketPool(qint32 len)
 {
+    // size the pool from the observed packet sizes: when too many packets
+    // of the last window did not fit, grow the buffers to the window maximum
+    ++m_windowPackets;
+    m_windowMaxSize = qMax(m_windowMaxSize, len);
+    if (len > m_packetPoolBufferSize) {
+        ++m_windowOversize;
+    }
+    if (m_windowPackets < PACKET_POOL_WINDOW) {
+        return;
+    }
+
+    if (m_windowOversize > PACKET_POOL_WINDOW / PACKET_POOL_OVERSIZE_DIV && m_windowMaxSize <= PACKET_POOL_MAX_SIZE) {
+        qint32 size = (m_windowMaxSize + PACKET_POOL_ALIGN - 1) / PACKET_POOL_ALIGN * PACKET_POOL_ALIGN;
+        qInfo() << "packet pool buffer size" << m_packetPoolBufferSize << "->" << size;
+        resetPacketPool(size);
+    }
+    m_windowPackets = 0;
+    m_windowOversize = 0;
+    m_windowMaxSize = 0;
+}
+
+bool Demuxer::allocPacket(AVPacket *packet, qint32 len)
+{
+    updatePacketPool(len);
+
+    if (m_packetPool && len <= m_packetPoolBufferSize) {
+        m_poolCounters->allocated = false;
+        AVBufferRef *buf = av_buffer_pool_get(m_packetPool);
+        if (buf) {
+            if (m_poolCounters->allocated) {
+                ++m_poolCounters->misses;
+            } else {
+                ++m_poolCounters->hits;
+            }
+            packet->buf = buf;
+            packet->data = buf->data;
+            packet->size = len;
+            memset(packet->data + len, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+            return true;
+        }
+    }
+
+    // larger than the pool buffers (e.g. key frames until the pool grows)
+    ++m_poolCounters->misses;
+    return av_new_packet(packet, len) == 0;
+}
+
+bool Demuxer::startStream()
+{
+    m_running = true;
     m_codecCtx = Q_NULLPTR;
     m_parser = Q_NULLPTR;
-    AVPacket *packet = Q_NULLPTR;
 
     // codec
-    const AVCodec* codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    const AVCodec* codec = avcodec_find_decoder(m_codecId);
     if (!codec) {
-        qCritical("H.264 decoder not found");
-        goto runQuit;
+        qCritical("%s decoder not found", avcodec_get_name(m_codecId));
+        return false;
     }
 
     // codeCtx
     m_codecCtx = avcodec_alloc_context3(codec);
     if (!m_codecCtx) {
         qCritical("Could not allocate codec context");
-        goto runQuit;
+        return false;
     }
     m_codecCtx->flags |= AV_CODEC_FLAG_LOW_DELAY;
     m_codecCtx->width = m_frameSize.width();
     m_codecCtx->height = m_frameSize.height();
     m_codecCtx->pix_fmt = AV_PIX_FMT_YUV420P;
 
-    m_parser = av_parser_init(AV_CODEC_ID_H264);
+    m_parser = av_parser_init(m_codecId);
     if (!m_parser) {
         qCritical("Could not initialize parser");
-        goto runQuit;
+        return false;
     }
 
     // We must only pass complete frames to av_parser_parse2()!
     // It's more complicated, but this allows to reduce the latency by 1 frame!
     m_parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
 
-    packet = av_packet_alloc();
-    if (!packet) {
+    m_packet = av_packet_alloc();
+    if (!m_packet) {
         qCritical("OOM");
-        goto runQuit;
+        return false;
     }
+    m_headerRead = 0;
+    m_payloadRead = 0;
 
-    for (;;) {
-        bool ok = recvPacket(packet);
-        if (!ok) {
-            // end of stream
-            break;
-        }
+    resetPacketPool(PACKET_POOL_INIT_SIZE);
 
-        ok = pushPacket(packet);
-        av_packet_unref(packet);
-        if (!ok) {
-            // cannot process packet (error already logged)
-            break;
-        }
+    if (!m_videoSocket) {
+        return false;
+    }
+    connect(m_videoSocket, &QIODevice::readyRead, m_context, [this]() {
+        onReadyRead();
+    });
+    connect(m_videoSocket, &QAbstractSocket::disconnected, m_context, [this]() {
+        // end of stream
+        stopStream();
+    });
+
+    // data may have arrived before the connections were made
+    onReadyRead();
+    return true;
+}
+
+void Demuxer::stopStream()
+{
+    if (m_videoSocket) {
+        m_videoSocket->disconnect(m_context);
+        m_videoSocket->close();
+        // may be called from one of the socket's own signals
+        m_videoSocket->deleteLater();
+        m_videoSocket = Q_NULLPTR;
     }
 
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+
     qDebug("End of frames");
 
-    if (m_pending) {
-        av_packet_free(&m_pending);
+    if (m_packet) {
+        av_packet_free(&m_packet);
     }
 
-    av_packet_free(&packet);
+    if (m_pendingConfig) {
+        av_packet_free(&m_pendingConfig);
+    }
 
-    av_parser_close(m_parser);
+    m_gopCache->clear();
+    resetPacketPool(0);
 
-runQuit:
-    if (m_codecCtx) {
-        avcodec_free_context(&m_codecCtx);
+    {
+        PacketPoolStats stats = packetPoolStats();
+        qInfo() << "packet pool hits:" << stats.hits << "misses:" << stats.misses
+                << "peak bytes:" << stats.peakBytes << "buffer size:" << stats.bufferSize;
     }
 
-    if (m_videoSocket) {
-        m_videoSocket->close();
-        delete m_videoSocket;
-        m_videoSocket = Q_NULLPTR;
+    if (m_parser) {
+        av_parser_close(m_parser);
+        m_parser = Q_NULLPTR;
+    }
+
+    if (m_codecCtx) {
+        avcodec_free_context(&m_codecCtx);
     }
 
     emit onStreamStop();
 }
 
-bool Demuxer::recvPacket(AVPacket *packet)
+void Demuxer::onReadyRead()
+{
+    while (m_running && m_videoSocket) {
+        bool complete = false;
+        bool ok = recvPacket(m_packet, complete);
+        if (!ok) {
+            // end of stream
+            stopStream();
+            return;
+        }
+        if (!complete) {
+            // wait for more data
+            return;
+        }
+
+        ok = pushPacket(m_packet);
+        av_packet_unref(m_packet);
+        if (!ok) {
+            // cannot process packet (error already logged)
+            stopStream();
+            return;
+        }
+    }
+}
+
+bool Demuxer::recvPacket(AVPacket *packet, bool &complete)
 {
     // The video stream contains raw packets, without time information. When we
     // record, we retrieve the timestamps separately, from a "meta" header
@@ -215,28 +486,49 @@ bool Demuxer::recvPacket(AVPacket *packet)
     // ||                                PTS
     // | `- config packet
     //  `-- key frame
+    //
+    // The socket is non-blocking, so a packet may be received across several
+    // calls: the header is accumulated first, then the payload is read
+    // straight into the packet buffer.
 
-    quint8 header[HEADER_SIZE];
-    qint32 r = recvData(header, HEADER_SIZE);
-    if (r < HEADER_SIZE) {
-        return false;
-    }
+    complete = false;
 
-    quint64 ptsFlags = bufferRead64be(header);
-    quint32 len = bufferRead32be(&header[8]);
-    Q_ASSERT(len);
+    if (m_headerRead < HEADER_SIZE) {
+        qint64 r = m_videoSocket->read(reinterpret_cast<char *>(m_header) + m_headerRead, HEADER_SIZE - m_headerRead);
+        if (r < 0) {
+            return false;
+        }
+        m_headerRead += static_cast<qint32>(r);
+        if (m_headerRead < HEADER_SIZE) {
+            return true;
+        }
+        m_headerTimeUs = LatencyTracker::nowUs();
 
-    if (av_new_packet(packet, static_cast<int>(len))) {
-        qCritical("Could not allocate packet");
-        return false;
+        quint32 len = bufferRead32be(&m_header[8]);
+        Q_ASSERT(len);
+
+        if (!allocPacket(packet, static_cast<qint32>(len))) {
+            qCritical("Could not allocate packet");
+            return false;
+        }
+        m_payloadRead = 0;
     }
 
-    r = recvData(packet->data, static_cast<qint32>(len));
-    if (r < 0 || static_cast<quint32>(r) < len) {
+    qint64 r = m_videoSocket->read(reinterpret_cast<char *>(packet->data) + m_payloadRead, packet->size - m_payloadRead);
+    if (r < 0) {
         av_packet_unref(packet);
         return false;
     }
+    m_payloadRead += static_cast<qint32>(r);
+    if (m_payloadRead < packet->size) {
+        return true;
+    }
+
+    // whole packet received, the next read starts with a header
+    m_headerRead = 0;
+    m_payloadRead = 0;
 
+    quint64 ptsFlags = bufferRead64be(m_header);
     if (ptsFlags & SC_PACKET_FLAG_CONFIG) {
         packet->pts = AV_NOPTS_VALUE;
     } else {
@@ -248,6 +540,10 @@ bool Demuxer::recvPacket(AVPacket *packet)
     }
 
     packet->dts = packet->pts;
+    if (m_latency && packet->pts != AV_NOPTS_VALUE) {
+        m_latency->markReceived(packet->pts, m_headerTimeUs);
+    }
+    complete = true;
     return true;
 }
 
@@ -256,60 +552,52 @@ bool Demuxer::pushPacket(AVPacket *packet)
     bool isConfig = packet->pts == AV_NOPTS_VALUE;
 
     // A config packet must not be decoded immetiately (it contains no
-    // frame); instead, it must be concatenated with the future data packet.
-    if (m_pending || isConfig) {
-        qint32 offset;
-        if (m_pending) {
-            offset = m_pending->size;
-            if (av_grow_packet(m_pending, packet->size)) {
-                qCritical("Could not grow packet");
+    // frame); instead, it is attached to the future data packet as new
+    // extradata, so the frame payload never has to be copied.
+    if (isConfig) {
+        if (!m_pendingConfig) {
+            m_pendingConfig = av_packet_alloc();
+            if (!m_pendingConfig || av_packet_ref(m_pendingConfig, packet)) {
+                av_packet_free(&m_pendingConfig);
+                qCritical("Could not ref config packet");
                 return false;
             }
         } else {
-            offset = 0;
-            m_pending = av_packet_alloc();
-            if (av_new_packet(m_pending, packet->size)) {
-                av_packet_free(&m_pending);
-                qCritical("Could not create packet");
+            // successive config packets are concatenated (rare, config data is small)
+            qint32 offset = m_pendingConfig->size;
+            if (av_packet_make_writable(m_pendingConfig) || av_grow_packet(m_pendingConfig, packet->size)) {
+                qCritical("Could not grow packet");
                 return false;
             }
+            memcpy(m_pendingConfig->data + offset, packet->data, static_cast<unsigned int>(packet->size));
         }
 
-        memcpy(m_pending->data + offset, packet->data, static_cast<unsigned int>(packet->size));
-
-        if (!isConfig) {
-            // prepare the concat packet to send to the decoder
-            m_pending->pts = packet->pts;
-            m_pending->dts = packet->dts;
-            m_pending->flags = packet->flags;
-            packet = m_pending;
-        }
+        return processConfigPacket(packet);
     }
 
-    if (isConfig) {
-        // config packet
-        bool ok = processConfigPacket(packet);
-        if (!ok) {
-            return false;
-        }
-    } else {
-        // data packet
-        bool ok = parse(packet);
-
-        if (m_pending) {
-            // the pending packet must be discarded (consumed or error)
-            av_packet_free(&m_pending);
-        }
-
-        if (!ok) {
+    if (m_pendingConfig) {
+        uint8_t *extradata = av_packet_new_side_data(packet, AV_PKT_DATA_NEW_EXTRADATA, m_pendingConfig->size);
+        if (!extradata) {
+            av_packet_free(&m_pendingConfig);
+            qCritical("Could not attach config data");
             return false;
         }
+        memcpy(extradata, m_pendingConfig->data, static_cast<unsigned int>(m_pendingConfig->size));
+        // the pending config must be discarded (consumed)
+        av_packet_free(&m_pendingConfig);
     }
-    return true;
+
+    // data packet
+    return parse(packet);
 }
 
 bool Demuxer::processConfigPacket(AVPacket *packet)
 {
+    // let the parser see SPS/PPS, the config is no longer part of the data packets
+    quint8 *outData = Q_NULLPTR;
+    int outLen = 0;
+    av_parser_parse2(m_parser, m_codecCtx, &outData, &outLen, packet->data, packet->size, AV_NOPTS_VALUE, AV_NOPTS_VALUE, -1);
+
     emit getConfigFrame(packet);
     return true;
 }
@@ -343,6 +631,11 @@ bool Demuxer::parse(AVPacket *packet)
 bool Demuxer::processFrame(AVPacket *packet)
 {
     packet->dts = packet->pts;
+    if (m_latency) {
+        m_latency->mark(packet->pts, qsc::LS_PARSE);
+    }
+    // 先进缓存再交给解码器，解码器从缓存预热时不会漏掉这个包
+    m_gopCache->push(packet);
     emit getFrame(packet);
     return true;
 }
@@ -2,8 +2,8 @@
 #define STREAM_H
 
 #include <QPointer>
+#include <QSharedPointer>
 #include <QSize>
-#include <QThread>
 
 extern "C"
 {
@@ -11,11 +11,26 @@ extern "C"
 #include "libavformat/avformat.h"
 }
 
+class QThread;
 class VideoSocket;
-class Demuxer : public QThread
+class LatencyTracker;
+class GopCache;
+// 视频流解复用
+// socket和解析工作运行在StreamReactor的共享I/O线程中，
+// 通过非阻塞读取逐步拼出 12字节头 + 负载 的完整数据包
+class Demuxer : public QObject
 {
     Q_OBJECT
 public:
+    // payload buffer pool statistics
+    struct PacketPoolStats {
+        quint64 hits = 0;       // packets served from a recycled pool buffer
+        quint64 misses = 0;     // packets that needed a new allocation
+        qint64 peakBytes = 0;   // peak bytes held by pool buffers
+        qint32 bufferSize = 0;  // current pool buffer size
+    };
+    struct PacketPoolCounters;
+
     Demuxer(QObject *parent = Q_NULLPTR);
     virtual ~Demuxer();
 
@@ -25,8 +40,15 @@ public:
 
     void installVideoSocket(VideoSocket* videoSocket);
     void setFrameSize(const QSize &frameSize);
+    void setLatencyTracker(QSharedPointer<LatencyTracker> tracker);
+    // 视频流头部的codec id转换为AVCodecID，未知时按fallback（"h264"/"h265"/"av1"）
+    static AVCodecID toAVCodecId(quint32 codecId, const QString &fallback = "h264");
+    void setCodecId(AVCodecID codecId);
     bool startDecode();
     void stopDecode();
+    PacketPoolStats packetPoolStats() const;
+    // 最近一组图像的缓存，新画面/恢复解码时用来立即出图，上限为0时不缓存
+    QSharedPointer<GopCache> gopCache() const;
 
 signals:
     void onStreamStop();
@@ -34,23 +56,56 @@ signals:
     void getConfigFrame(AVPacket* packet);
 
 protected:
-    void run();
-    bool recvPacket(AVPacket *packet);
+    // the following functions run in the reactor thread
+    bool startStream();
+    void stopStream();
+    void onReadyRead();
+    // returns false on error, complete is set once a whole packet is received
+    bool recvPacket(AVPacket *packet, bool &complete);
     bool pushPacket(AVPacket *packet);
     bool processConfigPacket(AVPacket *packet);
     bool parse(AVPacket *packet);
     bool processFrame(AVPacket *packet);
-    qint32 recvData(quint8 *buf, qint32 bufSize);
+    bool allocPacket(AVPacket *packet, qint32 len);
+    void updatePacketPool(qint32 len);
+    void resetPacketPool(qint32 bufferSize);
 
 private:
     QPointer<VideoSocket> m_videoSocket;
     QSize m_frameSize;
+    AVCodecID m_codecId = AV_CODEC_ID_H264;
+
+    // reactor thread and a context object living in it
+    QThread *m_thread = Q_NULLPTR;
+    QObject *m_context = Q_NULLPTR;
+    bool m_running = false;
+
+    // partially received packet
+    AVPacket *m_packet = Q_NULLPTR;
+    quint8 m_header[12];
+    qint32 m_headerRead = 0;
+    qint32 m_payloadRead = 0;
+    // the moment the header of m_packet was complete
+    qint64 m_headerTimeUs = 0;
+
+    QSharedPointer<LatencyTracker> m_latency;
+    QSharedPointer<GopCache> m_gopCache;
 
     AVCodecContext *m_codecCtx = Q_NULLPTR;
     AVCodecParserContext *m_parser = Q_NULLPTR;
-    // successive packets may need to be concatenated, until a non-config
-    // packet is available
-    AVPacket* m_pending = Q_NULLPTR;
+    // config packets (SPS/PPS) are kept until a data packet is available,
+    // then attached to it as AV_PKT_DATA_NEW_EXTRADATA instead of being
+    // concatenated with the frame data
+    AVPacket* m_pendingConfig = Q_NULLPTR;
+
+    // recycled payload buffers for recvPacket
+    // buffer size follows the observed packet sizes, larger packets fall back to av_new_packet
+    AVBufferPool *m_packetPool = Q_NULLPTR;
+    qint32 m_packetPoolBufferSize = 0;
+    QSharedPointer<PacketPoolCounters> m_poolCounters;
+    quint32 m_windowPackets = 0;
+    quint32 m_windowOversize = 0;
+    qint32 m_windowMaxSize = 0;
 };
 
 #endif // STREAM_H
@@ -0,0 +1,133 @@
+#include <QDebug>
+#include <QMutexLocker>
+
+#include "compat.h"
+#include "gopcache.h"
+
+GopCache::GopCache() {}
+
+GopCache::~GopCache()
+{
+    if (m_overflows) {
+        qInfo() << "gop cache overflows:" << m_overflows;
+    }
+    clearPackets();
+}
+
+void GopCache::setMaxBytes(qint64 maxBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxBytes = qMax<qint64>(0, maxBytes);
+    if (m_bytes > m_maxBytes) {
+        clearPackets();
+        m_waitKeyFrame = true;
+    }
+}
+
+qint64 GopCache::maxBytes()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxBytes;
+}
+
+void GopCache::push(const AVPacket *packet)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_maxBytes <= 0 || !packet) {
+        return;
+    }
+
+    QTSCRCPY_LAVC_SIDE_DATA_SIZE_T size = 0;
+    const uint8_t *extradata = av_packet_get_side_data(packet, AV_PKT_DATA_NEW_EXTRADATA, &size);
+    if (extradata && size > 0) {
+        m_config = QByteArray(reinterpret_cast<const char *>(extradata), static_cast<int>(size));
+    }
+
+    if (packet->flags & AV_PKT_FLAG_KEY) {
+        // 新的一组从这里开始，之前的包都不再需要
+        clearPackets();
+        m_waitKeyFrame = false;
+    } else if (m_waitKeyFrame) {
+        return;
+    }
+
+    if (m_bytes + packet->size > m_maxBytes) {
+        // 不完整的一组无法解码出当前画面，整组丢弃
+        clearPackets();
+        m_waitKeyFrame = true;
+        m_overflows++;
+        return;
+    }
+
+    AVPacket *ref = av_packet_alloc();
+    if (!ref || av_packet_ref(ref, packet)) {
+        av_packet_free(&ref);
+        clearPackets();
+        m_waitKeyFrame = true;
+        return;
+    }
+    m_packets.append(ref);
+    m_bytes += packet->size;
+}
+
+void GopCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    clearPackets();
+    m_config.clear();
+    m_waitKeyFrame = true;
+}
+
+bool GopCache::snapshot(QVector<AVPacket *> &packets)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_packets.isEmpty()) {
+        return false;
+    }
+
+    // 调用方传入的数据包不属于这里，失败时只释放本次追加的
+    const int first = packets.size();
+    packets.reserve(first + m_packets.size());
+    for (int i = 0; i < m_packets.size(); ++i) {
+        AVPacket *ref = av_packet_alloc();
+        if (!ref || av_packet_ref(ref, m_packets[i])) {
+            av_packet_free(&ref);
+            for (int j = first; j < packets.size(); ++j) {
+                av_packet_free(&packets[j]);
+            }
+            packets.resize(first);
+            return false;
+        }
+        // 关键帧之前的配置数据可能早就发过了，解码器重建时需要它
+        if (i == 0 && !m_config.isEmpty() && !av_packet_get_side_data(ref, AV_PKT_DATA_NEW_EXTRADATA, Q_NULLPTR)) {
+            uint8_t *extradata = av_packet_new_side_data(ref, AV_PKT_DATA_NEW_EXTRADATA, m_config.size());
+            if (extradata) {
+                memcpy(extradata, m_config.constData(), static_cast<size_t>(m_config.size()));
+            }
+        }
+        packets.append(ref);
+    }
+    return true;
+}
+
+qint64 GopCache::cachedBytes()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytes;
+}
+
+int GopCache::cachedPackets()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_packets.size();
+}
+
+void GopCache::clearPackets()
+{
+    // called with m_mutex locked
+    for (AVPacket *packet : m_packets) {
+        av_packet_free(&packet);
+    }
+    m_packets.clear();
+    m_bytes = 0;
+}
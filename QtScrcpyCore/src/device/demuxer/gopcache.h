@@ -0,0 +1,52 @@
+#ifndef GOPCACHE_H
+#define GOPCACHE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QVector>
+
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+}
+
+// 最近一组图像（GOP）的缓存，用于让新打开/恢复解码的画面立即出图：
+// 保留最新的配置数据（SPS/PPS）、最近的关键帧以及它之后的所有数据包（只引用，不拷贝负载），
+// 超过内存上限时丢弃整组，直到下一个关键帧再开始缓存
+// push在解复用线程中调用，snapshot可以在任意线程调用
+class GopCache
+{
+public:
+    GopCache();
+    ~GopCache();
+
+    // 缓存的负载字节上限，0表示不缓存
+    void setMaxBytes(qint64 maxBytes);
+    qint64 maxBytes();
+
+    void push(const AVPacket *packet);
+    void clear();
+
+    // 引用缓存的数据包，第一个是关键帧，需要时带上最新的配置数据（AV_PKT_DATA_NEW_EXTRADATA）
+    // 追加到packets末尾，调用者负责av_packet_free；缓存为空或引用失败时返回false，packets保持不变
+    bool snapshot(QVector<AVPacket *> &packets);
+
+    qint64 cachedBytes();
+    int cachedPackets();
+
+private:
+    void clearPackets();
+
+private:
+    QMutex m_mutex;
+    qint64 m_maxBytes = 0;
+    QByteArray m_config;
+    // 从最近的关键帧开始
+    QVector<AVPacket *> m_packets;
+    qint64 m_bytes = 0;
+    // 超过上限后等待下一个关键帧
+    bool m_waitKeyFrame = true;
+    quint64 m_overflows = 0;
+};
+
+#endif // GOPCACHE_H
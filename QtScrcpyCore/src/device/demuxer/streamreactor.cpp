@@ -0,0 +1,70 @@
+#include <QDebug>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "streamreactor.h"
+
+#define REACTOR_MIN_THREADS 2
+#define REACTOR_MAX_THREADS 8
+
+StreamReactor &StreamReactor::instance()
+{
+    static StreamReactor reactor;
+    return reactor;
+}
+
+StreamReactor::StreamReactor()
+{
+    m_maxThreads = qBound(REACTOR_MIN_THREADS, QThread::idealThreadCount(), REACTOR_MAX_THREADS);
+}
+
+StreamReactor::~StreamReactor()
+{
+    stop();
+}
+
+QThread *StreamReactor::acquire()
+{
+    QMutexLocker locker(&m_mutex);
+
+    QThread *best = Q_NULLPTR;
+    for (QThread *thread : m_threads) {
+        if (!best || m_load.value(thread) < m_load.value(best)) {
+            best = thread;
+        }
+    }
+
+    if (!best || (m_load.value(best) > 0 && m_threads.size() < m_maxThreads)) {
+        best = new QThread();
+        best->setObjectName(QString("StreamReactor-%1").arg(m_threads.size()));
+        best->start();
+        m_threads.append(best);
+        m_load.insert(best, 0);
+        qInfo() << "stream reactor thread" << m_threads.size() << "/" << m_maxThreads << "started";
+    }
+
+    if (!best->isRunning()) {
+        // restarted after stop()
+        best->start();
+    }
+    m_load[best] += 1;
+    return best;
+}
+
+void StreamReactor::release(QThread *thread)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_load.contains(thread) && m_load[thread] > 0) {
+        m_load[thread] -= 1;
+    }
+}
+
+void StreamReactor::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    // the threads are kept, demuxers may still reference them
+    for (QThread *thread : m_threads) {
+        thread->quit();
+        thread->wait();
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef STREAMREACTOR_H
+#define STREAMREACTOR_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+
+class QThread;
+
+// 视频流接收线程池
+// 少量固定的I/O线程（事件循环）承载所有设备的视频socket，
+// 代替每个设备一个阻塞接收线程
+class StreamReactor
+{
+public:
+    static StreamReactor &instance();
+
+    // 返回负载最小的I/O线程，线程数未达上限且所有线程都有负载时新建线程
+    QThread *acquire();
+    void release(QThread *thread);
+    // 退出并等待所有I/O线程（线程对象保留，再次acquire时重新启动）
+    void stop();
+
+private:
+    StreamReactor();
+    ~StreamReactor();
+    Q_DISABLE_COPY(StreamReactor)
+
+private:
+    QMutex m_mutex;
+    QList<QThread *> m_threads;
+    QHash<QThread *, int> m_load;
+    int m_maxThreads = 0;
+};
+
+#endif // STREAMREACTOR_H
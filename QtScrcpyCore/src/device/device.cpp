@@ -1,19 +1,26 @@
 #include <QDir>
 #include <QMessageBox>
+#include <QMutexLocker>
 #include <QTimer>
 
+#include "controlchannel.h"
 #include "controller.h"
 #include "devicemsg.h"
 #include "decoder.h"
 #include "device.h"
 #include "filehandler.h"
+#include "framegrabber.h"
+#include "latencytracker.h"
 #include "recorder.h"
 #include "server.h"
 #include "demuxer.h"
 
 namespace qsc {
 
-Device::Device(DeviceParams params, QObject *parent) : IDevice(parent), m_params(params)
+Device::Device(DeviceParams params, QObject *parent)
+    : IDevice(parent)
+    , m_params(params)
+    , m_latency(new LatencyTracker)
 {
     qDebug() << "Device::Device constructor, this: " << this << "serial: " << m_params.serial;
     if (!params.display && !m_params.recordFile) {
@@ -22,51 +29,46 @@ Device::Device(DeviceParams params, QObject *parent) : IDevice(parent), m_params
     }
 
     if (params.display) {
-        m_decoder = new Decoder([this](int width, int height, uint8_t* dataY, uint8_t* dataU, uint8_t* dataV, int linesizeY, int linesizeU, int linesizeV) {
+        m_decoder = new Decoder([this](const qsc::FrameBufferPtr& frame) {
+            if (frame->sourceWidth != m_frameSize.width() || frame->sourceHeight != m_frameSize.height()) {
+                // 旋转或者分辨率变化
+                m_frameSize = QSize(frame->sourceWidth, frame->sourceHeight);
+                emit frameSizeChanged(m_frameSize);
+            }
             for (const auto& item : m_deviceObservers) {
-                item->onFrame(width, height, dataY, dataU, dataV, linesizeY, linesizeU, linesizeV);
+                if (m_offGuiObservers.count(item)) {
+                    continue;
+                }
+                deliverFrame(item, frame);
             }
         }, this);
+        m_decoder->setLatencyTracker(m_latency);
         m_fileHandler = new FileHandler(this);
         m_controller = new Controller([this](const QByteArray& buffer) -> qint64 {
-            if (!m_server) {
-                qWarning() << "Device::sendControl - server is null";
-                return 0;
-            }
-            
-            QTcpSocket* controlSocket = m_server->getControlSocket();
-            if (!controlSocket) {
-                qWarning() << "Device::sendControl - control socket is null";
+            // 写入在控制I/O线程中进行，这里只是排队
+            // 定时的触摸消息从输入计时线程调用
+            QMutexLocker locker(&m_sendMutex);
+            if (!m_controlChannel) {
+                qWarning() << "Device::sendControl - control channel is not running";
                 return 0;
             }
-            
-            // 检查socket是否已连接（允许UnconnectedState，因为可能是异步连接中）
-            QAbstractSocket::SocketState state = controlSocket->state();
-            if (state != QAbstractSocket::ConnectedState) {
-                qWarning() << "Device::sendControl - control socket is not connected, state:" << state;
-                return 0;
-            }
-
-            qint64 written = controlSocket->write(buffer.data(), buffer.length());
-            if (written < 0) {
-                qWarning() << "Device::sendControl - write failed, error:" << controlSocket->errorString();
-                return 0;
-            } else if (written != buffer.length()) {
-                qWarning() << "Device::sendControl - partial write, written:" << written << "expected:" << buffer.length();
-            } else {
-                qDebug() << "Device::sendControl - successfully wrote" << written << "bytes to control socket";
+            qint64 queued = m_controlChannel->send(buffer);
+            if (m_controlTap) {
+                m_controlTap(buffer);
             }
-            
-            // 刷新socket缓冲区，确保数据立即发送（特别是对于TCP直连模式）
-            // 注意：对于TCP socket，write() 通常会自动发送数据
-            // 暂时注释掉flush()，因为可能在某些情况下会导致问题
-            // controlSocket->flush();
-            
-            return written;
+            return queued;
         }, params.gameScript, this);
+        if (m_params.touchMoveCoalesceMs >= 0) {
+            m_controller->setMoveCoalesceInterval(m_params.touchMoveCoalesceMs);
+        }
     }
 
     m_stream = new Demuxer(this);
+    m_stream->setLatencyTracker(m_latency);
+    if (m_decoder) {
+        m_stream->gopCache()->setMaxBytes(m_params.gopCacheBytes);
+        m_decoder->setGopCache(m_stream->gopCache());
+    }
 
     m_server = new Server(this);
     if (m_params.recordFile && !m_params.recordPath.trimmed().isEmpty()) {
@@ -95,6 +97,10 @@ Device::Device(DeviceParams params, QObject *parent) : IDevice(parent), m_params
 Device::~Device()
 {
     qDebug() << "Device::~Device, this: " << this << "serial: " << m_params.serial;
+    // 先关闭输入计时线程中的Lane，之后不会再调用发送函数
+    if (m_controller) {
+        delete m_controller;
+    }
     Device::disconnectDevice();
 }
 
@@ -108,14 +114,56 @@ void *Device::getUserData()
     return m_userData;
 }
 
-void Device::registerDeviceObserver(DeviceObserver *observer)
+void Device::registerDeviceObserver(DeviceObserver *observer, FrameAffinity affinity)
 {
-    m_deviceObservers.insert(observer);
+    if (!observer) {
+        return;
+    }
+    const bool added = m_deviceObservers.insert(observer).second;
+
+    const bool offGui = m_offGuiObservers.count(observer) > 0;
+    if (affinity != FA_GUI_THREAD && m_decoder) {
+        m_decoder->addFrameObserver(observer, affinity);
+        m_offGuiObservers.insert(observer);
+        m_frameGates.erase(observer);
+    } else if (offGui) {
+        // re-registered on the GUI thread
+        if (m_decoder) {
+            m_decoder->removeFrameObserver(observer);
+        }
+        m_offGuiObservers.erase(observer);
+    } else if (added && m_decoder) {
+        // 静止画面可能很久都没有新帧，先给新的观察者最近的一帧
+        const FrameBufferPtr frame = m_decoder->latestFrame();
+        if (frame) {
+            deliverFrame(observer, frame);
+        }
+    }
+}
+
+void Device::deliverFrame(DeviceObserver *observer, const FrameBufferPtr &frame)
+{
+    const FrameFormat format = observer->frameFormat();
+    if (!m_frameGates[observer].accept(observer, *frame, format)) {
+        return;
+    }
+    // 相同规格的观察者共享同一次转换
+    const FrameBufferPtr converted = m_decoder->convertFrame(frame, format);
+    if (!converted) {
+        return;
+    }
+    observer->setFramePts(frame->pts);
+    observer->onFrameBuffer(converted);
 }
 
 void Device::deRegisterDeviceObserver(DeviceObserver *observer)
 {
     m_deviceObservers.erase(observer);
+    m_frameGates.erase(observer);
+    if (m_offGuiObservers.erase(observer) && m_decoder) {
+        // returns once no onFrame of this observer is running
+        m_decoder->removeFrameObserver(observer);
+    }
 }
 
 const QString &Device::getSerial()
@@ -131,15 +179,107 @@ void Device::updateScript(QString script)
 }
 
 void Device::screenshot()
+{
+    screenshot(ScreenshotParams());
+}
+
+void Device::screenshot(const ScreenshotParams& params, ScreenshotCallback callback)
 {
     if (!m_decoder) {
+        if (callback) {
+            callback(ScreenshotResult());
+        }
         return;
     }
 
+    if (!m_frameGrabber) {
+        m_frameGrabber = new FrameGrabber([this]() -> AVFrame* {
+            return m_decoder ? m_decoder->refFrame() : Q_NULLPTR;
+        }, this);
+    }
+
     // screenshot
-    m_decoder->peekFrame([this](int width, int height, uint8_t* dataRGB32) {
-       saveFrame(width, height, dataRGB32);
-    });
+    m_frameGrabber->grab(params, m_params.recordPath, m_params.serial, callback);
+}
+
+void Device::setDecodeFocus(bool focus)
+{
+    if (m_decoder) {
+        m_decoder->setFocused(focus);
+    }
+}
+
+DecodeStats Device::decodeStats()
+{
+    if (!m_decoder) {
+        return DecodeStats();
+    }
+    return m_decoder->stats();
+}
+
+void Device::setDecodeMode(DecodeMode mode)
+{
+    if (m_decoder) {
+        m_decoder->setDecodeMode(mode);
+    }
+}
+
+DecodeMode Device::decodeMode()
+{
+    if (!m_decoder) {
+        return DECODE_FULL;
+    }
+    return m_decoder->decodeMode();
+}
+
+ControlChannel *Device::controlChannel()
+{
+    return m_controlChannel;
+}
+
+QSize Device::frameSize() const
+{
+    return m_frameSize;
+}
+
+void Device::setControlTap(std::function<void(const QByteArray &)> tap)
+{
+    QMutexLocker locker(&m_sendMutex);
+    m_controlTap = tap;
+}
+
+ControlStats Device::controlStats()
+{
+    if (!m_controlChannel) {
+        return ControlStats();
+    }
+    return m_controlChannel->stats();
+}
+
+LatencyStats Device::latencyStats()
+{
+    return m_latency->stats();
+}
+
+void Device::resetLatencyStats()
+{
+    m_latency->reset();
+}
+
+InputTimingStats Device::inputTimingStats()
+{
+    if (!m_controller) {
+        return InputTimingStats();
+    }
+    return m_controller->inputTimingStats();
+}
+
+void Device::markFrameStage(qint64 pts, LatencyStage stage)
+{
+    if (stage != LS_UPLOAD && stage != LS_PRESENT) {
+        return;
+    }
+    m_latency->mark(pts, stage);
 }
 
 void Device::showTouch(bool show)
@@ -211,14 +351,22 @@ void Device::initSignals()
     if (m_server) {
         connect(m_server, &Server::serverStarted, this, [this](bool success, const QString &deviceName, const QSize &size) {
             m_serverStartSuccess = success;
+            if (success) {
+                m_frameSize = size;
+            }
             emit deviceConnected(success, m_params.serial, deviceName, size);
             if (success) {
                 double diff = m_startTimeCount.elapsed() / 1000.0;
                 qInfo() << QString("server start finish in %1s").arg(diff).toStdString().c_str();
 
+                // the stream header tells which codec the server actually uses
+                const AVCodecID codecId = Demuxer::toAVCodecId(m_server->getVideoCodecId(), m_params.videoCodec);
+                qInfo() << "video codec:" << avcodec_get_name(codecId);
+
                 // init recorder
                 if (m_recorder) {
                     m_recorder->setFrameSize(size);
+                    m_recorder->setCodecId(codecId);
                     if (!m_recorder->open()) {
                         qCritical("Could not open recorder");
                     }
@@ -230,32 +378,29 @@ void Device::initSignals()
 
                 // init decoder
                 if (m_decoder) {
-                    m_decoder->open();
+                    m_decoder->open(codecId);
                 }
 
                 // init stream
                 m_stream->installVideoSocket(m_server->removeVideoSocket());
                 m_stream->setFrameSize(size);
+                m_stream->setCodecId(codecId);
                 m_stream->startDecode();
 
-                // recv device msg
-                connect(m_server->getControlSocket(), &QTcpSocket::readyRead, this, [this](){
-                    if (!m_controller) {
-                        return;
-                    }
-
-                    auto controlSocket = m_server->getControlSocket();
-                    while (controlSocket->bytesAvailable()) {
-                        QByteArray byteArray = controlSocket->peek(controlSocket->bytesAvailable());
-                        DeviceMsg deviceMsg;
-                        qint32 consume = deviceMsg.deserialize(byteArray);
-                        if (0 >= consume) {
-                            break;
+                // control socket: sending and device msgs run on the control I/O thread
+                QTcpSocket *controlSocket = m_server->removeControlSocket();
+                if (controlSocket) {
+                    ControlChannel *channel = new ControlChannel();
+                    connect(channel, &ControlChannel::deviceMsg, this, [this](QSharedPointer<DeviceMsg> msg) {
+                        if (m_controller) {
+                            m_controller->recvDeviceMsg(msg.data());
                         }
-                        controlSocket->read(consume);
-                        m_controller->recvDeviceMsg(&deviceMsg);
-                    }
-                });
+                    });
+                    channel->start(controlSocket, m_params.controlQuickAck, m_params.controlRttProbeMs);
+                    QMutexLocker locker(&m_sendMutex);
+                    m_controlChannel = channel;
+                }
+                emit controlChannelChanged();
 
                 // 显示界面时才自动息屏（m_params.display）
                 if (m_params.closeScreen && m_params.display && m_controller) {
@@ -294,6 +439,10 @@ void Device::initSignals()
 
     if (m_decoder) {
         connect(m_decoder, &Decoder::updateFPS, this, [this](quint32 fps) {
+            if (m_controller && m_params.touchMoveCoalesceMs < 0 && fps > 0) {
+                // 一帧一个MOVE足够，静止画面帧率很低时也不超过约30Hz
+                m_controller->setMoveCoalesceInterval(qBound(8, static_cast<int>(1000 / fps), 33));
+            }
             for (const auto& item : m_deviceObservers) {
                 item->updateFPS(fps);
             }
@@ -336,6 +485,7 @@ bool Device::connectDevice()
         params.serverVersion = m_params.serverVersion;
         params.logLevel = m_params.logLevel;
         params.codecOptions = m_params.codecOptions;
+        params.videoCodec = m_params.videoCodec;
         params.codecName = m_params.codecName;
         params.scid = m_params.scid;
 
@@ -362,10 +512,25 @@ void Device::disconnectDevice()
     m_server->stop();
     m_server = Q_NULLPTR;
 
+    ControlChannel *channel = Q_NULLPTR;
+    {
+        QMutexLocker locker(&m_sendMutex);
+        channel = m_controlChannel;
+        m_controlChannel = Q_NULLPTR;
+    }
+    if (channel) {
+        channel->stop();
+        emit controlChannelChanged();
+    }
+
     if (m_stream) {
         m_stream->stopDecode();
     }
 
+    if (m_frameGrabber) {
+        m_frameGrabber->stop();
+    }
+
     // server must stop before decoder, because decoder block main thread
     if (m_decoder) {
         m_decoder->close();
@@ -657,36 +822,4 @@ bool Device::isCurrentCustomKeymap()
     return m_controller->isCurrentCustomKeymap();
 }
 
-bool Device::saveFrame(int width, int height, uint8_t* dataRGB32)
-{
-    if (!dataRGB32) {
-        return false;
-    }
-
-    QImage rgbImage(dataRGB32, width, height, QImage::Format_RGB32);
-
-    // save
-    QString absFilePath;
-    QString fileDir(m_params.recordPath);
-    if (fileDir.isEmpty()) {
-        qWarning() << "please select record save path!!!";
-        return false;
-    }
-    QDateTime dateTime = QDateTime::currentDateTime();
-    QString fileName = dateTime.toString("_yyyyMMdd_hhmmss_zzz");
-    fileName = m_params.serial + fileName;
-    fileName.replace(":", "_");
-    fileName.replace(".", "_");
-    fileName += ".png";
-    QDir dir(fileDir);
-    absFilePath = dir.absoluteFilePath(fileName);
-    int ret = rgbImage.save(absFilePath, "PNG", 100);
-    if (!ret) {
-        return false;
-    }
-
-    qInfo() << "screenshot save to " << absFilePath;
-    return true;
-}
-
 }
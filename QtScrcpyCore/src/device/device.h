@@ -1,12 +1,16 @@
 ﻿#ifndef DEVICE_H
 #define DEVICE_H
 
+#include <map>
 #include <set>
 #include <QElapsedTimer>
+#include <QMutex>
 #include <QPointer>
+#include <QSharedPointer>
 #include <QTime>
 
 #include "../../include/QtScrcpyCore.h"
+#include "decoder/framegate.h"
 
 class QMouseEvent;
 class QWheelEvent;
@@ -19,6 +23,9 @@ class FileHandler;
 class Demuxer;
 class VideoForm;
 class Controller;
+class ControlChannel;
+class FrameGrabber;
+class LatencyTracker;
 struct AVFrame;
 
 namespace qsc {
@@ -33,7 +40,7 @@ public:
     void setUserData(void* data) override;
     void* getUserData() override;
 
-    void registerDeviceObserver(DeviceObserver* observer) override;
+    void registerDeviceObserver(DeviceObserver* observer, FrameAffinity affinity = FA_GUI_THREAD) override;
     void deRegisterDeviceObserver(DeviceObserver* observer) override;
 
     bool connectDevice() override;
@@ -65,8 +72,21 @@ public:
     void installApkRequest(const QString &apkFile) override;
 
     void screenshot() override;
+    void screenshot(const ScreenshotParams& params, ScreenshotCallback callback = Q_NULLPTR) override;
     void showTouch(bool show) override;
 
+    void setDecodeFocus(bool focus) override;
+    DecodeStats decodeStats() override;
+    void setDecodeMode(DecodeMode mode) override;
+    DecodeMode decodeMode() override;
+
+    ControlStats controlStats() override;
+
+    LatencyStats latencyStats() override;
+    void resetLatencyStats() override;
+    void markFrameStage(qint64 pts, LatencyStage stage) override;
+    InputTimingStats inputTimingStats() override;
+
     bool isReversePort(quint16 port) override;
     quint16 getLocalPort() override;
     const QString &getSerial() override;
@@ -74,9 +94,22 @@ public:
     void updateScript(QString script) override;
     bool isCurrentCustomKeymap() override;
 
+    // 以下供核心内部（群控广播）使用，在GUI线程调用
+    // 控制通道，设备连接前和断开后为空
+    ControlChannel *controlChannel();
+    // 当前视频画面尺寸，控制消息中的坐标以此为准
+    QSize frameSize() const;
+    // 本设备的Controller发出的每条控制消息（已序列化）都会再交给tap
+    void setControlTap(std::function<void(const QByteArray &buffer)> tap);
+
+signals:
+    void frameSizeChanged(const QSize &size);
+    void controlChannelChanged();
+
 private:
     void initSignals();
-    bool saveFrame(int width, int height, uint8_t* dataRGB32);
+    // GUI线程的观察者，按观察者的规格转换后投递
+    void deliverFrame(DeviceObserver *observer, const FrameBufferPtr &frame);
 
 private:
     // server relevant
@@ -84,14 +117,27 @@ private:
     bool m_serverStartSuccess = false;
     QPointer<Decoder> m_decoder;
     QPointer<Controller> m_controller;
+    // lives on the control I/O thread
+    QPointer<ControlChannel> m_controlChannel;
     QPointer<FileHandler> m_fileHandler;
     QPointer<Demuxer> m_stream;
     QPointer<Recorder> m_recorder;
+    QPointer<FrameGrabber> m_frameGrabber;
 
     QElapsedTimer m_startTimeCount;
     DeviceParams m_params;
+    // shared with the demuxer and decoder threads
+    QSharedPointer<LatencyTracker> m_latency;
     std::set<DeviceObserver*> m_deviceObservers;
+    // onFrame不在GUI线程调用的观察者，由Decoder分发
+    std::set<DeviceObserver*> m_offGuiObservers;
+    // GUI线程观察者的投递状态，其他观察者的在FrameDispatcher中
+    std::map<DeviceObserver*, FrameGate> m_frameGates;
     void* m_userData = nullptr;
+    QSize m_frameSize;
+    // guards m_controlChannel and m_controlTap, the send function also runs on the input timing thread
+    QMutex m_sendMutex;
+    std::function<void(const QByteArray &)> m_controlTap;
 };
 
 }
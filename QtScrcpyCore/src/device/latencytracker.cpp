@@ -0,0 +1,188 @@
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+#include <cmath>
+
+#include "latencytracker.h"
+
+namespace {
+
+QElapsedTimer startedTimer()
+{
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}
+
+}
+
+LatencyTracker::LatencyTracker()
+{
+    reset();
+}
+
+qint64 LatencyTracker::nowUs()
+{
+    static const QElapsedTimer timer = startedTimer();
+    return timer.nsecsElapsed() / 1000;
+}
+
+void LatencyTracker::markReceived(qint64 pts, qint64 recvUs)
+{
+    if (pts < 0) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    // 覆盖最旧的记录
+    Record &record = m_records[m_next];
+    m_next = (m_next + 1) % RECORDS;
+    record.pts = pts;
+    for (int i = 0; i < qsc::LS_COUNT; ++i) {
+        record.stamps[i] = -1;
+    }
+    record.stamps[qsc::LS_NETWORK] = recvUs;
+
+    // 两端时钟不同步，只能统计相对最小延迟的增量（排队和抖动）
+    const qint64 offset = recvUs - pts;
+    if (!m_hasOffset || offset < m_minOffsetUs) {
+        m_minOffsetUs = offset;
+        m_hasOffset = true;
+    }
+    m_histograms[qsc::LS_NETWORK].add(offset - m_minOffsetUs);
+}
+
+void LatencyTracker::mark(qint64 pts, qsc::LatencyStage stage)
+{
+    if (pts < 0 || stage <= qsc::LS_NETWORK || stage >= qsc::LS_TOTAL) {
+        return;
+    }
+    const qint64 now = nowUs();
+
+    QMutexLocker locker(&m_mutex);
+    Record *record = find(pts);
+    if (!record || record->stamps[stage] >= 0) {
+        return;
+    }
+    record->stamps[stage] = now;
+
+    // 上一个已到达的阶段，渲染端不一定上报上传阶段
+    for (int prev = stage - 1; prev >= qsc::LS_NETWORK; --prev) {
+        if (record->stamps[prev] >= 0) {
+            m_histograms[stage].add(now - record->stamps[prev]);
+            break;
+        }
+    }
+    if (stage == qsc::LS_PRESENT) {
+        m_histograms[qsc::LS_TOTAL].add(now - record->stamps[qsc::LS_NETWORK]);
+    }
+}
+
+qsc::LatencyStats LatencyTracker::stats()
+{
+    qsc::LatencyStats stats;
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < qsc::LS_COUNT; ++i) {
+        stats.stages[i] = m_histograms[i].percentiles();
+    }
+    return stats;
+}
+
+void LatencyTracker::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < RECORDS; ++i) {
+        m_records[i].pts = -1;
+    }
+    m_next = 0;
+    for (int i = 0; i < qsc::LS_COUNT; ++i) {
+        m_histograms[i].clear();
+    }
+    m_hasOffset = false;
+    m_minOffsetUs = 0;
+}
+
+LatencyTracker::Record *LatencyTracker::find(qint64 pts)
+{
+    // 从最新的记录往回找，通常只需要看几条
+    for (int i = 1; i <= RECORDS; ++i) {
+        Record &record = m_records[(m_next - i + RECORDS) % RECORDS];
+        if (record.pts == pts) {
+            return &record;
+        }
+    }
+    return Q_NULLPTR;
+}
+
+void LatencyTracker::Histogram::add(qint64 us)
+{
+    us = qMax<qint64>(0, us);
+    m_buckets[bucketOf(us)]++;
+    m_count++;
+    m_max = qMax(m_max, us);
+}
+
+void LatencyTracker::Histogram::clear()
+{
+    for (int i = 0; i < BUCKETS; ++i) {
+        m_buckets[i] = 0;
+    }
+    m_count = 0;
+    m_max = 0;
+}
+
+qsc::LatencyPercentiles LatencyTracker::Histogram::percentiles() const
+{
+    qsc::LatencyPercentiles result;
+    result.count = m_count;
+    result.p50Us = percentile(0.50);
+    result.p95Us = percentile(0.95);
+    result.p99Us = percentile(0.99);
+    result.maxUs = m_max;
+    return result;
+}
+
+int LatencyTracker::Histogram::bucketOf(qint64 us)
+{
+    if (us < 16) {
+        return static_cast<int>(us);
+    }
+    int exponent = 4;
+    while (exponent < 30 && (us >> (exponent + 1)) > 0) {
+        exponent++;
+    }
+    if (exponent >= 30) {
+        return BUCKETS - 1;
+    }
+    const int sub = static_cast<int>((us >> (exponent - 3)) & 7);
+    return 16 + (exponent - 4) * 8 + sub;
+}
+
+qint64 LatencyTracker::Histogram::bucketValue(int bucket)
+{
+    if (bucket < 16) {
+        return bucket;
+    }
+    const int exponent = 4 + (bucket - 16) / 8;
+    const int sub = (bucket - 16) % 8;
+    // 桶的中点
+    const qint64 low = static_cast<qint64>(8 + sub) << (exponent - 3);
+    const qint64 width = static_cast<qint64>(1) << (exponent - 3);
+    return low + width / 2;
+}
+
+qint64 LatencyTracker::Histogram::percentile(double p) const
+{
+    if (!m_count) {
+        return 0;
+    }
+    const quint64 target = qMax<quint64>(1, static_cast<quint64>(std::ceil(m_count * p)));
+    quint64 seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += m_buckets[i];
+        if (seen >= target) {
+            return qMin(bucketValue(i), m_max);
+        }
+    }
+    return m_max;
+}
@@ -0,0 +1,68 @@
+#ifndef LATENCYTRACKER_H
+#define LATENCYTRACKER_H
+
+#include <QMutex>
+
+#include "QtScrcpyCoreDef.h"
+
+// 每设备的帧延迟统计
+// 按pts记录最近若干帧到达各阶段的时刻，阶段耗时计入对数分桶直方图，
+// 各阶段可在不同线程标记
+class LatencyTracker
+{
+public:
+    LatencyTracker();
+
+    // 收到完整帧头时调用，recvUs取自nowUs()
+    void markReceived(qint64 pts, qint64 recvUs);
+    // pts帧到达stage（LS_PARSE ~ LS_PRESENT），每帧每阶段只记录第一次
+    void mark(qint64 pts, qsc::LatencyStage stage);
+
+    qsc::LatencyStats stats();
+    void reset();
+
+    // 单调时钟(us)
+    static qint64 nowUs();
+
+    // 小于16us精确计数，之后每个2的幂区间分8个桶（误差约12%）
+    // 输入计时的jitter统计也用它
+    class Histogram
+    {
+    public:
+        void add(qint64 us);
+        void clear();
+        qsc::LatencyPercentiles percentiles() const;
+
+    private:
+        static int bucketOf(qint64 us);
+        static qint64 bucketValue(int bucket);
+        qint64 percentile(double p) const;
+
+        enum { BUCKETS = 16 + 27 * 8 };
+        quint64 m_buckets[BUCKETS] = {};
+        quint64 m_count = 0;
+        qint64 m_max = 0;
+    };
+
+private:
+    struct Record
+    {
+        qint64 pts = -1;
+        qint64 stamps[qsc::LS_COUNT];
+    };
+
+    Record *find(qint64 pts);
+
+private:
+    enum { RECORDS = 64 };
+
+    QMutex m_mutex;
+    Record m_records[RECORDS];
+    int m_next = 0;
+    Histogram m_histograms[qsc::LS_COUNT];
+    // 设备时钟与本地时钟的最小差值，作为网络延迟的基线
+    qint64 m_minOffsetUs = 0;
+    bool m_hasOffset = false;
+};
+
+#endif // LATENCYTRACKER_H
@@ -48,12 +48,17 @@ void Recorder::setFormat(Recorder::RecorderFormat format)
     m_format = format;
 }
 
+void Recorder::setCodecId(AVCodecID codecId)
+{
+    m_codecId = codecId;
+}
+
 bool Recorder::open()
 {
     // codec
-    const AVCodec* inputCodec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    const AVCodec* inputCodec = avcodec_find_decoder(m_codecId);
     if (!inputCodec) {
-        qCritical("H.264 decoder not found");
+        qCritical("%s decoder not found", avcodec_get_name(m_codecId));
         return false;
     }
 
@@ -94,6 +99,10 @@ bool Recorder::open()
     outStream->codecpar->format = AV_PIX_FMT_YUV420P;
     outStream->codecpar->width = m_declaredFrameSize.width();
     outStream->codecpar->height = m_declaredFrameSize.height();
+    if (m_codecId == AV_CODEC_ID_HEVC && m_format == RECORDER_FORMAT_MP4) {
+        // hvc1 (parameter sets only in the sample description) is what most players expect
+        outStream->codecpar->codec_tag = MKTAG('h', 'v', 'c', '1');
+    }
 #else
     outStream->codec->codec_type = AVMEDIA_TYPE_VIDEO;
     outStream->codec->codec_id = inputCodec->id;
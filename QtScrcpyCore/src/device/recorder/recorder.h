@@ -28,6 +28,8 @@ public:
 
     void setFrameSize(const QSize &declaredFrameSize);
     void setFormat(Recorder::RecorderFormat format);
+    // 录制文件保留原始编码，在open之前设置
+    void setCodecId(AVCodecID codecId);
     bool open();
     void close();
     bool write(AVPacket *packet);
@@ -54,6 +56,7 @@ private:
     QString m_fileName = "";
     AVFormatContext *m_formatCtx = Q_NULLPTR;
     QSize m_declaredFrameSize;
+    AVCodecID m_codecId = AV_CODEC_ID_H264;
     bool m_headerWritten = false;
     RecorderFormat m_format = RECORDER_FORMAT_NULL;
     QMutex m_mutex;
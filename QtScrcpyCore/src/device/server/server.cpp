@@ -179,6 +179,10 @@ bool Server::execute()
     if (!m_params.codecOptions.isEmpty()) {
         args << QString("codec_options=%1").arg(m_params.codecOptions);
     }
+    // 默认是h264，不需要设置
+    if (!m_params.videoCodec.isEmpty() && m_params.videoCodec != "h264") {
+        args << QString("video_codec=%1").arg(m_params.videoCodec);
+    }
     if (!m_params.codecName.isEmpty()) {
         args << QString("encoder_name=%1").arg(m_params.codecName);
     }
@@ -270,6 +274,11 @@ Server::ServerParams Server::getParams()
     return m_params;
 }
 
+quint32 Server::getVideoCodecId()
+{
+    return m_videoCodecId;
+}
+
 void Server::timerEvent(QTimerEvent *event)
 {
     if (event && m_acceptTimeoutTimer == event->timerId()) {
@@ -305,6 +314,18 @@ QTcpSocket *Server::getControlSocket()
     return m_controlSocket;
 }
 
+QTcpSocket *Server::removeControlSocket()
+{
+    QTcpSocket *socket = m_controlSocket;
+    m_controlSocket = Q_NULLPTR;
+    if (socket) {
+        // 连接阶段的信号是直接连接，socket移到其他线程后不能再调用到这里
+        socket->disconnect(this);
+        socket->setParent(nullptr);
+    }
+    return socket;
+}
+
 void Server::stop()
 {
     if (m_tunnelForward) {
@@ -413,7 +434,8 @@ bool Server::readInfo(VideoSocket *videoSocket, QString &deviceName, QSize &size
     buf[DEVICE_NAME_FIELD_LENGTH - 1] = '\0'; // in case the client sends garbage
     deviceName = QString::fromUtf8((const char *)buf);
 
-    // 前4个字节是AVCodecID,当前只支持H264,所以先不解析
+    // 前4个字节是codec id
+    m_videoCodecId = bufferRead32be(&buf[DEVICE_NAME_FIELD_LENGTH]);
     size.setWidth(bufferRead32be(&buf[DEVICE_NAME_FIELD_LENGTH + 4]));
     size.setHeight(bufferRead32be(&buf[DEVICE_NAME_FIELD_LENGTH + 8]));
 
@@ -454,8 +476,9 @@ bool Server::readInfoAsync(VideoSocket *videoSocket)
     buf[DEVICE_NAME_FIELD_LENGTH - 1] = '\0'; // in case the client sends garbage
     m_pendingDeviceName = QString::fromUtf8((const char *)buf);
 
-    // 前4个字节是AVCodecID,当前只支持H264,所以先不解析
+    // 前4个字节是codec id
     quint32 codecId = bufferRead32be(&buf[DEVICE_NAME_FIELD_LENGTH]);
+    m_videoCodecId = codecId;
     quint32 width = bufferRead32be(&buf[DEVICE_NAME_FIELD_LENGTH + 4]);
     quint32 height = bufferRead32be(&buf[DEVICE_NAME_FIELD_LENGTH + 8]);
     
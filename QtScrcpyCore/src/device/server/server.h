@@ -51,7 +51,9 @@ public:
         // 例如 CodecOptions="profile=1,level=2"
         // 更多编码选项参考 https://d.android.com/reference/android/media/MediaFormat
         QString codecOptions = "";
-        // 指定编码器名称(必须是H.264编码器)，""表示默认
+        // 视频编码 h264/h265/av1
+        QString videoCodec = "h264";
+        // 指定编码器名称(必须与videoCodec一致)，""表示默认
         // 例如 CodecName="OMX.qcom.video.encoder.avc"
         QString codecName = "";
 
@@ -76,6 +78,10 @@ public:
     Server::ServerParams getParams();
     VideoSocket *removeVideoSocket();
     QTcpSocket *getControlSocket();
+    // 移交control socket，之后由调用者负责关闭
+    QTcpSocket *removeControlSocket();
+    // 视频流头部的codec id（scrcpy格式，如"h264"的ASCII），0表示未知
+    quint32 getVideoCodecId();
 
 signals:
     void serverStarted(bool success, const QString &deviceName = "", const QSize &size = QSize());
@@ -149,6 +155,7 @@ private:
     quint32 m_restartCount = 0;
     QString m_deviceName = "";
     QSize m_deviceSize = QSize();
+    quint32 m_videoCodecId = 0;
     ServerParams m_params;
 
     SERVER_START_STEP m_serverStartStep = SSS_NULL;
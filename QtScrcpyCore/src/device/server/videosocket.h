@@ -9,8 +9,6 @@ class VideoSocket : public QTcpSocket
 public:
     explicit VideoSocket(QObject *parent = nullptr);
     virtual ~VideoSocket();
-
-    qint32 subThreadRecvData(quint8 *buf, qint32 bufSize);
 };
 
 #endif // VIDEOSOCKET_H
@@ -0,0 +1,276 @@
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "broadcastengine.h"
+#include "controlchannel.h"
+#include "controlmsg.h"
+#include "device.h"
+
+// type: 1 byte; action: 1 byte; pointer id: 8 bytes
+#define TOUCH_POSITION_OFFSET 10
+#define TOUCH_MSG_SIZE 32
+// type: 1 byte
+#define SCROLL_POSITION_OFFSET 1
+#define SCROLL_MSG_SIZE 21
+
+namespace qsc {
+
+namespace {
+
+quint32 read32be(const char *buf)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(buf);
+    return (static_cast<quint32>(p[0]) << 24) | (static_cast<quint32>(p[1]) << 16) | (static_cast<quint32>(p[2]) << 8) | p[3];
+}
+
+quint16 read16be(const char *buf)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(buf);
+    return static_cast<quint16>((p[0] << 8) | p[1]);
+}
+
+void write32be(char *buf, quint32 value)
+{
+    buf[0] = static_cast<char>(value >> 24);
+    buf[1] = static_cast<char>(value >> 16);
+    buf[2] = static_cast<char>(value >> 8);
+    buf[3] = static_cast<char>(value);
+}
+
+void write16be(char *buf, quint16 value)
+{
+    buf[0] = static_cast<char>(value >> 8);
+    buf[1] = static_cast<char>(value);
+}
+
+}
+
+struct BroadcastEngine::Plan
+{
+    struct Member
+    {
+        QString serial;
+        // only dereferenced on the control I/O thread, where channels are deleted
+        QPointer<ControlChannel> channel;
+        int sizeClass = 0;
+    };
+    QVector<Member> members;
+    // 成员的画面尺寸，每种尺寸一个负载
+    QVector<QSize> sizeClasses;
+};
+
+struct BroadcastEngine::Stats
+{
+    struct Skew
+    {
+        qint64 lastUs = -1;
+        qint64 avgUs = -1;
+    };
+
+    QMutex mutex;
+    quint64 messages = 0;
+    quint64 encodes = 0;
+    qint64 lastSpreadUs = -1;
+    qint64 maxSpreadUs = -1;
+    QHash<QString, Skew> skew;
+};
+
+BroadcastEngine::BroadcastEngine(QObject *parent)
+    : QObject(parent)
+    , m_stats(new Stats)
+{
+    m_ioContext = new QObject();
+    m_ioContext->moveToThread(ControlChannel::ioThread());
+}
+
+BroadcastEngine::~BroadcastEngine()
+{
+    setGroup(Q_NULLPTR, QList<Device *>());
+    // queued fan-outs only hold shared plans and stats
+    m_ioContext->deleteLater();
+}
+
+void BroadcastEngine::setGroup(Device *host, const QList<Device *> &members)
+{
+    if (m_host) {
+        m_host->setControlTap(Q_NULLPTR);
+    }
+    for (const auto &member : m_members) {
+        if (member) {
+            disconnect(member, Q_NULLPTR, this, Q_NULLPTR);
+        }
+    }
+    m_members.clear();
+    m_host = host;
+
+    if (!m_host) {
+        std::atomic_store(&m_plan, std::shared_ptr<const Plan>());
+        return;
+    }
+
+    m_host->setControlTap([this](const QByteArray &buffer) {
+        broadcast(buffer);
+    });
+    for (Device *member : members) {
+        if (!member || member == host) {
+            continue;
+        }
+        m_members.append(member);
+        connect(member, &Device::controlChannelChanged, this, &BroadcastEngine::rebuildPlan);
+        connect(member, &Device::frameSizeChanged, this, &BroadcastEngine::rebuildPlan);
+        // the member is half destroyed at this point, rebuild once it is gone
+        connect(member, &QObject::destroyed, this, &BroadcastEngine::rebuildPlan, Qt::QueuedConnection);
+    }
+    rebuildPlan();
+}
+
+void BroadcastEngine::rebuildPlan()
+{
+    std::shared_ptr<Plan> plan(new Plan);
+    for (const auto &member : m_members) {
+        if (!member) {
+            continue;
+        }
+        ControlChannel *channel = member->controlChannel();
+        if (!channel) {
+            // not connected yet, controlChannelChanged rebuilds the plan
+            continue;
+        }
+        const QSize size = member->frameSize();
+        int sizeClass = plan->sizeClasses.indexOf(size);
+        if (sizeClass < 0) {
+            sizeClass = plan->sizeClasses.size();
+            plan->sizeClasses.append(size);
+        }
+        Plan::Member item;
+        item.serial = member->getSerial();
+        item.channel = channel;
+        item.sizeClass = sizeClass;
+        plan->members.append(item);
+    }
+    // broadcast runs wherever the host sends from, including the input timing thread
+    std::atomic_store(&m_plan, std::shared_ptr<const Plan>(plan));
+    qInfo() << "broadcast group members:" << plan->members.size() << "screen sizes:" << plan->sizeClasses.size();
+}
+
+void BroadcastEngine::broadcast(const QByteArray &buffer)
+{
+    std::shared_ptr<const Plan> plan = std::atomic_load(&m_plan);
+    if (!plan || plan->members.isEmpty() || buffer.isEmpty()) {
+        return;
+    }
+
+    int offset = -1;
+    const char type = buffer.at(0);
+    if (type == ControlMsg::CMT_INJECT_TOUCH && buffer.size() >= TOUCH_MSG_SIZE) {
+        offset = TOUCH_POSITION_OFFSET;
+    } else if (type == ControlMsg::CMT_INJECT_SCROLL && buffer.size() >= SCROLL_MSG_SIZE) {
+        offset = SCROLL_POSITION_OFFSET;
+    }
+
+    // every size class shares the host payload until it has to be rescaled
+    QVector<QByteArray> payloads(plan->sizeClasses.size(), buffer);
+    quint64 encodes = 1;
+    if (offset >= 0) {
+        // position: x 4 bytes, y 4 bytes, screen width 2 bytes, screen height 2 bytes
+        const char *position = buffer.constData() + offset;
+        const int width = read16be(position + 8);
+        const int height = read16be(position + 10);
+        if (width > 0 && height > 0) {
+            const double x = static_cast<qint32>(read32be(position)) / static_cast<double>(width);
+            const double y = static_cast<qint32>(read32be(position + 4)) / static_cast<double>(height);
+            for (int i = 0; i < plan->sizeClasses.size(); ++i) {
+                const QSize &size = plan->sizeClasses[i];
+                if (size.isEmpty() || (size.width() == width && size.height() == height)) {
+                    continue;
+                }
+                char *out = payloads[i].data() + offset;
+                write32be(out, static_cast<quint32>(qRound(x * size.width())));
+                write32be(out + 4, static_cast<quint32>(qRound(y * size.height())));
+                write16be(out + 8, static_cast<quint16>(size.width()));
+                write16be(out + 10, static_cast<quint16>(size.height()));
+                encodes++;
+            }
+        }
+    }
+
+    {
+        QMutexLocker locker(&m_stats->mutex);
+        m_stats->messages++;
+        m_stats->encodes += encodes;
+    }
+
+    std::shared_ptr<Stats> stats = m_stats;
+    QMetaObject::invokeMethod(m_ioContext, [plan, payloads, stats]() {
+        fanOut(plan, payloads, stats);
+    }, Qt::QueuedConnection);
+}
+
+void BroadcastEngine::fanOut(const std::shared_ptr<const Plan> &plan, const QVector<QByteArray> &payloads,
+                             const std::shared_ptr<Stats> &stats)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QVector<qint64> writtenNs(plan->members.size(), -1);
+    qint64 firstNs = -1;
+    qint64 lastNs = -1;
+    for (int i = 0; i < plan->members.size(); ++i) {
+        const Plan::Member &member = plan->members[i];
+        ControlChannel *channel = member.channel.data();
+        if (!channel || !channel->writeDirect(payloads[member.sizeClass])) {
+            continue;
+        }
+        lastNs = timer.nsecsElapsed();
+        if (firstNs < 0) {
+            firstNs = lastNs;
+        }
+        writtenNs[i] = lastNs;
+    }
+    if (firstNs < 0) {
+        return;
+    }
+
+    QMutexLocker locker(&stats->mutex);
+    stats->lastSpreadUs = (lastNs - firstNs) / 1000;
+    stats->maxSpreadUs = qMax(stats->maxSpreadUs, stats->lastSpreadUs);
+    for (int i = 0; i < plan->members.size(); ++i) {
+        if (writtenNs[i] < 0) {
+            continue;
+        }
+        const qint64 skewUs = (writtenNs[i] - firstNs) / 1000;
+        Stats::Skew &skew = stats->skew[plan->members[i].serial];
+        skew.lastUs = skewUs;
+        skew.avgUs = skew.avgUs < 0 ? skewUs : (skew.avgUs * 7 + skewUs) / 8;
+    }
+}
+
+BroadcastStats BroadcastEngine::stats()
+{
+    BroadcastStats stats;
+    std::shared_ptr<const Plan> plan = std::atomic_load(&m_plan);
+    QMutexLocker locker(&m_stats->mutex);
+    stats.messages = m_stats->messages;
+    stats.encodes = m_stats->encodes;
+    stats.lastSpreadUs = m_stats->lastSpreadUs;
+    stats.maxSpreadUs = m_stats->maxSpreadUs;
+    if (!plan) {
+        return stats;
+    }
+    stats.members = plan->members.size();
+    stats.sizeClasses = plan->sizeClasses.size();
+    for (const auto &member : plan->members) {
+        BroadcastMemberStats item;
+        item.serial = member.serial;
+        item.width = plan->sizeClasses[member.sizeClass].width();
+        item.height = plan->sizeClasses[member.sizeClass].height();
+        const Stats::Skew skew = m_stats->skew.value(member.serial);
+        item.lastSkewUs = skew.lastUs;
+        item.avgSkewUs = skew.avgUs;
+        stats.memberStats.push_back(item);
+    }
+    return stats;
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef BROADCASTENGINE_H
+#define BROADCASTENGINE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSize>
+#include <QVector>
+
+#include <memory>
+
+#include "../../include/QtScrcpyCore.h"
+
+class ControlChannel;
+
+namespace qsc {
+
+class Device;
+
+// 群控广播
+// 主控设备的Controller每产生一条控制消息（已序列化）就广播给所有成员：
+// - 成员的控制通道和画面尺寸只在成员变化（连接/断开/旋转）时解析一次
+// - 触摸和滚动消息的坐标归一化一次，每种成员画面尺寸只编码一次，尺寸相同的成员共享同一个负载
+// - 负载在控制I/O线程中依次写入所有成员的socket，不经过每个设备的队列，
+//   同时记录每个成员相对第一个写入的成员的时间差（skew）
+class BroadcastEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BroadcastEngine(QObject *parent = Q_NULLPTR);
+    virtual ~BroadcastEngine();
+
+    // 在GUI线程调用，host为空时停止广播
+    void setGroup(Device *host, const QList<Device *> &members);
+    BroadcastStats stats();
+
+private:
+    struct Plan;
+    struct Stats;
+
+    // 在GUI线程调用，成员的控制通道或画面尺寸变化时重建
+    void rebuildPlan();
+    void broadcast(const QByteArray &buffer);
+    // 在控制I/O线程中运行
+    static void fanOut(const std::shared_ptr<const Plan> &plan, const QVector<QByteArray> &payloads,
+                       const std::shared_ptr<Stats> &stats);
+
+private:
+    QPointer<Device> m_host;
+    QList<QPointer<Device>> m_members;
+    // accessed with std::atomic_load/atomic_store
+    std::shared_ptr<const Plan> m_plan;
+    std::shared_ptr<Stats> m_stats;
+    // lives on the control I/O thread
+    QObject *m_ioContext = Q_NULLPTR;
+};
+
+}
+
+#endif // BROADCASTENGINE_H
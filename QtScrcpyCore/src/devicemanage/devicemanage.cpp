@@ -4,9 +4,13 @@
 #include <QWheelEvent>
 #include <QMutexLocker>
 
+#include "broadcastengine.h"
+#include "controlchannel.h"
 #include "devicemanage.h"
 #include "device.h"
 #include "demuxer.h"
+#include "decodescheduler.h"
+#include "inputscheduler.h"
 
 namespace qsc {
 
@@ -19,10 +23,14 @@ IDeviceManage& IDeviceManage::getInstance() {
 
 DeviceManage::DeviceManage() {
     Demuxer::init();
+    m_broadcast = new BroadcastEngine(this);
 }
 
 DeviceManage::~DeviceManage() {
     Demuxer::deInit();
+    DecodeScheduler::instance().stop();
+    InputScheduler::instance().stop();
+    ControlChannel::stopIoThread();
 }
 
 QPointer<IDevice> DeviceManage::getDevice(const QString &serial)
@@ -126,11 +134,27 @@ void DeviceManage::disconnectAllDevice()
     }
 }
 
+void DeviceManage::setBroadcastGroup(const QString &hostSerial, const QStringList &members)
+{
+    m_broadcastHost = hostSerial;
+    m_broadcastMembers = members;
+    updateBroadcastGroup();
+}
+
+BroadcastStats DeviceManage::broadcastStats()
+{
+    return m_broadcast->stats();
+}
+
 void DeviceManage::onDeviceConnected(bool success, const QString &serial, const QString &deviceName, const QSize &size)
 {
     emit deviceConnected(success, serial, deviceName, size);
     if (!success) {
         removeDevice(serial);
+        return;
+    }
+    if (serial == m_broadcastHost || m_broadcastMembers.contains(serial)) {
+        updateBroadcastGroup();
     }
 }
 
@@ -179,6 +203,23 @@ quint16 DeviceManage::getFreePort()
     return 0;
 }
 
+void DeviceManage::updateBroadcastGroup()
+{
+    Device *host = Q_NULLPTR;
+    if (!m_broadcastHost.isEmpty()) {
+        host = qobject_cast<Device *>(m_devices.value(m_broadcastHost).data());
+    }
+    QList<Device *> members;
+    for (const auto &serial : m_broadcastMembers) {
+        Device *member = qobject_cast<Device *>(m_devices.value(serial).data());
+        if (member) {
+            members.append(member);
+        }
+    }
+    // 断开的设备由BroadcastEngine自己移出广播
+    m_broadcast->setGroup(host, members);
+}
+
 void DeviceManage::removeDevice(const QString &serial)
 {
     QMutexLocker locker(&m_portMutex);
@@ -8,6 +8,8 @@
 
 namespace qsc {
 
+class BroadcastEngine;
+
 class DeviceManage : public IDeviceManage
 {
     Q_OBJECT
@@ -21,6 +23,9 @@ public:
     bool disconnectDevice(const QString &serial) override;
     void disconnectAllDevice() override;
 
+    void setBroadcastGroup(const QString &hostSerial, const QStringList &members) override;
+    BroadcastStats broadcastStats() override;
+
 protected slots:
     void onDeviceConnected(bool success, const QString& serial, const QString& deviceName, const QSize& size);
     void onDeviceDisconnected(QString serial);
@@ -28,6 +33,8 @@ protected slots:
 private:
     quint16 getFreePort();
     void removeDevice(const QString& serial);
+    // 按序列号重新解析群控的主控设备和成员
+    void updateBroadcastGroup();
 
 private:
     QMap<QString, QPointer<IDevice>> m_devices;
@@ -35,6 +42,9 @@ private:
     quint16 m_localPortStart = 27183;
     QString m_script;
     QMutex m_portMutex;  // 保护端口分配和设备添加的并发访问
+    BroadcastEngine *m_broadcast = Q_NULLPTR;
+    QString m_broadcastHost;
+    QStringList m_broadcastMembers;
 };
 
 }
@@ -784,6 +784,15 @@ FluWindow {
             }
         }
 
+    // 窗口最小化或隐藏时暂停解码，恢复显示后在下一个关键帧处继续
+    onVisibilityChanged: {
+        if (!root.deviceSerial) {
+            return
+        }
+        const hidden = root.visibility === Window.Minimized || root.visibility === Window.Hidden
+        deviceManager.setDecodeMode(root.deviceSerial, hidden ? DeviceManager.DecodePaused : DeviceManager.DecodeFull)
+    }
+
     onVisibleChanged: {
         // 当窗口变为可见且选择"保持不变"时，确保窗口居中显示
         if (visible) {
@@ -31,6 +31,8 @@
 #include "sdk_wrapper/screenshot_image.h"
 #include "sdk_wrapper/video_render_item.h"
 #include "sdk_wrapper/video_render_item_ex.h"
+#include "sdk_wrapper/video_wall_item.h"
+#include "sdk_wrapper/software_video_item.h"
 // #include "sdk_wrapper/armcloud_engine_wrapper.h"
 // #include "sdk_wrapper/session_observer_wrapper.h"
 // #include "sdk_wrapper/batch_control_observer_wrapper.h"
@@ -121,6 +123,8 @@ int main(int argc, char *argv[])
     qmlRegisterType<NetworkParams>(uri, major, minor, "NetworkParams");
     qmlRegisterType<VideoRenderItem>(uri, major, minor, "VideoRenderItem");
     qmlRegisterType<VideoRenderItemEx>(uri, major, minor, "VideoRenderItemEx");
+    qmlRegisterType<VideoWallItem>(uri, major, minor, "VideoWallItem");
+    qmlRegisterType<SoftwareVideoItem>(uri, major, minor, "SoftwareVideoItem");
     // qmlRegisterType<SessionObserverWrapper>(uri, major, minor, "SessionObserver");
     // qmlRegisterType<DeviceListModel>(uri, major, minor, "DeviceListModel");
     qmlRegisterType<DeviceProxyModel>(uri, major, minor, "DeviceProxyModel");
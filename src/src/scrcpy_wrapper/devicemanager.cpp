@@ -12,6 +12,7 @@
 #include <QProcess>
 #include <QTimer>
 #include <QFileInfo>
+#include <QMetaMethod>
 #ifdef Q_OS_WIN
 #include <windows.h>
 #endif
@@ -63,6 +64,7 @@ void DeviceManager::connectDevice(const QString &serial)
     qDebug() << "serverVersion:" << params.serverVersion;
     qDebug() << "logLevel:" << params.logLevel;
     qDebug() << "codecOptions:" << params.codecOptions;
+    qDebug() << "videoCodec:" << params.videoCodec;
     qDebug() << "codecName:" << params.codecName;
 
     // 数值参数 (int/quint32/qint32)
@@ -159,6 +161,10 @@ bool DeviceManager::setUserData(const QString &serial, QObject *userData)
     auto dev = getDev(m_deviceManage, serial);
     if (dev.isNull()) return false;
     dev->setUserData(static_cast<void*>(userData));
+    auto it = m_observers.find(serial);
+    if (it != m_observers.end()) {
+        (*it)->resetSinkCache();
+    }
     return true;
 }
 
@@ -444,6 +450,63 @@ void DeviceManager::showTouch(const QString &serial, bool show)
     if (dev) dev->showTouch(show);
 }
 
+void DeviceManager::setDecodeMode(const QString &serial, int mode)
+{
+    if (mode < qsc::DECODE_FULL || mode > qsc::DECODE_PAUSED) {
+        qWarning() << "DeviceManager::setDecodeMode - invalid mode" << mode;
+        return;
+    }
+    auto dev = getDev(m_deviceManage, serial);
+    if (dev) dev->setDecodeMode(static_cast<qsc::DecodeMode>(mode));
+}
+
+QVariantMap DeviceManager::latencyStats(const QString &serial)
+{
+    static const char *const stageNames[qsc::LS_COUNT] = {
+        "network", "parse", "decode", "convert", "upload", "present", "total"
+    };
+
+    QVariantMap result;
+    auto dev = getDev(m_deviceManage, serial);
+    if (!dev) return result;
+
+    const qsc::LatencyStats stats = dev->latencyStats();
+    for (int i = 0; i < qsc::LS_COUNT; ++i) {
+        const qsc::LatencyPercentiles &stage = stats.stages[i];
+        QVariantMap item;
+        item["count"] = static_cast<qulonglong>(stage.count);
+        item["p50"] = static_cast<qlonglong>(stage.p50Us);
+        item["p95"] = static_cast<qlonglong>(stage.p95Us);
+        item["p99"] = static_cast<qlonglong>(stage.p99Us);
+        item["max"] = static_cast<qlonglong>(stage.maxUs);
+        result[stageNames[i]] = item;
+    }
+    return result;
+}
+
+void DeviceManager::setMaxFrameRate(const QString &serial, int fps)
+{
+    auto it = m_observers.find(serial);
+    if (it == m_observers.end()) {
+        qWarning() << "DeviceManager::setMaxFrameRate - no observer for" << serial;
+        return;
+    }
+    (*it)->setMaxFrameRate(fps);
+}
+
+QVariantMap DeviceManager::frameDeliveryStats(const QString &serial) const
+{
+    QVariantMap result;
+    auto it = m_observers.find(serial);
+    if (it == m_observers.end()) return result;
+
+    const qsc::FrameDeliveryStats stats = (*it)->deliveryStats();
+    result["delivered"] = static_cast<qulonglong>(stats.delivered);
+    result["decimated"] = static_cast<qulonglong>(stats.decimated);
+    result["unchanged"] = static_cast<qulonglong>(stats.unchanged);
+    return result;
+}
+
 void DeviceManager::onDeviceConnected(bool success, const QString &serial, const QString &deviceName, const QSize &size)
 {
     if (success) {
@@ -458,6 +521,10 @@ void DeviceManager::onDeviceConnected(bool success, const QString &serial, const
 void DeviceManager::onDeviceDisconnected(const QString &serial)
 {
     qInfo() << "Device disconnected:" << serial;
+    auto it = m_observers.find(serial);
+    if (it != m_observers.end()) {
+        (*it)->resetSinkCache();
+    }
     emit deviceDisconnected(serial);
 }
 
@@ -539,9 +606,10 @@ bool DeviceManager::registerObserver(const QString &serial)
     auto dev = m_deviceManage.getDevice(serial);
     if (dev.isNull()) return false;
     if (m_observers.contains(serial)) return true;
-    auto ob = QSharedPointer<ScrcpyObserver>::create(this, serial);
+    auto ob = QSharedPointer<ScrcpyObserver>::create(this, serial, dev);
     m_observers.insert(serial, ob);
-    dev->registerDeviceObserver(ob.data());
+    // YUV->ARGB转换在转换线程池中完成，不占用GUI线程；ScrcpyObserver的信号都是排队投递的
+    dev->registerDeviceObserver(ob.data(), qsc::FA_WORKER_POOL);
     
     // 连接 ScrcpyObserver 的信号到 DeviceManager 的转发方法
     // 这样 QML 可以通过 DeviceManager 的信号接收事件
@@ -624,6 +692,12 @@ void DeviceManager::emitNewFrame(const QString &serial, const QImage &frame)
     emit newFrame(serial, frame);
 }
 
+bool DeviceManager::hasNewFrameReceivers() const
+{
+    static const QMetaMethod newFrameSignal = QMetaMethod::fromSignal(&DeviceManager::newFrame);
+    return isSignalConnected(newFrameSignal);
+}
+
 void DeviceManager::emitFpsUpdated(const QString &serial, int fps)
 {
     emit fpsUpdated(serial, fps);
@@ -6,6 +6,7 @@
 #include <QHash>
 #include <QPointer>
 #include <QSharedPointer>
+#include <QVariantMap>
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QKeyEvent>
@@ -18,6 +19,15 @@ class DeviceManager : public QObject
 {
     Q_OBJECT
 public:
+    // 解码模式，与qsc::DecodeMode取值相同，QML中用DeviceManager.DecodePaused等名字
+    enum DecodeMode {
+        DecodeFull = qsc::DECODE_FULL,
+        DecodeSkipNonRef = qsc::DECODE_SKIP_NONREF,
+        DecodeKeyFrameOnly = qsc::DECODE_KEYFRAME_ONLY,
+        DecodePaused = qsc::DECODE_PAUSED,
+    };
+    Q_ENUM(DecodeMode)
+
     explicit DeviceManager(QObject *parent = nullptr);
     ~DeviceManager();
 
@@ -62,6 +72,14 @@ public:
 
     // others
     Q_INVOKABLE void screenshot(const QString &serial);
+    // 解码模式，取值见DecodeMode
+    Q_INVOKABLE void setDecodeMode(const QString &serial, int mode);
+    // 各阶段帧延迟 {network|parse|decode|convert|upload|present|total: {count, p50, p95, p99, max}}，单位us
+    Q_INVOKABLE QVariantMap latencyStats(const QString &serial);
+    // 内置 observer 的最高投递帧率（例如后台或缩略图只需要5~15fps），0表示不限制，可随时修改
+    Q_INVOKABLE void setMaxFrameRate(const QString &serial, int fps);
+    // 内置 observer 的帧投递统计 {delivered, decimated, unchanged}
+    Q_INVOKABLE QVariantMap frameDeliveryStats(const QString &serial) const;
 
     // observer control
     Q_INVOKABLE bool registerObserver(const QString &serial);
@@ -122,4 +140,6 @@ private:
     // Allow ScrcpyObserver to access manager
     friend class ScrcpyObserver;
     qsc::IDeviceManage* mgr() { return &m_deviceManage; }
+    // newFrame 没有连接时 ScrcpyObserver 可以跳过 QImage 的构造
+    bool hasNewFrameReceivers() const;
 };
@@ -3,6 +3,8 @@
 #include "../sdk_wrapper/video_frame.h"
 #include "../sdk_wrapper/video_render_item.h"
 #include "../sdk_wrapper/video_render_item_ex.h"
+#include "../sdk_wrapper/video_wall_item.h"
+#include "../sdk_wrapper/software_video_item.h"
 #include <QMetaObject>
 #include <libyuv.h>
 
@@ -30,6 +32,30 @@ void GridObserver::onFrame(int width, int height, uint8_t* dataY, uint8_t* dataU
     // 调用渲染目标的 onFrame（VideoRenderSink 实现会处理线程安全）
     m_renderSink->onFrame(videoFrame);
 
+    notifyFirstFrame(width, height);
+}
+
+void GridObserver::onFrameBuffer(const qsc::FrameBufferPtr& frame)
+{
+    if (!m_renderSink || !m_renderItem) return;
+
+    // 核心已按 frameFormat() 缩放/转换，这里只包装
+    auto videoFrame = m_adapter.adapt(m_renderSink, frame);
+    if (!videoFrame) return;
+    m_renderSink->onFrame(videoFrame);
+
+    notifyFirstFrame(frame->sourceWidth, frame->sourceHeight);
+}
+
+qsc::FrameFormat GridObserver::frameFormat() const
+{
+    // 缩略图只请求显示尺寸的像素，和同一设备上相同尺寸的其他视图共享转换
+    if (!m_renderSink || !m_renderItem) return qsc::FrameFormat();
+    return m_adapter.formatFor(m_renderSink, m_maxFrameRate.load(std::memory_order_relaxed));
+}
+
+void GridObserver::notifyFirstFrame(int width, int height)
+{
     // 发射首次帧信号
     if (!m_isFirstFrame) {
         m_isFirstFrame = true;
@@ -61,7 +87,7 @@ void GridObserver::setRenderSink(QObject *sink)
     }
     
     // 尝试将 QObject* 转换为 VideoRenderSink*
-    // VideoRenderItem 和 VideoRenderItemEx 都实现了 VideoRenderSink 接口
+    // VideoRenderItem、VideoRenderItemEx、SoftwareVideoItem 和 VideoWallTile 都实现了 VideoRenderSink 接口
     armcloud::VideoRenderSink* renderSink = nullptr;
     
     // 尝试转换为 VideoRenderItem
@@ -73,6 +99,11 @@ void GridObserver::setRenderSink(QObject *sink)
         VideoRenderItemEx* renderItemEx = qobject_cast<VideoRenderItemEx*>(sink);
         if (renderItemEx) {
             renderSink = renderItemEx;
+        } else if (SoftwareVideoItem* softwareItem = qobject_cast<SoftwareVideoItem*>(sink)) {
+            renderSink = softwareItem;
+        } else if (VideoWallTile* wallTile = qobject_cast<VideoWallTile*>(sink)) {
+            // 视频墙中的一个画面（VideoWallItem::tileSink）
+            renderSink = wallTile;
         }
     }
     
@@ -88,6 +119,24 @@ void GridObserver::setRenderSink(QObject *sink)
     m_renderSink = renderSink;
 }
 
+void GridObserver::setMaxFrameRate(int fps)
+{
+    fps = qMax(0, fps);
+    if (m_maxFrameRate.exchange(fps) != fps) {
+        emit maxFrameRateChanged();
+    }
+}
+
+QVariantMap GridObserver::deliveryStats() const
+{
+    const qsc::FrameDeliveryStats stats = qsc::DeviceObserver::deliveryStats();
+    QVariantMap result;
+    result["delivered"] = static_cast<qulonglong>(stats.delivered);
+    result["decimated"] = static_cast<qulonglong>(stats.decimated);
+    result["unchanged"] = static_cast<qulonglong>(stats.unchanged);
+    return result;
+}
+
 void GridObserver::setSerial(const QString &serial)
 {
     if (m_serial != serial) {
@@ -3,7 +3,10 @@
 #include <QObject>
 #include <QString>
 #include <QPointer>
+#include <QVariantMap>
+#include <atomic>
 #include "QtScrcpyCore.h"
+#include "render_frame_adapter.h"
 
 namespace armcloud {
 class VideoRenderSink;
@@ -13,12 +16,16 @@ class GridObserver : public QObject, public qsc::DeviceObserver
 {
     Q_OBJECT
     Q_PROPERTY(QString serial READ serial WRITE setSerial NOTIFY serialChanged)
+    // 核心向这个观察者投递的最高帧率，和渲染目标的 maxFrameRate 取较小值，0表示不限制
+    Q_PROPERTY(int maxFrameRate READ maxFrameRate WRITE setMaxFrameRate NOTIFY maxFrameRateChanged)
 public:
     explicit GridObserver(QObject *parent = nullptr);
     ~GridObserver() override = default;
 
     void onFrame(int width, int height, uint8_t* dataY, uint8_t* dataU, uint8_t* dataV, 
                  int linesizeY, int linesizeU, int linesizeV) override;
+    void onFrameBuffer(const qsc::FrameBufferPtr& frame) override;
+    qsc::FrameFormat frameFormat() const override;
     void updateFPS(quint32 fps) override;
     void grabCursor(bool grab) override;
 
@@ -29,15 +36,29 @@ public:
     QString serial() const { return m_serial; }
     void setSerial(const QString &serial);
 
+    int maxFrameRate() const { return m_maxFrameRate.load(std::memory_order_relaxed); }
+    void setMaxFrameRate(int fps);
+
+    // {delivered, decimated, unchanged}：已投递、按帧率上限抽掉、画面未变化跳过的帧数
+    Q_INVOKABLE QVariantMap deliveryStats() const;
+
 signals:
     void serialChanged();
+    void maxFrameRateChanged();
     void frameReceived(int width, int height);
     void fpsUpdated(int fps);
 
+private:
+    void notifyFirstFrame(int width, int height);
+
 private:
     QPointer<QObject> m_renderItem;  // 存储 QObject 引用（VideoRenderItem 继承自 QObject）
     armcloud::VideoRenderSink* m_renderSink;  // 原始指针，指向 m_renderItem 实现的接口
     QString m_serial;
     bool m_isFirstFrame;
+    // 按渲染目标的尺寸/帧率订阅帧规格
+    RenderFrameAdapter m_adapter;
+    // 在投递线程中读取
+    std::atomic<int> m_maxFrameRate{0};
 };
 
@@ -20,14 +20,15 @@ bool GroupController::isHost(const QString &serial)
     return m_hostSerial == serial;
 }
 
-QSize GroupController::getFrameSize(const QString &serial)
+void GroupController::updateBroadcastGroup()
 {
-    auto data = qsc::IDeviceManage::getInstance().getDevice(serial)->getUserData();
-    if (!data) {
-        return QSize();
+    QStringList members;
+    for (const auto& serial : m_devices) {
+        if (!isHost(serial)) {
+            members.append(serial);
+        }
     }
-
-    return QSize();
+    qsc::IDeviceManage::getInstance().setBroadcastGroup(m_hostSerial, members);
 }
 
 GroupController &GroupController::instance()
@@ -61,6 +62,7 @@ void GroupController::addDevice(const QString &serial)
     }
 
     m_devices.append(serial);
+    updateBroadcastGroup();
 }
 
 void GroupController::removeDevice(const QString &serial)
@@ -70,6 +72,7 @@ void GroupController::removeDevice(const QString &serial)
     }
 
     m_devices.removeOne(serial);
+    updateBroadcastGroup();
 
     auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
     if (!device) {
@@ -91,310 +94,15 @@ void GroupController::setRenderSink(const QString &serial, armcloud::VideoRender
 void GroupController::setHost(const QString &serial)
 {
     m_hostSerial = serial;
+    updateBroadcastGroup();
 }
 
-void GroupController::mouseEvent(const QMouseEvent *from, const QSize &frameSize, const QSize &showSize)
-{
-    qDebug() << "GroupController::mouseEvent" << from << frameSize << showSize;
-    Q_UNUSED(frameSize);
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->mouseEvent(from, frameSize, showSize);
-    }
-}
-
-void GroupController::wheelEvent(const QWheelEvent *from, const QSize &frameSize, const QSize &showSize)
-{
-    Q_UNUSED(frameSize);
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->wheelEvent(from, getFrameSize(serial), showSize);
-    }
-}
-
-void GroupController::keyEvent(const QKeyEvent *from, const QSize &frameSize, const QSize &showSize)
-{
-    Q_UNUSED(frameSize);
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->keyEvent(from, getFrameSize(serial), showSize);
-    }
-}
-
-void GroupController::postGoBack()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postGoBack();
-    }
-}
-
-void GroupController::postGoHome()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postGoHome();
-    }
-}
-
-void GroupController::postGoMenu()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postGoMenu();
-    }
-}
-
-void GroupController::postAppSwitch()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postAppSwitch();
-    }
-}
-
-void GroupController::postPower()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postPower();
-    }
-}
-
-void GroupController::postVolumeUp()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postVolumeUp();
-    }
-}
-
-void GroupController::postVolumeDown()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postVolumeDown();
-    }
-}
-
-void GroupController::postCopy()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postCopy();
-    }
-}
-
-void GroupController::postCut()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postCut();
-    }
-}
-
-void GroupController::setDisplayPower(bool on)
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->setDisplayPower(on);
-    }
-}
-
-void GroupController::expandNotificationPanel()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->expandNotificationPanel();
-    }
-}
-
-void GroupController::collapsePanel()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->collapsePanel();
-    }
-}
-
-void GroupController::postBackOrScreenOn(bool down)
+qsc::FrameFormat GroupController::frameFormat() const
 {
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postBackOrScreenOn(down);
-    }
-}
-
-void GroupController::postTextInput(QString &text)
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postTextInput(text);
-    }
-}
-
-void GroupController::requestDeviceClipboard()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->requestDeviceClipboard();
-    }
-}
-
-void GroupController::setDeviceClipboard(bool pause)
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->setDeviceClipboard(pause);
-    }
-}
-
-void GroupController::clipboardPaste()
-{
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->clipboardPaste();
-    }
+    // 群控只转发输入，不需要画面
+    qsc::FrameFormat format;
+    format.receiveFrames = false;
+    return format;
 }
 
 void GroupController::pushFileRequest(const QString &file, const QString &devicePath)
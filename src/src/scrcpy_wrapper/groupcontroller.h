@@ -21,27 +21,9 @@ public:
     Q_INVOKABLE void setHost(const QString& serial);
 private:
     // DeviceObserver
-    void mouseEvent(const QMouseEvent *from, const QSize &frameSize, const QSize &showSize) override;
-    void wheelEvent(const QWheelEvent *from, const QSize &frameSize, const QSize &showSize) override;
-    void keyEvent(const QKeyEvent *from, const QSize &frameSize, const QSize &showSize) override;
-
-    void postGoBack() override;
-    void postGoHome() override;
-    void postGoMenu() override;
-    void postAppSwitch() override;
-    void postPower() override;
-    void postVolumeUp() override;
-    void postVolumeDown() override;
-    void postCopy() override;
-    void postCut() override;
-    void setDisplayPower(bool on) override;
-    void expandNotificationPanel() override;
-    void collapsePanel() override;
-    void postBackOrScreenOn(bool down) override;
-    void postTextInput(QString &text) override;
-    void requestDeviceClipboard() override;
-    void setDeviceClipboard(bool pause = true) override;
-    void clipboardPaste() override;
+    qsc::FrameFormat frameFormat() const override;
+    // 控制消息由主控设备的Controller广播（IDeviceManage::setBroadcastGroup），
+    // 这里只转发不经过控制通道的操作
     void pushFileRequest(const QString &file, const QString &devicePath = "") override;
     void installApkRequest(const QString &apkFile) override;
     void screenshot() override;
@@ -50,7 +32,7 @@ private:
 private:
     explicit GroupController(QObject *parent = nullptr);
     bool isHost(const QString& serial);
-    QSize getFrameSize(const QString& serial);
+    void updateBroadcastGroup();
 
 private:
     QVector<QString> m_devices;
@@ -0,0 +1,139 @@
+#include "render_frame_adapter.h"
+#include "../sdk_wrapper/video_render_sink.h"
+#include "../sdk_wrapper/video_frame.h"
+#include <libyuv.h>
+
+// 能渲染 YUV 的渲染端在 GPU 上缩放，只有目标像素数不到源帧的一半时才值得在 CPU 上缩小后拷贝
+#define YUV_SCALE_MAX_RATIO 0.5
+
+void RenderFrameAdapter::fitSize(int srcWidth, int srcHeight, uint32_t maxWidth, uint32_t maxHeight, int& dstWidth, int& dstHeight)
+{
+    dstWidth = srcWidth;
+    dstHeight = srcHeight;
+    if (srcWidth <= 0 || srcHeight <= 0 || maxWidth == 0 || maxHeight == 0) {
+        return;
+    }
+
+    // 渲染端可能旋转显示，长边对长边、短边对短边
+    const double boxLong = qMax(maxWidth, maxHeight);
+    const double boxShort = qMin(maxWidth, maxHeight);
+    const double scale = qMin(boxLong / qMax(srcWidth, srcHeight), boxShort / qMin(srcWidth, srcHeight));
+    if (scale >= 1.0) {
+        return;
+    }
+    dstWidth = qMax(2, static_cast<int>(srcWidth * scale + 0.5) & ~1);
+    dstHeight = qMax(2, static_cast<int>(srcHeight * scale + 0.5) & ~1);
+}
+
+qsc::FrameFormat RenderFrameAdapter::formatFor(const armcloud::VideoRenderSink* sink, int maxFps) const
+{
+    qsc::FrameFormat format;
+    if (!sink) {
+        return format;
+    }
+
+    const armcloud::RenderHints hints = sink->renderHints();
+    const int sinkFps = static_cast<int>(hints.maxFps);
+    format.maxFps = (sinkFps > 0 && maxFps > 0) ? qMin(sinkFps, maxFps) : qMax(sinkFps, maxFps);
+    format.format = sink->acceptsYuv() ? qsc::PF_I420 : qsc::PF_ARGB;
+
+    const int srcWidth = m_sourceWidth.load(std::memory_order_relaxed);
+    const int srcHeight = m_sourceHeight.load(std::memory_order_relaxed);
+    int dstWidth = srcWidth;
+    int dstHeight = srcHeight;
+    fitSize(srcWidth, srcHeight, hints.maxWidth, hints.maxHeight, dstWidth, dstHeight);
+    if (dstWidth == srcWidth && dstHeight == srcHeight) {
+        // 源尺寸（或还不知道源尺寸）
+        return format;
+    }
+    if (format.format == qsc::PF_I420 && sink->gpuScaling()) {
+        const double ratio = static_cast<double>(dstWidth) * dstHeight / (static_cast<double>(srcWidth) * srcHeight);
+        if (ratio > YUV_SCALE_MAX_RATIO) {
+            // 直接引用解码器平面
+            return format;
+        }
+    }
+    format.width = dstWidth;
+    format.height = dstHeight;
+    return format;
+}
+
+std::shared_ptr<armcloud::VideoFrame> RenderFrameAdapter::adapt(armcloud::VideoRenderSink* sink, const qsc::FrameBufferPtr& frame)
+{
+    if (!sink || !frame) {
+        return nullptr;
+    }
+    m_sourceWidth.store(frame->sourceWidth, std::memory_order_relaxed);
+    m_sourceHeight.store(frame->sourceHeight, std::memory_order_relaxed);
+
+    // 核心已按订阅规格转换，直接引用
+    std::shared_ptr<armcloud::VideoFrame> wrapped;
+    if (frame->format == qsc::PF_I420 && sink->acceptsYuv()) {
+        wrapped = std::make_shared<armcloud::VideoFrame>(frame->width, frame->height, armcloud::PixelFormat::YUV420P,
+                                                         frame->data, frame->linesize, frame);
+    } else if (frame->format == qsc::PF_ARGB) {
+        wrapped = std::make_shared<armcloud::VideoFrame>(frame->width, frame->height, armcloud::PixelFormat::ARGB,
+                                                         frame->data, frame->linesize, frame);
+    }
+    if (wrapped) {
+        // 变化区域随帧传给渲染端做局部上传
+        std::vector<armcloud::FrameRegion> regions;
+        regions.reserve(frame->dirtyRects.size());
+        for (const qsc::FrameRect& rect : frame->dirtyRects) {
+            armcloud::FrameRegion region;
+            region.x = rect.x;
+            region.y = rect.y;
+            region.width = rect.width;
+            region.height = rect.height;
+            regions.push_back(region);
+        }
+        wrapped->setContent(frame->contentId, std::move(regions));
+        return wrapped;
+    }
+    if (frame->format != qsc::PF_I420) {
+        return nullptr;
+    }
+
+    // I420 送给只能渲染 ARGB 的渲染端：先缩小再转换，只处理显示尺寸的像素
+    const armcloud::RenderHints hints = sink->renderHints();
+    const int srcWidth = frame->width;
+    const int srcHeight = frame->height;
+    int dstWidth = srcWidth;
+    int dstHeight = srcHeight;
+    fitSize(srcWidth, srcHeight, hints.maxWidth, hints.maxHeight, dstWidth, dstHeight);
+
+    const uint8_t* planes[3] = { frame->data[0], frame->data[1], frame->data[2] };
+    int strides[3] = { frame->linesize[0], frame->linesize[1], frame->linesize[2] };
+    if (dstWidth != srcWidth || dstHeight != srcHeight) {
+        const int chromaWidth = dstWidth / 2;
+        const int chromaHeight = dstHeight / 2;
+        const size_t lumaSize = static_cast<size_t>(dstWidth) * dstHeight;
+        const size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+        m_scaled.resize(lumaSize + chromaSize * 2);
+        uint8_t* scaledY = m_scaled.data();
+        uint8_t* scaledU = scaledY + lumaSize;
+        uint8_t* scaledV = scaledU + chromaSize;
+        libyuv::I420Scale(frame->data[0], frame->linesize[0],
+                          frame->data[1], frame->linesize[1],
+                          frame->data[2], frame->linesize[2],
+                          srcWidth, srcHeight,
+                          scaledY, dstWidth,
+                          scaledU, chromaWidth,
+                          scaledV, chromaWidth,
+                          dstWidth, dstHeight, libyuv::kFilterBox);
+        planes[0] = scaledY;
+        planes[1] = scaledU;
+        planes[2] = scaledV;
+        strides[0] = dstWidth;
+        strides[1] = chromaWidth;
+        strides[2] = chromaWidth;
+    }
+
+    auto videoFrame = std::make_shared<armcloud::VideoFrame>(dstWidth, dstHeight, armcloud::PixelFormat::ARGB);
+    libyuv::I420ToARGB(planes[0], strides[0],
+                       planes[1], strides[1],
+                       planes[2], strides[2],
+                       videoFrame->buffer(0), videoFrame->stride(0),
+                       dstWidth, dstHeight);
+    return videoFrame;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "QtScrcpyCore.h"
+
+namespace armcloud {
+class VideoRenderSink;
+class VideoFrame;
+}
+
+// 在观察者和渲染端之间协商帧规格：
+// - formatFor() 按渲染端的 RenderHints 生成向核心订阅的 qsc::FrameFormat：
+//   能渲染 YUV 的请求 I420（在GPU上缩放的渲染端只有显示尺寸不到源帧一半时才请求缩小），
+//   否则请求显示尺寸的 ARGB；
+//   缩放、颜色转换由核心完成，同一设备上相同规格的观察者共享一次转换；
+//   帧率上限也由核心按PTS抽帧，超出的帧不会唤醒观察者
+// - adapt() 把核心送来的帧包装成 VideoFrame，不拷贝像素
+// 同一实例的 adapt() 只能在一个线程中串行使用（观察者的回调本身是串行的）
+class RenderFrameAdapter
+{
+public:
+    RenderFrameAdapter() = default;
+
+    // maxFps为观察者自己的帧率上限，和渲染端的上限取较小值，0表示不限制
+    qsc::FrameFormat formatFor(const armcloud::VideoRenderSink* sink, int maxFps = 0) const;
+
+    // 格式与渲染端不符时（订阅规格刚变化，或帧来自旧的 onFrame 路径）在本地转换
+    std::shared_ptr<armcloud::VideoFrame> adapt(armcloud::VideoRenderSink* sink, const qsc::FrameBufferPtr& frame);
+
+    // 在 maxWidth x maxHeight 内（不区分横竖屏）保持比例缩小，不放大，结果为偶数
+    static void fitSize(int srcWidth, int srcHeight, uint32_t maxWidth, uint32_t maxHeight, int& dstWidth, int& dstHeight);
+
+private:
+    // 最近一帧的源尺寸，formatFor 据此计算目标尺寸
+    std::atomic<int> m_sourceWidth{0};
+    std::atomic<int> m_sourceHeight{0};
+    // 本地转换时缩放后的 I420 中间缓冲，按尺寸复用
+    std::vector<uint8_t> m_scaled;
+};
@@ -31,6 +31,7 @@ ScrcpyController::ScrcpyController(QObject *parent)
 ScrcpyController::~ScrcpyController()
 {
     if (m_device) {
+        m_device->setDecodeFocus(false);
         m_device->deRegisterDeviceObserver(this);
     }
 }
@@ -46,9 +47,15 @@ void ScrcpyController::initialize(QPointer<qsc::IDevice> device, armcloud::Video
         qWarning() << "ScrcpyController::initialize - sink is null";
         return;
     }
+    if (m_device && m_device != device) {
+        m_device->setDecodeFocus(false);
+        m_device->deRegisterDeviceObserver(this);
+    }
     m_device = device;
     m_sink = sink;
     m_device->registerDeviceObserver(this);
+    // 当前操作的设备优先解码
+    m_device->setDecodeFocus(true);
 
     connect(m_device, &qsc::IDevice::deviceConnected, this, [this](bool success, const QString& serial, const QString& deviceName, const QSize& size){
         if (success) {
@@ -66,12 +73,7 @@ void ScrcpyController::onFrame(int width, int height, uint8_t* dataY, uint8_t* d
         return;
     }
 
-    if(!m_isFirstFrame){
-        m_isFirstFrame = true;
-        emit screenInfo(width, height);
-    }
-
-    m_frameSize = QSize(width, height);
+    updateFrameSize(width, height);
 
     // Create an ARGB VideoFrame, which is what the existing rendering pipeline expects.
     auto videoFrame = std::make_shared<armcloud::VideoFrame>(width, height, armcloud::PixelFormat::ARGB);
@@ -83,10 +85,60 @@ void ScrcpyController::onFrame(int width, int height, uint8_t* dataY, uint8_t* d
                        videoFrame->buffer(0), videoFrame->stride(0),
                        width, height);
 
+    attachLatencyHook(videoFrame);
+
     // Call the sink's onFrame method (which is implemented by VideoRenderItem)
     m_sink->onFrame(videoFrame);
 }
 
+void ScrcpyController::onFrameBuffer(const qsc::FrameBufferPtr& frame)
+{
+    if (!m_sink) {
+        return;
+    }
+
+    // 输入坐标按设备原始分辨率映射，与送给渲染端的尺寸无关
+    updateFrameSize(frame->sourceWidth, frame->sourceHeight);
+
+    // 核心已按 frameFormat() 转换，YUV 渲染端直接引用解码器平面
+    auto videoFrame = m_adapter.adapt(m_sink, frame);
+    if (!videoFrame) {
+        return;
+    }
+    attachLatencyHook(videoFrame);
+    m_sink->onFrame(videoFrame);
+}
+
+qsc::FrameFormat ScrcpyController::frameFormat() const
+{
+    return m_adapter.formatFor(m_sink);
+}
+
+void ScrcpyController::updateFrameSize(int width, int height)
+{
+    if(!m_isFirstFrame){
+        m_isFirstFrame = true;
+        emit screenInfo(width, height);
+    }
+
+    m_frameSize = QSize(width, height);
+}
+
+void ScrcpyController::attachLatencyHook(const std::shared_ptr<armcloud::VideoFrame>& frame)
+{
+    const qint64 pts = framePts();
+    frame->setPts(pts);
+    if (pts < 0) {
+        return;
+    }
+    QPointer<qsc::IDevice> device = m_device;
+    frame->setStageCallback([device, pts](armcloud::FrameStage stage) {
+        if (device) {
+            device->markFrameStage(pts, stage == armcloud::FrameStage::Uploaded ? qsc::LS_UPLOAD : qsc::LS_PRESENT);
+        }
+    });
+}
+
 void ScrcpyController::updateFPS(quint32 fps)
 {
     emit fpsUpdated(fps);
@@ -5,6 +5,7 @@
 #include <QSize>
 #include "QtScrcpyCore.h"
 #include "../sdk_wrapper/video_render_sink.h"
+#include "render_frame_adapter.h"
 
 // Forward declarations for input events
 class QMouseEvent;
@@ -62,6 +63,8 @@ signals:
 protected:
     // Override from qsc::DeviceObserver
     void onFrame(int width, int height, uint8_t* dataY, uint8_t* dataU, uint8_t* dataV, int linesizeY, int linesizeU, int linesizeV) override;
+    void onFrameBuffer(const qsc::FrameBufferPtr& frame) override;
+    qsc::FrameFormat frameFormat() const override;
     void updateFPS(quint32 fps) override;
     void grabCursor(bool grab) override;
 
@@ -79,9 +82,14 @@ private:
     bool extractZip(const QString& zipPath, const QString& outputDir);
     // 辅助方法：推送 OBB 文件到设备
     void pushObbFiles(const QStringList& obbFiles, const QString& packageName);
+    // 首帧发射screenInfo并记录帧尺寸
+    void updateFrameSize(int width, int height);
+    // 渲染端上传/显示后上报延迟阶段
+    void attachLatencyHook(const std::shared_ptr<armcloud::VideoFrame>& frame);
 
     QPointer<qsc::IDevice> m_device;
     armcloud::VideoRenderSink* m_sink = nullptr;
     QSize m_frameSize;
     bool m_isFirstFrame;
+    RenderFrameAdapter m_adapter;
 };
@@ -6,73 +6,115 @@
 #include <QMetaObject>
 #include <libyuv.h>
 
-ScrcpyObserver::ScrcpyObserver(DeviceManager *owner, const QString &serial)
+ScrcpyObserver::ScrcpyObserver(DeviceManager *owner, const QString &serial, QPointer<qsc::IDevice> device)
     : QObject(owner)  // 将 DeviceManager 作为父对象
     , m_owner(owner)
     , m_serial(serial)
+    , m_device(device)
     , m_isFirstFrame(false)
     , m_lastWidth(0)
     , m_lastHeight(0)
 {
 }
 
+armcloud::VideoRenderSink* ScrcpyObserver::resolveSink() const
+{
+    if (!m_device) {
+        m_cachedUserData = nullptr;
+        m_cachedSink = nullptr;
+        return nullptr;
+    }
+
+    void* userData = m_device->getUserData();
+    if (m_sinkCacheDirty.exchange(false, std::memory_order_acquire) || userData != m_cachedUserData) {
+        m_cachedUserData = userData;
+        // VideoRenderItem inherits from both QQuickPaintedItem (QObject) and VideoRenderSink
+        // Try to cast to VideoRenderSink
+        m_cachedSink = userData ? dynamic_cast<armcloud::VideoRenderSink*>(static_cast<QObject*>(userData)) : nullptr;
+    }
+    return m_cachedSink;
+}
+
 void ScrcpyObserver::onFrame(int width, int height, uint8_t* dataY, uint8_t* dataU, uint8_t* dataV, 
                              int linesizeY, int linesizeU, int linesizeV)
 {
     if (!m_owner) return;
 
     // Check if userData is a VideoRenderSink and call it directly (more efficient)
-    if (m_owner) {
-        auto dev = m_owner->mgr()->getDevice(m_serial);
-        if (dev && dev->getUserData()) {
-            auto userData = static_cast<QObject*>(dev->getUserData());
-            // VideoRenderItem inherits from both QQuickPaintedItem (QObject) and VideoRenderSink
-            // Try to cast to VideoRenderSink
-            auto* sink = dynamic_cast<armcloud::VideoRenderSink*>(userData);
-            if (sink) {
-                // Create VideoFrame directly and call sink
-                auto videoFrame = std::make_shared<armcloud::VideoFrame>(width, height, armcloud::PixelFormat::ARGB);
-                libyuv::I420ToARGB(dataY, linesizeY,
-                                   dataU, linesizeU,
-                                   dataV, linesizeV,
-                                   videoFrame->buffer(0), videoFrame->stride(0),
-                                   width, height);
-                
-                // Call sink directly - VideoRenderSink implementations handle their own thread safety
-                sink->onFrame(videoFrame);
-                
-                // Also emit signal for QML if needed
-                QImage image(width, height, QImage::Format_ARGB32);
-                libyuv::I420ToARGB(dataY, linesizeY,
-                                   dataU, linesizeU,
-                                   dataV, linesizeV,
-                                   reinterpret_cast<uint8_t*>(image.bits()), image.bytesPerLine(),
-                                   width, height);
-                QMetaObject::invokeMethod(m_owner, "emitNewFrame", Qt::QueuedConnection,
-                                          Q_ARG(QString, m_serial),
-                                          Q_ARG(QImage, image));
-                
-                // 检测屏幕尺寸变化（第一帧或尺寸改变时发射 screenInfo 信号）
-                // 这样可以检测到屏幕旋转（比如打开横屏游戏时）
-                if (!m_isFirstFrame || m_lastWidth != width || m_lastHeight != height) {
-                    m_isFirstFrame = true;
-                    m_lastWidth = width;
-                    m_lastHeight = height;
-                    // 直接发射信号，不需要通过 DeviceManager
-                    QMetaObject::invokeMethod(this, "doEmitScreenInfo", Qt::QueuedConnection,
-                                              Q_ARG(int, width),
-                                              Q_ARG(int, height));
-                }
-                return;
-            }
+    auto* sink = resolveSink();
+    if (sink) {
+        // 只转换一次，渲染 sink 和 newFrame 信号共享同一块 ARGB 缓冲
+        auto videoFrame = std::make_shared<armcloud::VideoFrame>(width, height, armcloud::PixelFormat::ARGB);
+        libyuv::I420ToARGB(dataY, linesizeY,
+                           dataU, linesizeU,
+                           dataV, linesizeV,
+                           videoFrame->buffer(0), videoFrame->stride(0),
+                           width, height);
+        attachLatencyHook(videoFrame);
+
+        // Call sink directly - VideoRenderSink implementations handle their own thread safety
+        sink->onFrame(videoFrame);
+
+        // Also emit signal for QML if needed
+        emitNewFrameImage(videoFrame);
+    }
+
+    checkScreenSize(width, height);
+}
+
+void ScrcpyObserver::onFrameBuffer(const qsc::FrameBufferPtr& frame)
+{
+    if (!m_owner) return;
+
+    // 核心已按 frameFormat() 转换：YUV 时直接引用解码器平面（videoFrame 持有解码器缓冲区，
+    // 直到渲染线程用完），ARGB 时引用核心共享的转换结果
+    auto* sink = resolveSink();
+    if (sink) {
+        auto videoFrame = m_adapter.adapt(sink, frame);
+        if (videoFrame) {
+            attachLatencyHook(videoFrame);
+            sink->onFrame(videoFrame);
+            emitNewFrameImage(videoFrame);
         }
     }
 
-    // Fallback: convert to QImage (如果需要通过信号发送)
-    // 注意：如果 VideoRenderSink 已设置，就不需要这个分支了
-    // 但保留作为备用
+    checkScreenSize(frame->sourceWidth, frame->sourceHeight);
+}
+
+qsc::FrameFormat ScrcpyObserver::frameFormat() const
+{
+    auto* sink = resolveSink();
+    qsc::FrameFormat format = m_adapter.formatFor(sink, m_maxFrameRate.load(std::memory_order_relaxed));
+    if (sink && m_owner && m_owner->hasNewFrameReceivers()) {
+        // newFrame 需要全分辨率 ARGB 的 QImage，渲染端和 QImage 共享这一次转换
+        format.format = qsc::PF_ARGB;
+        format.width = 0;
+        format.height = 0;
+    }
+    return format;
+}
 
+void ScrcpyObserver::emitNewFrameImage(const std::shared_ptr<armcloud::VideoFrame>& frame)
+{
+    if (!m_owner || !m_owner->hasNewFrameReceivers() || frame->format() != armcloud::PixelFormat::ARGB) {
+        return;
+    }
+    // 只有 newFrame 有接收者时才构造 QImage，QImage 直接引用 videoFrame 的缓冲，
+    // 由 cleanupFunction 持有 shared_ptr，最后一个 QImage 副本析构时释放
+    auto* holder = new std::shared_ptr<armcloud::VideoFrame>(frame);
+    QImage image(frame->buffer(0), static_cast<int>(frame->width()), static_cast<int>(frame->height()),
+                 static_cast<qsizetype>(frame->stride(0)), QImage::Format_ARGB32,
+                 [](void* info) { delete static_cast<std::shared_ptr<armcloud::VideoFrame>*>(info); },
+                 holder);
+    QMetaObject::invokeMethod(m_owner, "emitNewFrame", Qt::QueuedConnection,
+                              Q_ARG(QString, m_serial),
+                              Q_ARG(QImage, image));
+}
+
+void ScrcpyObserver::checkScreenSize(int width, int height)
+{
     // 检测屏幕尺寸变化（第一帧或尺寸改变时发射 screenInfo 信号）
+    // 这样可以检测到屏幕旋转（比如打开横屏游戏时）
     if (!m_isFirstFrame || m_lastWidth != width || m_lastHeight != height) {
         m_isFirstFrame = true;
         m_lastWidth = width;
@@ -84,6 +126,22 @@ void ScrcpyObserver::onFrame(int width, int height, uint8_t* dataY, uint8_t* dat
     }
 }
 
+void ScrcpyObserver::attachLatencyHook(const std::shared_ptr<armcloud::VideoFrame>& frame)
+{
+    const qint64 pts = framePts();
+    frame->setPts(pts);
+    if (pts < 0) {
+        return;
+    }
+    // 渲染端在渲染线程回调，设备在断开前会先注销观察者
+    QPointer<qsc::IDevice> device = m_device;
+    frame->setStageCallback([device, pts](armcloud::FrameStage stage) {
+        if (device) {
+            device->markFrameStage(pts, stage == armcloud::FrameStage::Uploaded ? qsc::LS_UPLOAD : qsc::LS_PRESENT);
+        }
+    });
+}
+
 void ScrcpyObserver::updateFPS(quint32 fps)
 {
     // 直接发射信号，不需要通过 DeviceManager
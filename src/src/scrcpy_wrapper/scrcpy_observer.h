@@ -4,24 +4,40 @@
 #include <QString>
 #include <QImage>
 #include <QPointer>
+#include <atomic>
+#include <memory>
 #include "QtScrcpyCore.h"
+#include "render_frame_adapter.h"
 
 class DeviceManager;
+namespace armcloud {
+class VideoRenderSink;
+class VideoFrame;
+}
 
 class ScrcpyObserver : public QObject, public qsc::DeviceObserver
 {
     Q_OBJECT
 public:
-    explicit ScrcpyObserver(DeviceManager *owner, const QString &serial);
+    explicit ScrcpyObserver(DeviceManager *owner, const QString &serial, QPointer<qsc::IDevice> device);
     ~ScrcpyObserver() override = default;
 
     void onFrame(int width, int height, uint8_t* dataY, uint8_t* dataU, uint8_t* dataV, 
                  int linesizeY, int linesizeU, int linesizeV) override;
+    void onFrameBuffer(const qsc::FrameBufferPtr& frame) override;
+    qsc::FrameFormat frameFormat() const override;
     void updateFPS(quint32 fps) override;
     void grabCursor(bool grab) override;
 
     QString serial() const { return m_serial; }
 
+    // 核心向这个观察者投递的最高帧率，和渲染端的上限取较小值，0表示不限制；可在任意线程调用
+    void setMaxFrameRate(int fps) { m_maxFrameRate.store(qMax(0, fps), std::memory_order_relaxed); }
+    int maxFrameRate() const { return m_maxFrameRate.load(std::memory_order_relaxed); }
+    // userData 重新设置或设备断开时调用，下一帧重新解析 sink；可在任意线程调用
+    // （释放的对象和新对象可能地址相同，不能只比较指针）
+    void resetSinkCache() { m_sinkCacheDirty.store(true, std::memory_order_release); }
+
 signals:
     // 直接发射信号，不再通过 DeviceManager 广播
     void screenInfo(int width, int height);
@@ -34,12 +50,30 @@ private slots:
     void doEmitFpsUpdated(int fps);
     void doEmitGrabCursorChanged(bool grab);
 
+private:
+    // userData 变化时才重新 dynamic_cast，避免每帧都做类型转换
+    armcloud::VideoRenderSink* resolveSink() const;
+    // 把帧的pts和阶段回调挂到VideoFrame上，渲染端上传/显示时上报延迟
+    void attachLatencyHook(const std::shared_ptr<armcloud::VideoFrame>& frame);
+    // newFrame 有接收者时，用 ARGB 帧构造 QImage 发给 DeviceManager
+    void emitNewFrameImage(const std::shared_ptr<armcloud::VideoFrame>& frame);
+    // 第一帧或尺寸变化（屏幕旋转）时发射 screenInfo
+    void checkScreenSize(int width, int height);
+
 private:
     QPointer<DeviceManager> m_owner;
     QString m_serial;
+    // 注册时解析一次设备指针，不再每帧通过 mgr()->getDevice() 查找
+    QPointer<qsc::IDevice> m_device;
+    // frameFormat() 和 onFrameBuffer 在同一线程串行调用
+    mutable void* m_cachedUserData = nullptr;
+    mutable armcloud::VideoRenderSink* m_cachedSink = nullptr;
+    mutable std::atomic<bool> m_sinkCacheDirty{false};
     bool m_isFirstFrame;
     int m_lastWidth;
     int m_lastHeight;
-    
+    // 按渲染端的尺寸/帧率订阅帧规格
+    RenderFrameAdapter m_adapter;
+    std::atomic<int> m_maxFrameRate{0};
 };
 
@@ -0,0 +1,320 @@
+#include "software_video_item.h"
+
+#include <QQuickWindow>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QRect>
+#include <QtMath>
+#include <QDebug>
+
+#include <QSGImageNode>
+#include <QSGTexture>
+#include <atomic>
+#include <libyuv.h>
+
+// 分块边长（物理像素），块越小局部重绘越精确，节点越多
+#define SOFTWARE_TILE_SIZE 128
+// 本地缩放时变化区域向外扩展的像素，覆盖缩放滤波的范围
+#define SOFTWARE_SCALE_PAD 2
+
+namespace {
+
+// Conversion counters across all SoftwareVideoItem instances, see renderStats().
+std::atomic<quint64> s_frames{0};
+std::atomic<quint64> s_partialFrames{0};
+std::atomic<quint64> s_convertedPixels{0};
+std::atomic<qint64> s_convertUs{0};
+
+// fits width x height into the box keeping the aspect ratio, up or down, even
+void fitTarget(int width, int height, uint32_t boxWidth, uint32_t boxHeight, int& targetWidth, int& targetHeight)
+{
+    targetWidth = width;
+    targetHeight = height;
+    if (boxWidth == 0 || boxHeight == 0) {
+        return;
+    }
+    const double scale = qMin(double(boxWidth) / width, double(boxHeight) / height);
+    targetWidth = qMax(2, static_cast<int>(width * scale + 0.5) & ~1);
+    targetHeight = qMax(2, static_cast<int>(height * scale + 0.5) & ~1);
+    // 生产者已经按显示尺寸缩小过（取整方式可能不同），不再为一两个像素重新缩放
+    if (qAbs(targetWidth - width) <= 2 && qAbs(targetHeight - height) <= 2) {
+        targetWidth = width;
+        targetHeight = height;
+    }
+}
+
+} // anonymous namespace
+
+
+SoftwareVideoItem::SoftwareVideoItem(QQuickItem* parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+}
+
+SoftwareVideoItem::~SoftwareVideoItem() = default;
+
+void SoftwareVideoItem::onFrame(std::shared_ptr<armcloud::VideoFrame>& frame) {
+    if (!frame) return;
+
+    const int frameWidth = static_cast<int>(frame->width());
+    const int frameHeight = static_cast<int>(frame->height());
+    const bool yuv = frame->format() == armcloud::PixelFormat::YUV420P;
+    if (frameWidth <= 0 || frameHeight <= 0 || (!yuv && frame->format() != armcloud::PixelFormat::ARGB)) {
+        return;
+    }
+
+    const armcloud::RenderHints hints = renderHints();
+    int targetWidth = 0;
+    int targetHeight = 0;
+    fitTarget(frameWidth, frameHeight, hints.maxWidth, hints.maxHeight, targetWidth, targetHeight);
+    if (!yuv) {
+        // ARGB帧（例如和QImage共享的全尺寸转换）只做整帧缩小
+        if (targetWidth > frameWidth || targetHeight > frameHeight) {
+            targetWidth = frameWidth;
+            targetHeight = frameHeight;
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    bool partial = false;
+    qint64 pixels = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (targetWidth != m_bufferWidth || targetHeight != m_bufferHeight) {
+            resizeBuffer(targetWidth, targetHeight);
+        }
+
+        const uint64_t contentId = frame->contentId();
+        if (contentId && contentId == m_contentId) {
+            // 后备图像已是这个画面
+            return;
+        }
+
+        if (yuv) {
+            const uint8_t* planes[3] = { frame->buffer(0), frame->buffer(1), frame->buffer(2) };
+            int strides[3] = { static_cast<int>(frame->stride(0)), static_cast<int>(frame->stride(1)), static_cast<int>(frame->stride(2)) };
+            const bool scaled = targetWidth != frameWidth || targetHeight != frameHeight;
+            if (scaled) {
+                // 缩放到最终尺寸，之后的颜色转换只处理显示的像素
+                const int chromaWidth = targetWidth / 2;
+                const int chromaHeight = targetHeight / 2;
+                const size_t lumaSize = static_cast<size_t>(targetWidth) * targetHeight;
+                const size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+                m_scaled.resize(lumaSize + chromaSize * 2);
+                uint8_t* scaledY = m_scaled.data();
+                uint8_t* scaledU = scaledY + lumaSize;
+                uint8_t* scaledV = scaledU + chromaSize;
+                libyuv::I420Scale(planes[0], strides[0], planes[1], strides[1], planes[2], strides[2],
+                                  frameWidth, frameHeight,
+                                  scaledY, targetWidth, scaledU, chromaWidth, scaledV, chromaWidth,
+                                  targetWidth, targetHeight, libyuv::kFilterBilinear);
+                planes[0] = scaledY;
+                planes[1] = scaledU;
+                planes[2] = scaledV;
+                strides[0] = targetWidth;
+                strides[1] = chromaWidth;
+                strides[2] = chromaWidth;
+            }
+
+            // 后备图像是上一个画面时只转换变化区域
+            const QRect bounds(0, 0, targetWidth, targetHeight);
+            partial = contentId && m_contentId && contentId == m_contentId + 1 && !frame->dirtyRegions().empty();
+            if (partial) {
+                const double sx = double(targetWidth) / frameWidth;
+                const double sy = double(targetHeight) / frameHeight;
+                const int pad = scaled ? SOFTWARE_SCALE_PAD : 0;
+                for (const armcloud::FrameRegion& r : frame->dirtyRegions()) {
+                    const int x0 = qFloor(r.x * sx) - pad;
+                    const int y0 = qFloor(r.y * sy) - pad;
+                    const int x1 = qCeil((r.x + r.width) * sx) + pad;
+                    const int y1 = qCeil((r.y + r.height) * sy) + pad;
+                    // 色度按2x2采样，区域对齐到偶数
+                    const QRect rect = QRect(QPoint(x0 & ~1, y0 & ~1), QPoint(((x1 + 1) & ~1) - 1, ((y1 + 1) & ~1) - 1)).intersected(bounds);
+                    if (!rect.isEmpty()) {
+                        convertRect(planes, strides, rect);
+                        pixels += qint64(rect.width()) * rect.height();
+                    }
+                }
+            } else {
+                convertRect(planes, strides, bounds);
+                pixels = qint64(targetWidth) * targetHeight;
+            }
+        } else {
+            const uint8_t* src = frame->buffer(0);
+            const int stride = static_cast<int>(frame->stride(0));
+            if (targetWidth == frameWidth && targetHeight == frameHeight) {
+                libyuv::ARGBCopy(src, stride, m_buffer.data(), m_bufferStride, targetWidth, targetHeight);
+            } else {
+                libyuv::ARGBScale(src, stride, frameWidth, frameHeight,
+                                  m_buffer.data(), m_bufferStride, targetWidth, targetHeight, libyuv::kFilterBilinear);
+            }
+            std::fill(m_tileDirty.begin(), m_tileDirty.end(), 1);
+            pixels = qint64(targetWidth) * targetHeight;
+        }
+        m_contentId = contentId;
+    }
+
+    s_frames++;
+    if (partial) {
+        s_partialFrames++;
+    }
+    s_convertedPixels += static_cast<quint64>(pixels);
+    s_convertUs += timer.nsecsElapsed() / 1000;
+
+    frame->notifyStage(armcloud::FrameStage::Uploaded);
+    QMetaObject::invokeMethod(this, [this]() {
+        setHasVideo(true);
+        update();
+    }, Qt::QueuedConnection);
+}
+
+void SoftwareVideoItem::resizeBuffer(int width, int height) {
+    m_bufferWidth = width;
+    m_bufferHeight = height;
+    // RGB32每行4字节对齐即可，按64字节对齐方便libyuv的SIMD路径
+    m_bufferStride = (width * 4 + 63) & ~63;
+    m_buffer.assign(static_cast<size_t>(m_bufferStride) * height, 0);
+    m_contentId = 0;
+
+    m_tileColumns = (width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    m_tileRows = (height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    m_tileDirty.assign(static_cast<size_t>(m_tileColumns) * m_tileRows, 1);
+    m_layoutChanged = true;
+}
+
+void SoftwareVideoItem::convertRect(const uint8_t* const planes[3], const int strides[3], const QRect& rect) {
+    const int x = rect.x();
+    const int y = rect.y();
+    libyuv::I420ToARGB(planes[0] + y * strides[0] + x, strides[0],
+                       planes[1] + (y / 2) * strides[1] + x / 2, strides[1],
+                       planes[2] + (y / 2) * strides[2] + x / 2, strides[2],
+                       m_buffer.data() + y * m_bufferStride + x * 4, m_bufferStride,
+                       rect.width(), rect.height());
+
+    const int column0 = x / SOFTWARE_TILE_SIZE;
+    const int column1 = (rect.right()) / SOFTWARE_TILE_SIZE;
+    const int row0 = y / SOFTWARE_TILE_SIZE;
+    const int row1 = (rect.bottom()) / SOFTWARE_TILE_SIZE;
+    for (int row = row0; row <= row1; ++row) {
+        for (int column = column0; column <= column1; ++column) {
+            m_tileDirty[row * m_tileColumns + column] = 1;
+        }
+    }
+}
+
+QSGNode* SoftwareVideoItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData*) {
+    if (!window()) {
+        delete oldNode;
+        return nullptr;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_bufferWidth || !m_bufferHeight) {
+        return oldNode;
+    }
+
+    QSGNode* root = oldNode;
+    if (!root || m_layoutChanged) {
+        delete root;
+        root = new QSGNode();
+        for (int i = 0; i < m_tileColumns * m_tileRows; ++i) {
+            QSGImageNode* node = window()->createImageNode();
+            node->setOwnsTexture(true);
+            // 按显示尺寸转换，1:1绘制
+            node->setFiltering(QSGTexture::Nearest);
+            root->appendChildNode(node);
+        }
+        m_layoutChanged = false;
+        std::fill(m_tileDirty.begin(), m_tileDirty.end(), 1);
+    }
+
+    // 画面居中；显示尺寸刚变化、新尺寸的帧还没到时按比例缩放旧画面
+    const qreal dpr = window()->effectiveDevicePixelRatio();
+    const QRectF bounds = boundingRect();
+    const QSizeF picture(m_bufferWidth / dpr, m_bufferHeight / dpr);
+    const qreal scale = qMin(bounds.width() / picture.width(), bounds.height() / picture.height());
+    const qreal pixelScale = scale / dpr;
+    const QPointF origin((bounds.width() - picture.width() * scale) / 2, (bounds.height() - picture.height() * scale) / 2);
+
+    int index = 0;
+    for (QSGNode* child = root->firstChild(); child; child = child->nextSibling(), ++index) {
+        auto* node = static_cast<QSGImageNode*>(child);
+        const int column = index % m_tileColumns;
+        const int row = index / m_tileColumns;
+        const QRect tile(column * SOFTWARE_TILE_SIZE, row * SOFTWARE_TILE_SIZE,
+                         qMin(SOFTWARE_TILE_SIZE, m_bufferWidth - column * SOFTWARE_TILE_SIZE),
+                         qMin(SOFTWARE_TILE_SIZE, m_bufferHeight - row * SOFTWARE_TILE_SIZE));
+
+        if (m_tileDirty[index]) {
+            m_tileDirty[index] = 0;
+            // 只有变化的块换纹理，软件渲染器只重绘这些块；
+            // 纹理需要自己的像素，后备图像随后会被生产者改写
+            const QImage image(m_buffer.data() + tile.y() * m_bufferStride + tile.x() * 4,
+                               tile.width(), tile.height(), m_bufferStride, QImage::Format_RGB32);
+            QSGTexture* texture = window()->createTextureFromImage(image.copy());
+            if (texture) {
+                node->setTexture(texture);
+                node->setSourceRect(QRectF(0, 0, tile.width(), tile.height()));
+            }
+        }
+
+        const QRectF rect(origin.x() + tile.x() * pixelScale, origin.y() + tile.y() * pixelScale,
+                          tile.width() * pixelScale, tile.height() * pixelScale);
+        if (node->rect() != rect) {
+            node->setRect(rect);
+        }
+    }
+
+    return root;
+}
+
+void SoftwareVideoItem::itemChange(ItemChange change, const ItemChangeData& value) {
+    QQuickItem::itemChange(change, value);
+    if (change == ItemSceneChange || change == ItemDevicePixelRatioHasChanged) {
+        updateRenderSize();
+    }
+}
+
+void SoftwareVideoItem::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) {
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size()) {
+        updateRenderSize();
+        update();
+    }
+}
+
+void SoftwareVideoItem::updateRenderSize() {
+    const qreal dpr = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+    setRenderSize(static_cast<uint32_t>(qCeil(width() * dpr)), static_cast<uint32_t>(qCeil(height() * dpr)));
+}
+
+void SoftwareVideoItem::setMaxFrameRate(int fps) {
+    fps = qMax(0, fps);
+    if (m_maxFrameRate == fps)
+        return;
+    m_maxFrameRate = fps;
+    setRenderMaxFps(static_cast<uint32_t>(fps));
+    emit maxFrameRateChanged();
+}
+
+void SoftwareVideoItem::setHasVideo(bool value) {
+    if (m_hasVideo == value)
+        return;
+    m_hasVideo = value;
+    emit hasVideoChanged();
+}
+
+QVariantMap SoftwareVideoItem::renderStats() const {
+    const quint64 frames = s_frames.load();
+    const qint64 convertUs = s_convertUs.load();
+    QVariantMap result;
+    result["frames"] = static_cast<qulonglong>(frames);
+    result["partialFrames"] = static_cast<qulonglong>(s_partialFrames.load());
+    result["convertedPixels"] = static_cast<qulonglong>(s_convertedPixels.load());
+    result["convertUs"] = static_cast<qlonglong>(convertUs);
+    result["fpsPerCore"] = convertUs > 0 ? frames * 1000000.0 / convertUs : 0.0;
+    return result;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QQuickItem>
+#include <QMutex>
+#include <QVariantMap>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "video_render_sink.h"
+#include "video_frame.h"
+
+// 为软件场景图（无GPU的虚拟机、RDP/VNC会话）设计的视频渲染项：
+// - 收到帧时在生产者线程用 libyuv 直接从 YUV 缩放、转换到显示尺寸的后备图像，不再整帧拷贝，
+//   绘制时1:1贴图，不做平滑缩放
+// - 后备图像按固定大小分块，每块一个图像节点；内容id连续时只转换变化区域，
+//   只有变化的块更新纹理，软件渲染器只重绘这些块
+// 在RHI后端下也能工作，但那里应使用 VideoRenderItemEx
+class SoftwareVideoItem : public QQuickItem, public armcloud::VideoRenderSink {
+    Q_OBJECT
+    Q_PROPERTY(bool hasVideo READ hasVideo NOTIFY hasVideoChanged FINAL)
+    // 生产者送帧的最高帧率，0表示不限制
+    Q_PROPERTY(int maxFrameRate READ maxFrameRate WRITE setMaxFrameRate NOTIFY maxFrameRateChanged)
+public:
+    explicit SoftwareVideoItem(QQuickItem* parent = nullptr);
+    ~SoftwareVideoItem() override;
+
+    void onFrame(std::shared_ptr<armcloud::VideoFrame>& frame) override;
+    bool acceptsYuv() const override { return true; }
+    // 在CPU上绘制，让生产者总是按显示尺寸缩小
+    bool gpuScaling() const override { return false; }
+
+    bool hasVideo() const { return m_hasVideo; }
+
+    int maxFrameRate() const { return m_maxFrameRate; }
+    void setMaxFrameRate(int fps);
+
+    // 所有 SoftwareVideoItem 的转换统计：
+    // {frames, partialFrames, convertedPixels, convertUs, fpsPerCore}
+    // convertUs 为生产者线程中缩放+转换的累计耗时，fpsPerCore = frames / (convertUs / 1e6)
+    Q_INVOKABLE QVariantMap renderStats() const;
+
+signals:
+    void hasVideoChanged();
+    void maxFrameRateChanged();
+
+protected:
+    QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData*) override;
+    void itemChange(ItemChange change, const ItemChangeData& value) override;
+    void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+
+private:
+    // 把显示尺寸（物理像素）发布给生产者
+    void updateRenderSize();
+    // 在m_mutex内调用：按尺寸重建后备图像和分块
+    void resizeBuffer(int width, int height);
+    // 在m_mutex内调用：把 I420 平面中的 rect 区域转换到后备图像并标记所在的块
+    void convertRect(const uint8_t* const planes[3], const int strides[3], const QRect& rect);
+    void setHasVideo(bool value);
+
+private:
+    QMutex m_mutex;
+    // 显示尺寸的 RGB32 后备图像，由生产者写入，updatePaintNode 中按块拷贝给纹理
+    std::vector<uint8_t> m_buffer;
+    int m_bufferWidth = 0;
+    int m_bufferHeight = 0;
+    int m_bufferStride = 0;
+    // 后备图像中画面的内容id，0表示未知
+    uint64_t m_contentId = 0;
+    // 本地缩放时的 I420 中间缓冲
+    std::vector<uint8_t> m_scaled;
+    int m_tileColumns = 0;
+    int m_tileRows = 0;
+    // 自上次同步后变化过的块
+    std::vector<uint8_t> m_tileDirty;
+    // 分块布局变化，节点需要重建
+    bool m_layoutChanged = false;
+    bool m_hasVideo = false;
+    int m_maxFrameRate = 0;
+};
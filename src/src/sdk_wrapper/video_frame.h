@@ -3,6 +3,9 @@
 #include <stdint.h>
 #include <algorithm> // For std::min
 #include <cstring>   // For memcpy
+#include <functional>
+#include <memory>
+#include <vector>
 
 namespace armcloud {
 
@@ -12,6 +15,20 @@ enum class PixelFormat{
     YUV420P
 };
 
+// 渲染端上报的帧阶段，用于延迟统计
+enum class FrameStage{
+    Uploaded,
+    Presented
+};
+
+// 帧内的矩形区域（像素）
+struct FrameRegion {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
 class VideoFrame {
 public:
     explicit VideoFrame(uint32_t width, uint32_t height, PixelFormat format)
@@ -52,7 +69,29 @@ public:
         m_buffer[2] = new uint8_t[m_size[2]];
     }
 
+    // 引用外部的平面（YUV420P三个平面，ARGB/RGBA一个平面），不拷贝也不释放；
+    // holder在帧析构前保持平面有效
+    explicit VideoFrame(uint32_t width, uint32_t height, PixelFormat format, uint8_t* const planes[3], const int strides[3],
+                        std::shared_ptr<const void> holder)
+        : m_width(width)
+        , m_height(height)
+        , m_format(format)
+        , m_holder(std::move(holder))
+    {
+        const int planeCount = PixelFormat::YUV420P == format ? 3 : 1;
+        const uint32_t chromaHeight = (height + 1) / 2;
+        for (int i = 0; i < planeCount; ++i) {
+            m_buffer[i] = planes[i];
+            m_stride[i] = static_cast<uint32_t>(strides[i]);
+            m_size[i] = m_stride[i] * (i == 0 ? height : chromaHeight);
+        }
+    }
+
 	virtual ~VideoFrame() {
+        if (m_holder) {
+            // 平面属于holder
+            return;
+        }
         if(PixelFormat::ARGB == m_format || PixelFormat::RGBA == m_format){
             if(m_buffer[0]) delete[] m_buffer[0];
         }else if(PixelFormat::YUV420P == m_format){
@@ -86,6 +125,42 @@ public:
         return m_format;
     }
 
+    // 设备时间戳(us)，-1表示未知
+    inline int64_t pts() const {
+        return m_pts;
+    }
+
+    inline void setPts(int64_t pts) {
+        m_pts = pts;
+    }
+
+    // 画面内容id，0表示未知；与上一帧画面相同时不变
+    inline uint64_t contentId() const {
+        return m_contentId;
+    }
+
+    // 相对内容id为contentId()-1的画面变化的区域，空表示整帧
+    // 渲染端只有在已显示contentId()-1的画面时才能只上传这些区域
+    inline const std::vector<FrameRegion>& dirtyRegions() const {
+        return m_dirtyRegions;
+    }
+
+    inline void setContent(uint64_t contentId, std::vector<FrameRegion> dirtyRegions) {
+        m_contentId = contentId;
+        m_dirtyRegions = std::move(dirtyRegions);
+    }
+
+    // 渲染端在纹理上传/显示后调用，由帧的生产者决定如何记录
+    inline void setStageCallback(std::function<void(FrameStage stage)> callback) {
+        m_stageCallback = callback;
+    }
+
+    inline void notifyStage(FrameStage stage) const {
+        if (m_stageCallback) {
+            m_stageCallback(stage);
+        }
+    }
+
 private:
 	uint32_t m_width;
 	uint32_t m_height;
@@ -93,5 +168,10 @@ private:
     uint32_t m_stride[4] = {0};
     uint32_t m_size[4] = {0};
     PixelFormat m_format;
+    int64_t m_pts = -1;
+    uint64_t m_contentId = 0;
+    std::vector<FrameRegion> m_dirtyRegions;
+    std::shared_ptr<const void> m_holder;
+    std::function<void(FrameStage stage)> m_stageCallback;
 };
 } // namespace armcloud
@@ -1,6 +1,8 @@
 #include "video_render_item.h"
 #include "video_frame.h"
 #include <QPainter>
+#include <QQuickWindow>
+#include <QtMath>
 
 VideoRenderItem::VideoRenderItem(QQuickItem* parent)
     : QQuickPaintedItem(parent)
@@ -91,3 +93,29 @@ void VideoRenderItem::setHasVideo(bool value) {
     emit hasVideoChanged();
 }
 
+void VideoRenderItem::itemChange(ItemChange change, const ItemChangeData& value) {
+    QQuickPaintedItem::itemChange(change, value);
+    if (change == ItemSceneChange || change == ItemDevicePixelRatioHasChanged) {
+        updateRenderSize();
+    }
+}
+
+void VideoRenderItem::setMaxFrameRate(int fps) {
+    fps = qMax(0, fps);
+    if (m_maxFrameRate == fps)
+        return;
+    m_maxFrameRate = fps;
+    setRenderMaxFps(static_cast<uint32_t>(fps));
+    emit maxFrameRateChanged();
+}
+
+void VideoRenderItem::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) {
+    QQuickPaintedItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size())
+        updateRenderSize();
+}
+
+void VideoRenderItem::updateRenderSize() {
+    const qreal dpr = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+    setRenderSize(static_cast<uint32_t>(qCeil(width() * dpr)), static_cast<uint32_t>(qCeil(height() * dpr)));
+}
@@ -12,6 +12,8 @@ class VideoRenderItem : public QQuickPaintedItem, public armcloud::VideoRenderSi
 
     Q_PROPERTY(qreal rotation READ rotation WRITE setRotation)
     Q_PROPERTY(bool hasVideo READ hasVideo WRITE setHasVideo NOTIFY hasVideoChanged FINAL)
+    // 生产者送帧的最高帧率，0表示不限制
+    Q_PROPERTY(int maxFrameRate READ maxFrameRate WRITE setMaxFrameRate NOTIFY maxFrameRateChanged)
 public:
     explicit VideoRenderItem(QQuickItem* parent = nullptr);
     ~VideoRenderItem() override;
@@ -25,11 +27,24 @@ public:
     bool hasVideo() const { return m_hasVideo; }
     void setHasVideo(bool value);
 
+    int maxFrameRate() const { return m_maxFrameRate; }
+    void setMaxFrameRate(int fps);
+
 signals:
     void hasVideoChanged();
+    void maxFrameRateChanged();
+protected:
+    void itemChange(ItemChange change, const ItemChangeData& value) override;
+    void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+
+private:
+    // 把显示尺寸（物理像素）发布给生产者
+    void updateRenderSize();
+
 private:
     QImage m_image;
     QMutex m_mutex;
     qreal m_angle = 0.0;
     bool m_hasVideo = false;
+    int m_maxFrameRate = 0;
 };
@@ -2,6 +2,10 @@
 
 #include <QQuickWindow>
 #include <QMutexLocker>
+#include <QRect>
+#include <QVarLengthArray>
+#include <QVector>
+#include <QtMath>
 #include <cmath>
 #include <QDebug>
 
@@ -11,14 +15,190 @@
 #include <QSGTransformNode>
 #include <QSGSimpleTextureNode>
 #include <QSGRendererInterface>
+#include <rhi/qrhi.h>
 #include <rhi/qshader.h>
 #include <rhi/qshaderbaker.h>
+#include <atomic>
 
 // For YUV rendering, we need a custom scene graph node, material, and shader.
 // This allows the YUV->RGB conversion to be done on the GPU, which is very efficient.
 
 namespace {
 
+// Bytes handed to the RHI for texture uploads, and how many uploads only
+// covered the dirty regions of the frame.
+std::atomic<quint64> s_uploadedBytes{0};
+std::atomic<quint64> s_partialUploads{0};
+
+// A long-lived texture that is allocated once per size/format and updated in
+// place. The upload is recorded into the renderer's resource update batch from
+// commitTextureOperations(), so no texture is created or destroyed per frame.
+class StreamingTexture : public QSGTexture
+{
+public:
+    StreamingTexture(QRhiTexture::Format format, bool hasAlpha)
+        : m_format(format)
+        , m_hasAlpha(hasAlpha)
+    {
+        setFiltering(QSGTexture::Linear);
+        setHorizontalWrapMode(QSGTexture::ClampToEdge);
+        setVerticalWrapMode(QSGTexture::ClampToEdge);
+    }
+
+    ~StreamingTexture() override {
+        if (m_texture) {
+            m_texture->deleteLater();
+        }
+    }
+
+    // returns true if the underlying QRhiTexture had to be (re)allocated
+    bool ensure(QRhi* rhi, const QSize& size) {
+        if (!rhi || size.isEmpty()) {
+            return false;
+        }
+        if (m_texture && m_size == size) {
+            return false;
+        }
+
+        if (!m_texture) {
+            m_texture = rhi->newTexture(m_format, size);
+        } else {
+            m_texture->destroy();
+            m_texture->setPixelSize(size);
+        }
+        if (!m_texture->create()) {
+            qWarning() << "StreamingTexture: failed to create texture" << size;
+            delete m_texture;
+            m_texture = nullptr;
+            m_size = QSize();
+            return false;
+        }
+        m_size = size;
+        m_pending = false;
+        // the new texture has undefined content, the next upload must be full
+        m_contentId = 0;
+        return true;
+    }
+
+    // the frame is kept alive until the next update, which is after the
+    // upload recorded for this one has been submitted.
+    // subsample maps the frame's dirty regions onto this plane (2 for chroma)
+    void setData(const std::shared_ptr<armcloud::VideoFrame>& frame, const uchar* data, int stride, int bytesPerPixel, int subsample = 1) {
+        const uint64_t contentId = frame ? frame->contentId() : 0;
+        if (contentId && contentId == m_contentId && m_texture) {
+            // the texture already holds this picture
+            return;
+        }
+
+        // only the dirty regions need uploading when the texture holds the
+        // picture they are relative to and no other upload is still queued
+        m_regions.clear();
+        if (contentId && m_contentId && contentId == m_contentId + 1 && !m_pending) {
+            for (const armcloud::FrameRegion& r : frame->dirtyRegions()) {
+                const QRect region = QRect(QPoint(r.x / subsample, r.y / subsample),
+                                           QPoint((r.x + r.width + subsample - 1) / subsample - 1,
+                                                  (r.y + r.height + subsample - 1) / subsample - 1))
+                                         .intersected(QRect(QPoint(0, 0), m_size));
+                if (!region.isEmpty()) {
+                    m_regions.append(region);
+                }
+            }
+        }
+
+        m_frame = frame;
+        m_data = data;
+        m_stride = stride;
+        m_bytesPerPixel = bytesPerPixel;
+        m_contentId = contentId;
+        m_pending = (m_texture && m_data);
+    }
+
+    qint64 comparisonKey() const override {
+        return qint64(qintptr(m_texture ? static_cast<const void*>(m_texture) : static_cast<const void*>(this)));
+    }
+    QRhiTexture* rhiTexture() const override { return m_texture; }
+    QSize textureSize() const override { return m_size; }
+    bool hasAlphaChannel() const override { return m_hasAlpha; }
+    bool hasMipmaps() const override { return false; }
+
+    void commitTextureOperations(QRhi* rhi, QRhiResourceUpdateBatch* resourceUpdates) override {
+        if (!m_pending || !m_texture || !resourceUpdates) {
+            return;
+        }
+        m_pending = false;
+
+        if (!m_regions.isEmpty()) {
+            commitRegions(rhi, resourceUpdates);
+            return;
+        }
+
+        const int rowBytes = m_size.width() * m_bytesPerPixel;
+        QRhiTextureSubresourceUploadDescription desc;
+        if (m_stride == rowBytes || rhi->isFeatureSupported(QRhi::ImageDataStride)) {
+            // zero copy: the upload reads straight from the frame buffer
+            desc.setData(QByteArray::fromRawData(reinterpret_cast<const char*>(m_data), m_stride * m_size.height()));
+            desc.setDataStride(quint32(m_stride));
+        } else {
+            QByteArray packed(rowBytes * m_size.height(), Qt::Uninitialized);
+            for (int y = 0; y < m_size.height(); ++y) {
+                memcpy(packed.data() + y * rowBytes, m_data + y * m_stride, rowBytes);
+            }
+            desc.setData(packed);
+        }
+        desc.setSourceSize(m_size);
+        resourceUpdates->uploadTexture(m_texture, QRhiTextureUploadDescription({ 0, 0, desc }));
+        s_uploadedBytes += quint64(rowBytes) * quint64(m_size.height());
+    }
+
+private:
+    // uploads only the dirty regions into the persistent texture
+    void commitRegions(QRhi* rhi, QRhiResourceUpdateBatch* resourceUpdates) {
+        const bool stridedUpload = rhi->isFeatureSupported(QRhi::ImageDataStride);
+        QVarLengthArray<QRhiTextureUploadEntry, 16> entries;
+        quint64 bytes = 0;
+        for (const QRect& region : m_regions) {
+            const uchar* src = m_data + region.y() * m_stride + region.x() * m_bytesPerPixel;
+            const int rowBytes = region.width() * m_bytesPerPixel;
+            QRhiTextureSubresourceUploadDescription desc;
+            if (stridedUpload || region.height() == 1) {
+                desc.setData(QByteArray::fromRawData(reinterpret_cast<const char*>(src), m_stride * (region.height() - 1) + rowBytes));
+                desc.setDataStride(quint32(m_stride));
+            } else {
+                QByteArray packed(rowBytes * region.height(), Qt::Uninitialized);
+                for (int y = 0; y < region.height(); ++y) {
+                    memcpy(packed.data() + y * rowBytes, src + y * m_stride, rowBytes);
+                }
+                desc.setData(packed);
+            }
+            desc.setSourceSize(region.size());
+            desc.setDestinationTopLeft(region.topLeft());
+            entries.append(QRhiTextureUploadEntry(0, 0, desc));
+            bytes += quint64(rowBytes) * quint64(region.height());
+        }
+        QRhiTextureUploadDescription upload;
+        upload.setEntries(entries.cbegin(), entries.cend());
+        resourceUpdates->uploadTexture(m_texture, upload);
+        s_uploadedBytes += bytes;
+        ++s_partialUploads;
+        m_regions.clear();
+    }
+
+private:
+    QRhiTexture::Format m_format;
+    bool m_hasAlpha = false;
+    QRhiTexture* m_texture = nullptr;
+    QSize m_size;
+
+    std::shared_ptr<armcloud::VideoFrame> m_frame;
+    const uchar* m_data = nullptr;
+    int m_stride = 0;
+    int m_bytesPerPixel = 1;
+    bool m_pending = false;
+    // content id of the picture in the texture (or queued for it), 0 if unknown
+    uint64_t m_contentId = 0;
+    QVector<QRect> m_regions;
+};
+
 // Unique type for our custom material
 class YuvMaterialType : public QSGMaterialType {};
 
@@ -139,6 +319,11 @@ public:
         auto* material = new YuvMaterial();
         setMaterial(material);
         setFlag(OwnsMaterial);
+
+        for (int i = 0; i < 3; ++i) {
+            m_textures[i] = new StreamingTexture(QRhiTexture::R8, false);
+            material->m_textures[i] = m_textures[i];
+        }
     }
 
     ~YuvRenderNode() override {
@@ -147,41 +332,32 @@ public:
         delete m_textures[2];
     }
 
-    void updateFrame(const std::shared_ptr<armcloud::VideoFrame>& frame) {
-        if (!frame || !m_window) return;
+    // returns the number of textures that had to be (re)allocated
+    int updateFrame(const std::shared_ptr<armcloud::VideoFrame>& frame) {
+        if (!frame || !m_window) return 0;
+
+        QRhi* rhi = m_window->rhi();
+        if (!rhi) return 0;
 
         const int width = static_cast<int>(frame->width());
         const int height = static_cast<int>(frame->height());
 
-        const bool sizeChanged = (m_size.width() != width || m_size.height() != height);
-        if (sizeChanged) {
-            m_size = {width, height};
-        }
-
         const uchar* plane_data[] = { frame->buffer(0), frame->buffer(1), frame->buffer(2) };
         const uint32_t plane_strides[] = { frame->stride(0), frame->stride(1), frame->stride(2) };
-        const QSize plane_sizes[] = { {width, height}, {width / 2, height / 2}, {width / 2, height / 2} };
-
-        auto* mat = static_cast<YuvMaterial*>(material());
+        const QSize plane_sizes[] = { {width, height}, {(width + 1) / 2, (height + 1) / 2}, {(width + 1) / 2, (height + 1) / 2} };
 
+        // textures are only (re)allocated when the resolution changes,
+        // otherwise the new planes are uploaded into the existing ones
+        int allocations = 0;
         for (int i = 0; i < 3; ++i) {
-            QImage wrapper(plane_data[i], plane_sizes[i].width(), plane_sizes[i].height(), plane_strides[i], QImage::Format_Grayscale8);
-
-            delete m_textures[i];
-            m_textures[i] = m_window->createTextureFromImage(wrapper);
-            
-            if (m_textures[i]) {
-                m_textures[i]->setFiltering(QSGTexture::Linear);
-                m_textures[i]->setHorizontalWrapMode(QSGTexture::ClampToEdge);
-                m_textures[i]->setVerticalWrapMode(QSGTexture::ClampToEdge);
+            if (m_textures[i]->ensure(rhi, plane_sizes[i])) {
+                ++allocations;
             }
+            m_textures[i]->setData(frame, plane_data[i], static_cast<int>(plane_strides[i]), 1, i == 0 ? 1 : 2);
         }
-        
-        mat->m_textures[0] = m_textures[0];
-        mat->m_textures[1] = m_textures[1];
-        mat->m_textures[2] = m_textures[2];
 
         markDirty(QSGNode::DirtyMaterial);
+        return allocations;
     }
 
     void setRect(const QRectF &rect) {
@@ -192,8 +368,7 @@ public:
 private:
     QQuickWindow* m_window = nullptr;
     QSGGeometry m_geometry;
-    QSGTexture* m_textures[3] = {nullptr, nullptr, nullptr};
-    QSize m_size;
+    StreamingTexture* m_textures[3] = {nullptr, nullptr, nullptr};
 };
 
 } // anonymous namespace
@@ -258,22 +433,48 @@ QSGNode* VideoRenderItemEx::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeDat
             rootNode = new QSGTransformNode();
             rootNode->appendChildNode(yuvNode);
         }
-        yuvNode->updateFrame(frame);
+        m_textureAllocations += yuvNode->updateFrame(frame);
     } else { // ARGB Path
         auto* textureNode = dynamic_cast<QSGSimpleTextureNode*>(contentNode);
         if (!textureNode) {
             delete rootNode;
             textureNode = new QSGSimpleTextureNode();
+            textureNode->setOwnsTexture(true);
             rootNode = new QSGTransformNode();
             rootNode->appendChildNode(textureNode);
         }
-        QImage image(frame->buffer(0), frameSize.width(), frameSize.height(), frame->stride(0), QImage::Format_ARGB32);
-        QSGTexture* texture = window()->createTextureFromImage(image);
-        if (texture) {
-            texture->setFiltering(QSGTexture::Linear);
+
+        // libyuv ARGB is B,G,R,A in memory, which maps directly onto BGRA8
+        QRhi* rhi = window()->rhi();
+        if (rhi && rhi->isTextureFormatSupported(QRhiTexture::BGRA8)) {
+            auto* texture = dynamic_cast<StreamingTexture*>(textureNode->texture());
+            if (!texture) {
+                texture = new StreamingTexture(QRhiTexture::BGRA8, true);
+                textureNode->setTexture(texture);
+            }
+            if (texture->ensure(rhi, frameSize)) {
+                ++m_textureAllocations;
+            }
+            // explicit source rect so a resized texture refreshes the geometry
+            textureNode->setSourceRect(QRectF(QPointF(0, 0), frameSize));
+            texture->setData(frame, frame->buffer(0), static_cast<int>(frame->stride(0)), 4);
+            textureNode->markDirty(QSGNode::DirtyMaterial);
+        } else {
+            QImage image(frame->buffer(0), frameSize.width(), frameSize.height(), frame->stride(0), QImage::Format_ARGB32);
+            QSGTexture* texture = window()->createTextureFromImage(image);
+            if (texture) {
+                texture->setFiltering(QSGTexture::Linear);
+                textureNode->setTexture(texture);
+                ++m_textureAllocations;
+            }
         }
-        delete textureNode->texture();
-        textureNode->setTexture(texture);
+    }
+
+    if (frame.get() != m_lastUploadedFrame) {
+        // 新帧的纹理数据已交给场景图，在下一次帧交换时算作显示
+        m_lastUploadedFrame = frame.get();
+        frame->notifyStage(armcloud::FrameStage::Uploaded);
+        m_presentFrame = frame;
     }
 
     contentNode = rootNode->firstChild();
@@ -303,6 +504,63 @@ QSGNode* VideoRenderItemEx::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeDat
     return rootNode;
 }
 
+void VideoRenderItemEx::itemChange(ItemChange change, const ItemChangeData& value) {
+    if (change == ItemDevicePixelRatioHasChanged) {
+        updateRenderSize();
+    }
+    if (change == ItemSceneChange) {
+        disconnect(m_frameSwappedConnection);
+        if (value.window) {
+            // frameSwapped在渲染线程发出，和updatePaintNode同一线程
+            m_frameSwappedConnection = connect(value.window, &QQuickWindow::frameSwapped, this,
+                                               [this]() { onFrameSwapped(); }, Qt::DirectConnection);
+        }
+    }
+    QQuickItem::itemChange(change, value);
+    if (change == ItemSceneChange) {
+        updateRenderSize();
+    }
+}
+
+void VideoRenderItemEx::setMaxFrameRate(int fps) {
+    fps = qMax(0, fps);
+    if (m_maxFrameRate == fps)
+        return;
+    m_maxFrameRate = fps;
+    setRenderMaxFps(static_cast<uint32_t>(fps));
+    emit maxFrameRateChanged();
+}
+
+void VideoRenderItemEx::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) {
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size())
+        updateRenderSize();
+}
+
+void VideoRenderItemEx::updateRenderSize() {
+    const qreal dpr = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+    setRenderSize(static_cast<uint32_t>(qCeil(width() * dpr)), static_cast<uint32_t>(qCeil(height() * dpr)));
+}
+
+void VideoRenderItemEx::onFrameSwapped() {
+    if (!m_presentFrame)
+        return;
+    m_presentFrame->notifyStage(armcloud::FrameStage::Presented);
+    m_presentFrame.reset();
+}
+
+quint64 VideoRenderItemEx::textureAllocations() const {
+    return m_textureAllocations.load();
+}
+
+quint64 VideoRenderItemEx::uploadedBytes() const {
+    return s_uploadedBytes.load();
+}
+
+quint64 VideoRenderItemEx::partialUploads() const {
+    return s_partialUploads.load();
+}
+
 void VideoRenderItemEx::setHasVideo(bool value) {
     if (m_hasVideo == value)
         return;
@@ -4,6 +4,7 @@
 #include <QMutex>
 #include <QSGTexture>
 #include <QSGSimpleTextureNode>
+#include <atomic>
 #include <memory>
 #include "video_render_sink.h"
 #include "video_frame.h"
@@ -13,26 +14,56 @@ class VideoRenderItemEx : public QQuickItem, public armcloud::VideoRenderSink {
     Q_OBJECT
     Q_PROPERTY(qreal rotation READ rotation WRITE setRotation NOTIFY rotationChanged)
     Q_PROPERTY(bool hasVideo READ hasVideo WRITE setHasVideo NOTIFY hasVideoChanged FINAL)
+    // 生产者送帧的最高帧率，0表示不限制（例如缩略图墙设为15）
+    Q_PROPERTY(int maxFrameRate READ maxFrameRate WRITE setMaxFrameRate NOTIFY maxFrameRateChanged)
 public:
     explicit VideoRenderItemEx(QQuickItem* parent = nullptr);
     ~VideoRenderItemEx() override;
 
     void onFrame(std::shared_ptr<armcloud::VideoFrame>& frame) override;
+    bool acceptsYuv() const override { return true; }
 
     qreal rotation() const { return m_angle; }
     void setRotation(qreal angle);
 
     bool hasVideo() const { return m_hasVideo; }
     void setHasVideo(bool value);
+
+    int maxFrameRate() const { return m_maxFrameRate; }
+    void setMaxFrameRate(int fps);
+
+    // texture (re)allocations of this item, for checking that textures are
+    // reused across frames
+    Q_INVOKABLE quint64 textureAllocations() const;
+    // total bytes uploaded to textures by all VideoRenderItemEx, and how many
+    // uploads only covered the changed regions of a frame
+    Q_INVOKABLE quint64 uploadedBytes() const;
+    Q_INVOKABLE quint64 partialUploads() const;
 signals:
     void rotationChanged();
     void hasVideoChanged();
+    void maxFrameRateChanged();
 protected:
     QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData*) override;
+    void itemChange(ItemChange change, const ItemChangeData& value) override;
+    void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+
+private:
+    // 把显示尺寸（物理像素）发布给生产者
+    void updateRenderSize();
+    // 渲染线程：帧交换后上报显示阶段
+    void onFrameSwapped();
 
 private:
     std::shared_ptr<armcloud::VideoFrame> m_frame;
+    // 以下两项只在渲染线程访问（updatePaintNode / frameSwapped）
+    const armcloud::VideoFrame* m_lastUploadedFrame = nullptr;
+    std::shared_ptr<armcloud::VideoFrame> m_presentFrame;
+    QMetaObject::Connection m_frameSwappedConnection;
     QMutex m_mutex;
     qreal m_angle = 0.0;
     bool m_hasVideo = false;
+    int m_maxFrameRate = 0;
+    // updated on the render thread
+    std::atomic<quint64> m_textureAllocations{0};
 };
@@ -1,12 +1,50 @@
 ﻿#pragma once
 
+#include <atomic>
 #include <memory>
+#include <stdint.h>
 
 namespace armcloud {
 class VideoFrame;
+
+// 渲染端期望的帧规格，0表示不限制
+// 生产者据此在颜色转换之前缩小帧、跳过超出帧率的帧
+struct RenderHints {
+    uint32_t maxWidth = 0;   // 物理像素（已乘设备像素比）
+    uint32_t maxHeight = 0;
+    uint32_t maxFps = 0;
+};
+
 class VideoRenderSink {
 public:
 	virtual ~VideoRenderSink() = default;
 	virtual void onFrame(std::shared_ptr<armcloud::VideoFrame>& frame) = 0;
+	// 能直接渲染YUV420P帧时返回true，生产者可以跳过RGB转换，直接传递解码器平面
+	virtual bool acceptsYuv() const { return false; }
+	// 在GPU上缩放时为true，生产者只在缩小很多时才先缩小；软件渲染端返回false，总是收到显示尺寸的帧
+	virtual bool gpuScaling() const { return true; }
+	// 可在任意线程调用
+	virtual RenderHints renderHints() const {
+		RenderHints hints;
+		hints.maxWidth = m_hintWidth.load(std::memory_order_relaxed);
+		hints.maxHeight = m_hintHeight.load(std::memory_order_relaxed);
+		hints.maxFps = m_hintFps.load(std::memory_order_relaxed);
+		return hints;
+	}
+
+protected:
+	// 渲染端在尺寸/帧率变化时更新
+	void setRenderSize(uint32_t width, uint32_t height) {
+		m_hintWidth.store(width, std::memory_order_relaxed);
+		m_hintHeight.store(height, std::memory_order_relaxed);
+	}
+	void setRenderMaxFps(uint32_t fps) {
+		m_hintFps.store(fps, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint32_t> m_hintWidth{0};
+	std::atomic<uint32_t> m_hintHeight{0};
+	std::atomic<uint32_t> m_hintFps{0};
 };
 } // namespace armcloud
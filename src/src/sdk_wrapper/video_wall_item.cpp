@@ -0,0 +1,705 @@
+#include "video_wall_item.h"
+#include "video_render_item.h"
+#include "video_render_item_ex.h"
+
+#include <QQuickWindow>
+#include <QMutexLocker>
+#include <QVarLengthArray>
+#include <QVector>
+#include <QtMath>
+#include <QDebug>
+
+#include <QSGGeometryNode>
+#include <QSGTextureMaterial>
+#include <rhi/qrhi.h>
+#include <atomic>
+
+// 图集边长上限，实际还受 QRhi::TextureSizeMax 限制
+#define WALL_ATLAS_MAX_SIZE 4096
+// 16位索引，每个画面4个顶点
+#define WALL_MAX_TILES (65535 / 4)
+
+// The wall draws every visible tile with one geometry node: all tiles live in
+// slots of a single BGRA atlas texture, so the whole wall is one material and
+// one draw call no matter how many devices are shown.
+
+namespace {
+
+std::atomic<quint64> s_uploadedBytes{0};
+std::atomic<quint64> s_slotEvictions{0};
+
+// A BGRA atlas that collects sub-rectangle uploads of many frames and records
+// them in one resource update batch from commitTextureOperations().
+class AtlasTexture : public QSGTexture
+{
+public:
+    AtlasTexture() {
+        setFiltering(QSGTexture::Linear);
+        setHorizontalWrapMode(QSGTexture::ClampToEdge);
+        setVerticalWrapMode(QSGTexture::ClampToEdge);
+    }
+
+    ~AtlasTexture() override {
+        if (m_texture) {
+            m_texture->deleteLater();
+        }
+    }
+
+    // returns true if the texture was (re)allocated, its content is undefined then
+    bool ensure(QRhi* rhi, const QSize& size) {
+        if (!rhi || size.isEmpty()) {
+            return false;
+        }
+        if (m_texture && m_size == size) {
+            return false;
+        }
+        if (!m_texture) {
+            m_texture = rhi->newTexture(QRhiTexture::BGRA8, size);
+        } else {
+            m_texture->destroy();
+            m_texture->setPixelSize(size);
+        }
+        if (!m_texture->create()) {
+            qWarning() << "VideoWallItem: failed to create atlas" << size;
+            delete m_texture;
+            m_texture = nullptr;
+            m_size = QSize();
+            return false;
+        }
+        m_size = size;
+        m_uploads.clear();
+        return true;
+    }
+
+    bool isValid() const { return m_texture != nullptr; }
+
+    // region is in frame pixels, it is copied to dst + region.topLeft()
+    void addUpload(const std::shared_ptr<armcloud::VideoFrame>& frame, const QRect& region, const QPoint& dst) {
+        Upload upload;
+        upload.frame = frame;
+        upload.region = region;
+        upload.dst = dst;
+        m_uploads.append(upload);
+    }
+
+    qint64 comparisonKey() const override {
+        return qint64(qintptr(m_texture ? static_cast<const void*>(m_texture) : static_cast<const void*>(this)));
+    }
+    QRhiTexture* rhiTexture() const override { return m_texture; }
+    QSize textureSize() const override { return m_size; }
+    bool hasAlphaChannel() const override { return false; }
+    bool hasMipmaps() const override { return false; }
+
+    void commitTextureOperations(QRhi* rhi, QRhiResourceUpdateBatch* resourceUpdates) override {
+        // the frames of the previous batch have been submitted by now
+        m_inFlight.clear();
+        if (m_uploads.isEmpty() || !m_texture || !resourceUpdates) {
+            return;
+        }
+
+        const bool stridedUpload = rhi->isFeatureSupported(QRhi::ImageDataStride);
+        QVarLengthArray<QRhiTextureUploadEntry, 64> entries;
+        quint64 bytes = 0;
+        for (const Upload& upload : m_uploads) {
+            const int stride = static_cast<int>(upload.frame->stride(0));
+            const uchar* src = upload.frame->buffer(0) + upload.region.y() * stride + upload.region.x() * 4;
+            const int rowBytes = upload.region.width() * 4;
+            QRhiTextureSubresourceUploadDescription desc;
+            if (stride == rowBytes || stridedUpload || upload.region.height() == 1) {
+                // zero copy: the upload reads straight from the frame
+                desc.setData(QByteArray::fromRawData(reinterpret_cast<const char*>(src), stride * (upload.region.height() - 1) + rowBytes));
+                desc.setDataStride(quint32(stride));
+            } else {
+                QByteArray packed(rowBytes * upload.region.height(), Qt::Uninitialized);
+                for (int y = 0; y < upload.region.height(); ++y) {
+                    memcpy(packed.data() + y * rowBytes, src + y * stride, rowBytes);
+                }
+                desc.setData(packed);
+            }
+            desc.setSourceSize(upload.region.size());
+            desc.setDestinationTopLeft(upload.dst + upload.region.topLeft());
+            entries.append(QRhiTextureUploadEntry(0, 0, desc));
+            bytes += quint64(rowBytes) * quint64(upload.region.height());
+            m_inFlight.append(upload.frame);
+        }
+        QRhiTextureUploadDescription desc;
+        desc.setEntries(entries.cbegin(), entries.cend());
+        resourceUpdates->uploadTexture(m_texture, desc);
+        s_uploadedBytes += bytes;
+        m_uploads.clear();
+    }
+
+private:
+    struct Upload {
+        std::shared_ptr<armcloud::VideoFrame> frame;
+        QRect region;
+        QPoint dst;
+    };
+
+    QRhiTexture* m_texture = nullptr;
+    QSize m_size;
+    QVector<Upload> m_uploads;
+    // keeps the frames alive until the batch reading them has been submitted
+    QVector<std::shared_ptr<armcloud::VideoFrame>> m_inFlight;
+};
+
+class WallNode : public QSGGeometryNode
+{
+public:
+    struct Slot {
+        QString owner;
+        quint64 lastUsed = 0;
+        // the slot holds a picture of owner
+        bool valid = false;
+        uint64_t contentId = 0;
+        QSize content;
+    };
+
+    WallNode()
+        : m_geometry(QSGGeometry::defaultAttributes_TexturedPoint2D(), 0, 0, QSGGeometry::UnsignedShortType)
+    {
+        m_geometry.setDrawingMode(QSGGeometry::DrawTriangles);
+        setGeometry(&m_geometry);
+        m_material.setTexture(&m_atlas);
+        setMaterial(&m_material);
+    }
+
+    // drops all slots, used when the slot size changes
+    void reset(const QSize& slotSize) {
+        m_slotSize = slotSize;
+        m_slots.clear();
+        m_slotOf.clear();
+        m_columns = 0;
+        m_maxSlots = 0;
+    }
+
+    // grows the atlas by whole rows until it has at least count slots, or
+    // as many as fit. Returns false if there is no atlas at all
+    bool reserve(QRhi* rhi, int count) {
+        if (m_slotSize.isEmpty()) {
+            return false;
+        }
+        if (!m_maxSlots) {
+            const int limit = qMin(WALL_ATLAS_MAX_SIZE, rhi->resourceLimit(QRhi::TextureSizeMax));
+            m_columns = qMax(0, limit / m_slotSize.width());
+            m_maxSlots = m_columns * qMax(0, limit / m_slotSize.height());
+            if (!m_maxSlots) {
+                qWarning() << "VideoWallItem: slot size" << m_slotSize << "exceeds the atlas limit" << limit;
+                return false;
+            }
+        }
+
+        count = qBound(1, count, m_maxSlots);
+        if (count <= m_slots.size() && m_atlas.isValid()) {
+            return true;
+        }
+        // grow in steps of doubling rows, each growth loses the atlas content
+        int rows = qMax(1, (m_slots.size() + m_columns - 1) / m_columns);
+        while (rows * m_columns < count) {
+            rows *= 2;
+        }
+        rows = qMin(rows, m_maxSlots / m_columns);
+        const bool reallocated = m_atlas.ensure(rhi, QSize(m_columns * m_slotSize.width(), rows * m_slotSize.height()));
+        if (!m_atlas.isValid()) {
+            return false;
+        }
+        if (reallocated || m_slots.size() != rows * m_columns) {
+            m_slots.resize(rows * m_columns);
+            for (Slot& slot : m_slots) {
+                slot.valid = false;
+            }
+        }
+        return true;
+    }
+
+    int slotCount() const { return m_slots.size(); }
+    QSize slotSize() const { return m_slotSize; }
+    quint64 nextFrame() { return ++m_frameIndex; }
+
+    // frees the slots of tiles that no longer exist
+    template <typename Pred>
+    void releaseSlots(Pred exists) {
+        for (int i = 0; i < m_slots.size(); ++i) {
+            Slot& slot = m_slots[i];
+            if (!slot.owner.isEmpty() && !exists(slot.owner)) {
+                m_slotOf.remove(slot.owner);
+                slot = Slot();
+            }
+        }
+    }
+
+    // the slot of key, taking a free one or the least recently used one that
+    // is not drawn in this frame. -1 when the atlas is full
+    int acquireSlot(const QString& key, quint64 frameIndex) {
+        auto it = m_slotOf.constFind(key);
+        if (it != m_slotOf.constEnd()) {
+            m_slots[it.value()].lastUsed = frameIndex;
+            return it.value();
+        }
+
+        int best = -1;
+        for (int i = 0; i < m_slots.size(); ++i) {
+            const Slot& slot = m_slots[i];
+            if (slot.owner.isEmpty()) {
+                best = i;
+                break;
+            }
+            if (slot.lastUsed < frameIndex && (best < 0 || slot.lastUsed < m_slots[best].lastUsed)) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            return -1;
+        }
+
+        Slot& slot = m_slots[best];
+        if (!slot.owner.isEmpty()) {
+            m_slotOf.remove(slot.owner);
+            ++s_slotEvictions;
+        }
+        slot = Slot();
+        slot.owner = key;
+        slot.lastUsed = frameIndex;
+        m_slotOf.insert(key, best);
+        return best;
+    }
+
+    Slot& slot(int index) { return m_slots[index]; }
+
+    QPoint slotOrigin(int index) const {
+        return QPoint((index % m_columns) * m_slotSize.width(), (index / m_columns) * m_slotSize.height());
+    }
+
+    // uploads frame into the slot, only its dirty regions if the slot holds
+    // the previous picture
+    void upload(int index, const std::shared_ptr<armcloud::VideoFrame>& frame) {
+        Slot& slot = m_slots[index];
+        const QSize size(static_cast<int>(frame->width()), static_cast<int>(frame->height()));
+        const uint64_t contentId = frame->contentId();
+        if (slot.valid && contentId && contentId == slot.contentId && size == slot.content) {
+            return;
+        }
+
+        const QPoint origin = slotOrigin(index);
+        const QRect bounds(QPoint(0, 0), size);
+        const bool partial = slot.valid && contentId && contentId == slot.contentId + 1 && size == slot.content
+                             && !frame->dirtyRegions().empty();
+        if (partial) {
+            for (const armcloud::FrameRegion& r : frame->dirtyRegions()) {
+                const QRect region = QRect(r.x, r.y, r.width, r.height).intersected(bounds);
+                if (!region.isEmpty()) {
+                    m_atlas.addUpload(frame, region, origin);
+                }
+            }
+        } else {
+            m_atlas.addUpload(frame, bounds, origin);
+        }
+        slot.valid = true;
+        slot.contentId = contentId;
+        slot.content = size;
+        frame->notifyStage(armcloud::FrameStage::Uploaded);
+    }
+
+    // one quad per drawn tile, in the order of addQuad() calls
+    void beginQuads(int count) {
+        m_geometry.allocate(count * 4, count * 6);
+        m_quads = 0;
+    }
+
+    void addQuad(const QRectF& rect, int slotIndex, int rotation) {
+        const Slot& slot = m_slots[slotIndex];
+        const QSizeF atlasSize = m_atlas.textureSize();
+        const QPoint origin = slotOrigin(slotIndex);
+        // half a texel inside the picture so linear filtering never reads the
+        // neighbouring slot
+        const qreal u0 = (origin.x() + 0.5) / atlasSize.width();
+        const qreal v0 = (origin.y() + 0.5) / atlasSize.height();
+        const qreal u1 = (origin.x() + slot.content.width() - 0.5) / atlasSize.width();
+        const qreal v1 = (origin.y() + slot.content.height() - 0.5) / atlasSize.height();
+
+        // picture corners TL, TR, BR, BL; a clockwise rotation by k * 90
+        // puts picture corner (i - k) at screen corner i
+        const QPointF uv[4] = { QPointF(u0, v0), QPointF(u1, v0), QPointF(u1, v1), QPointF(u0, v1) };
+        const QPointF pos[4] = { rect.topLeft(), rect.topRight(), rect.bottomRight(), rect.bottomLeft() };
+        const int k = ((rotation / 90) % 4 + 4) % 4;
+
+        QSGGeometry::TexturedPoint2D* vertices = m_geometry.vertexDataAsTexturedPoint2D() + m_quads * 4;
+        for (int i = 0; i < 4; ++i) {
+            const QPointF& t = uv[(i - k + 4) % 4];
+            vertices[i].set(float(pos[i].x()), float(pos[i].y()), float(t.x()), float(t.y()));
+        }
+        quint16* indices = m_geometry.indexDataAsUShort() + m_quads * 6;
+        const quint16 base = quint16(m_quads * 4);
+        indices[0] = base;
+        indices[1] = base + 1;
+        indices[2] = base + 2;
+        indices[3] = base;
+        indices[4] = base + 2;
+        indices[5] = base + 3;
+        ++m_quads;
+    }
+
+    void endQuads() {
+        markDirty(QSGNode::DirtyGeometry | QSGNode::DirtyMaterial);
+    }
+
+private:
+    QSGGeometry m_geometry;
+    QSGOpaqueTextureMaterial m_material;
+    AtlasTexture m_atlas;
+    QSize m_slotSize;
+    int m_columns = 0;
+    int m_maxSlots = 0;
+    QVector<Slot> m_slots;
+    QHash<QString, int> m_slotOf;
+    int m_quads = 0;
+    // increases with every updatePaintNode, for the slot LRU
+    quint64 m_frameIndex = 0;
+};
+
+} // anonymous namespace
+
+
+// --- VideoWallTile ---
+
+VideoWallTile::VideoWallTile(const QString& key, VideoWallItem* wall)
+    : QObject(wall)
+    , m_key(key)
+    , m_wall(wall)
+{
+}
+
+void VideoWallTile::onFrame(std::shared_ptr<armcloud::VideoFrame>& frame) {
+    if (!frame) return;
+
+    {
+        // 在锁内调用，setFallbackSink() 返回后不会再投递给旧的渲染项
+        QMutexLocker locker(&m_mutex);
+        if (m_fallback.load(std::memory_order_relaxed) && m_fallbackSink) {
+            m_fallbackSink->onFrame(frame);
+        }
+        m_frame = frame;
+        m_dirty = true;
+    }
+    m_wall->scheduleUpdate();
+}
+
+void VideoWallTile::setFallbackSink(QObject* sink) {
+    armcloud::VideoRenderSink* renderSink = nullptr;
+    if (auto* item = qobject_cast<VideoRenderItemEx*>(sink)) {
+        renderSink = item;
+    } else if (auto* item = qobject_cast<VideoRenderItem*>(sink)) {
+        renderSink = item;
+    } else if (sink) {
+        qWarning() << "VideoWallTile::setFallbackSink - sink is not a valid VideoRenderSink";
+    }
+    QObject* item = renderSink ? sink : nullptr;
+    QMutexLocker locker(&m_mutex);
+    if (m_fallbackItem == item) {
+        return;
+    }
+    if (m_fallbackItem) {
+        disconnect(m_fallbackItem, &QObject::destroyed, this, nullptr);
+    }
+    m_fallbackItem = item;
+    m_fallbackSink = renderSink;
+    if (item) {
+        // 直接连接：在销毁渲染项的线程中清除，之后投递线程不会再用它
+        connect(item, &QObject::destroyed, this, [this]() {
+            QMutexLocker locker(&m_mutex);
+            m_fallbackItem = nullptr;
+            m_fallbackSink = nullptr;
+        }, Qt::DirectConnection);
+    }
+}
+
+std::shared_ptr<armcloud::VideoFrame> VideoWallTile::takeFrame() {
+    QMutexLocker locker(&m_mutex);
+    if (!m_dirty) {
+        return nullptr;
+    }
+    m_dirty = false;
+    return m_frame;
+}
+
+bool VideoWallTile::hasFrame() {
+    QMutexLocker locker(&m_mutex);
+    return m_frame != nullptr;
+}
+
+std::shared_ptr<armcloud::VideoFrame> VideoWallTile::lastFrame() {
+    QMutexLocker locker(&m_mutex);
+    m_dirty = false;
+    return m_frame;
+}
+
+void VideoWallTile::updateLimits(uint32_t maxWidth, uint32_t maxHeight, uint32_t maxFps) {
+    setRenderSize(maxWidth, maxHeight);
+    setRenderMaxFps(maxFps);
+}
+
+void VideoWallTile::setFallback(bool fallback) {
+    if (m_fallback.load(std::memory_order_relaxed) == fallback)
+        return;
+    m_fallback.store(fallback, std::memory_order_relaxed);
+    if (fallback) {
+        // 独立渲染项立即显示最后一帧
+        QMutexLocker locker(&m_mutex);
+        std::shared_ptr<armcloud::VideoFrame> frame = m_frame;
+        if (frame && m_fallbackSink) {
+            m_fallbackSink->onFrame(frame);
+        }
+    }
+    emit fallbackChanged();
+}
+
+
+// --- VideoWallItem ---
+
+VideoWallItem::VideoWallItem(QQuickItem* parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+}
+
+VideoWallItem::~VideoWallItem() = default;
+
+void VideoWallItem::setSlotSize(const QSize& size) {
+    const QSize slotSize(qMax(2, size.width()) & ~1, qMax(2, size.height()) & ~1);
+    if (m_slotSize == slotSize)
+        return;
+    m_slotSize = slotSize;
+    m_slotSizeChanged = true;
+    updateAllTileLimits();
+    emit slotSizeChanged();
+    update();
+}
+
+void VideoWallItem::setMaxFrameRate(int fps) {
+    fps = qMax(0, fps);
+    if (m_maxFrameRate == fps)
+        return;
+    m_maxFrameRate = fps;
+    updateAllTileLimits();
+    emit maxFrameRateChanged();
+}
+
+QObject* VideoWallItem::tileSink(const QString& key) {
+    if (key.isEmpty()) {
+        return nullptr;
+    }
+    auto it = m_tiles.find(key);
+    if (it == m_tiles.end()) {
+        Tile tile;
+        tile.sink = new VideoWallTile(key, this);
+        it = m_tiles.insert(key, tile);
+        updateTileLimits(it.value());
+    }
+    return it->sink;
+}
+
+void VideoWallItem::setTileRect(const QString& key, const QRectF& rect, int rotation) {
+    auto it = m_tiles.find(key);
+    if (it == m_tiles.end()) {
+        tileSink(key);
+        it = m_tiles.find(key);
+    }
+    if (it->rect == rect && it->rotation == rotation)
+        return;
+    it->rect = rect;
+    it->rotation = rotation;
+    updateTileLimits(it.value());
+    update();
+}
+
+void VideoWallItem::removeTile(const QString& key) {
+    auto it = m_tiles.find(key);
+    if (it == m_tiles.end())
+        return;
+    // 观察者可能仍持有渲染目标的指针，延迟到事件循环删除
+    it->sink->deleteLater();
+    m_tiles.erase(it);
+    update();
+}
+
+void VideoWallItem::clearTiles() {
+    for (const Tile& tile : m_tiles) {
+        tile.sink->deleteLater();
+    }
+    m_tiles.clear();
+    update();
+}
+
+quint64 VideoWallItem::uploadedBytes() const {
+    return s_uploadedBytes.load();
+}
+
+quint64 VideoWallItem::slotEvictions() const {
+    return s_slotEvictions.load();
+}
+
+void VideoWallItem::scheduleUpdate() {
+    // 可在任意线程调用，多个画面的新帧只投递一次刷新
+    if (m_updatePending.exchange(true)) {
+        return;
+    }
+    QMetaObject::invokeMethod(this, &QQuickItem::update, Qt::QueuedConnection);
+}
+
+void VideoWallItem::updateTileLimits(const Tile& tile) {
+    // 帧坐标系下的显示尺寸，旋转90/270度时宽高互换
+    const qreal dpr = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+    const bool transposed = ((tile.rotation / 90) % 2) != 0;
+    uint32_t width = static_cast<uint32_t>(qCeil((transposed ? tile.rect.height() : tile.rect.width()) * dpr));
+    uint32_t height = static_cast<uint32_t>(qCeil((transposed ? tile.rect.width() : tile.rect.height()) * dpr));
+    if (width == 0 || height == 0) {
+        width = static_cast<uint32_t>(m_slotSize.width());
+        height = static_cast<uint32_t>(m_slotSize.height());
+    }
+    tile.sink->updateLimits(qMin(width, static_cast<uint32_t>(m_slotSize.width())),
+                            qMin(height, static_cast<uint32_t>(m_slotSize.height())),
+                            static_cast<uint32_t>(m_maxFrameRate));
+}
+
+void VideoWallItem::updateAllTileLimits() {
+    for (const Tile& tile : m_tiles) {
+        updateTileLimits(tile);
+    }
+}
+
+void VideoWallItem::itemChange(ItemChange change, const ItemChangeData& value) {
+    QQuickItem::itemChange(change, value);
+    if (change == ItemSceneChange || change == ItemDevicePixelRatioHasChanged) {
+        updateAllTileLimits();
+    }
+}
+
+QSGNode* VideoWallItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData*) {
+    auto* node = static_cast<WallNode*>(oldNode);
+    QRhi* rhi = window() ? window()->rhi() : nullptr;
+    if (!rhi) {
+        delete node;
+        return nullptr;
+    }
+    if (!node) {
+        node = new WallNode();
+        m_slotSizeChanged = true;
+    }
+    if (m_slotSizeChanged) {
+        m_slotSizeChanged = false;
+        node->reset(m_slotSize);
+    }
+
+    m_updatePending.store(false);
+    const quint64 frameIndex = node->nextFrame();
+    node->releaseSlots([this](const QString& key) { return m_tiles.contains(key); });
+
+    // 可见且已有画面的画面
+    struct Visible {
+        const Tile* tile;
+        std::shared_ptr<armcloud::VideoFrame> frame;
+        int slot;
+    };
+    QVarLengthArray<Visible, 64> visible;
+    const QRectF bounds = boundingRect();
+    for (const Tile& tile : m_tiles) {
+        if (tile.rect.isEmpty() || !tile.rect.intersects(bounds)) {
+            continue;
+        }
+        Visible entry;
+        entry.tile = &tile;
+        entry.frame = tile.sink->takeFrame();
+        entry.slot = -1;
+        if (!entry.frame && !tile.sink->hasFrame()) {
+            // 还没有画面，不占槽位
+            continue;
+        }
+        visible.append(entry);
+    }
+
+    const bool hasAtlas = node->reserve(rhi, visible.size());
+    const QSize slotSize = node->slotSize();
+    int drawn = 0;
+    int fallbacks = 0;
+    QHash<VideoWallTile*, bool> fallbackStates;
+    for (Visible& entry : visible) {
+        VideoWallTile* sink = entry.tile->sink;
+        int slot = -1;
+        if (hasAtlas && drawn < WALL_MAX_TILES) {
+            slot = node->acquireSlot(sink->key(), frameIndex);
+        }
+        if (slot >= 0) {
+            std::shared_ptr<armcloud::VideoFrame> frame = entry.frame;
+            if (!frame && !node->slot(slot).valid) {
+                // 新分配的槽位（或图集重建），补传最后一帧
+                frame = sink->lastFrame();
+            }
+            if (frame && (frame->format() != armcloud::PixelFormat::ARGB
+                          || static_cast<int>(frame->width()) > slotSize.width()
+                          || static_cast<int>(frame->height()) > slotSize.height())) {
+                // 帧的方向和槽位不符（或格式不对），交给独立渲染项；
+                // 槽位中的旧画面不再显示
+                node->slot(slot).valid = false;
+                slot = -1;
+            } else if (frame) {
+                node->upload(slot, frame);
+            }
+        }
+
+        const bool fallback = slot < 0;
+        if (fallback != sink->fallback()) {
+            fallbackStates.insert(sink, fallback);
+        }
+        if (fallback) {
+            ++fallbacks;
+        } else if (node->slot(slot).valid) {
+            entry.slot = slot;
+            ++drawn;
+        }
+    }
+
+    node->beginQuads(drawn);
+    for (const Visible& entry : visible) {
+        if (entry.slot < 0) {
+            continue;
+        }
+        const WallNode::Slot& slot = node->slot(entry.slot);
+        // 保持比例居中
+        const bool transposed = ((entry.tile->rotation / 90) % 2) != 0;
+        const QSizeF picture = transposed ? QSizeF(slot.content.height(), slot.content.width()) : QSizeF(slot.content);
+        const QRectF& rect = entry.tile->rect;
+        const qreal scale = qMin(rect.width() / picture.width(), rect.height() / picture.height());
+        const QSizeF scaled = picture * scale;
+        const QRectF target(rect.x() + (rect.width() - scaled.width()) / 2, rect.y() + (rect.height() - scaled.height()) / 2,
+                            scaled.width(), scaled.height());
+        node->addQuad(target, entry.slot, entry.tile->rotation);
+    }
+    node->endQuads();
+
+    // 渲染线程中GUI线程阻塞，状态变化投递回GUI线程
+    const int slotCount = node->slotCount();
+    if (fallbackStates.isEmpty() && m_slotCount == slotCount && m_drawnTiles == drawn && m_fallbackTiles == fallbacks) {
+        return node;
+    }
+    QPointer<VideoWallItem> self(this);
+    QMetaObject::invokeMethod(this, [self, fallbackStates, slotCount, drawn, fallbacks]() {
+        if (!self) return;
+        for (auto it = fallbackStates.constBegin(); it != fallbackStates.constEnd(); ++it) {
+            // 画面可能已被移除
+            for (const Tile& tile : self->m_tiles) {
+                if (tile.sink == it.key()) {
+                    tile.sink->setFallback(it.value());
+                    break;
+                }
+            }
+        }
+        if (self->m_slotCount != slotCount || self->m_drawnTiles != drawn || self->m_fallbackTiles != fallbacks) {
+            self->m_slotCount = slotCount;
+            self->m_drawnTiles = drawn;
+            self->m_fallbackTiles = fallbacks;
+            emit self->statsChanged();
+        }
+    }, Qt::QueuedConnection);
+
+    return node;
+}
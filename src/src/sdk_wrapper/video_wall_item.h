@@ -0,0 +1,136 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QQuickItem>
+#include <QRectF>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include "video_render_sink.h"
+#include "video_frame.h"
+
+class VideoWallItem;
+
+// 视频墙中的一个画面，作为观察者的渲染目标（GridObserver::setRenderSink）
+// 由 VideoWallItem::tileSink() 创建，是视频墙的子对象
+class VideoWallTile : public QObject, public armcloud::VideoRenderSink {
+    Q_OBJECT
+    Q_PROPERTY(QString key READ key CONSTANT)
+    // 图集放不下这个画面（槽位已被可见画面占满，或帧的方向和槽位不符），
+    // 帧转给 setFallbackSink() 设置的独立渲染项
+    Q_PROPERTY(bool fallback READ fallback NOTIFY fallbackChanged)
+public:
+    VideoWallTile(const QString& key, VideoWallItem* wall);
+
+    void onFrame(std::shared_ptr<armcloud::VideoFrame>& frame) override;
+
+    QString key() const { return m_key; }
+    bool fallback() const { return m_fallback.load(std::memory_order_relaxed); }
+
+    // 图集放不下时使用的渲染项（VideoRenderItemEx / VideoRenderItem），可传null解除；
+    // 渲染项销毁前最好先解除，destroyed信号发出时派生部分已经析构
+    Q_INVOKABLE void setFallbackSink(QObject* sink);
+
+    // 渲染线程：取出新帧并清除更新标志，没有新帧时返回空
+    std::shared_ptr<armcloud::VideoFrame> takeFrame();
+    bool hasFrame();
+    // 渲染线程：最近一帧，槽位重新分配后用于补传
+    std::shared_ptr<armcloud::VideoFrame> lastFrame();
+    void updateLimits(uint32_t maxWidth, uint32_t maxHeight, uint32_t maxFps);
+
+signals:
+    void fallbackChanged();
+
+private:
+    friend class VideoWallItem;
+    // GUI线程
+    void setFallback(bool fallback);
+
+private:
+    QString m_key;
+    VideoWallItem* m_wall = nullptr;
+    QMutex m_mutex;
+    std::shared_ptr<armcloud::VideoFrame> m_frame;
+    // 有还没上传到图集的新帧
+    bool m_dirty = false;
+    std::atomic<bool> m_fallback{false};
+    // 以下两个由m_mutex保护，投递线程读取，GUI线程修改
+    QObject* m_fallbackItem = nullptr;
+    armcloud::VideoRenderSink* m_fallbackSink = nullptr;
+};
+
+// 多设备视频墙：所有画面上传到同一张BGRA图集纹理，用一个几何节点、一次绘制画出所有可见画面
+// - 每个画面有自己的更新标志，只有收到新帧且可见的画面才上传，内容id连续时只上传变化区域
+// - 图集按固定尺寸的槽位划分，按需要增长；槽位按最近使用时间回收给新出现的可见画面
+// - 图集满了（可见画面多于槽位）时，多出的画面标记为 fallback，由独立渲染项显示
+class VideoWallItem : public QQuickItem {
+    Q_OBJECT
+    // 图集中每个槽位的尺寸（物理像素），帧在核心中缩小到不超过这个尺寸
+    Q_PROPERTY(QSize slotSize READ slotSize WRITE setSlotSize NOTIFY slotSizeChanged)
+    // 生产者送帧的最高帧率，0表示不限制
+    Q_PROPERTY(int maxFrameRate READ maxFrameRate WRITE setMaxFrameRate NOTIFY maxFrameRateChanged)
+    Q_PROPERTY(int slotCount READ slotCount NOTIFY statsChanged)
+    Q_PROPERTY(int drawnTiles READ drawnTiles NOTIFY statsChanged)
+    Q_PROPERTY(int fallbackTiles READ fallbackTiles NOTIFY statsChanged)
+public:
+    explicit VideoWallItem(QQuickItem* parent = nullptr);
+    ~VideoWallItem() override;
+
+    QSize slotSize() const { return m_slotSize; }
+    void setSlotSize(const QSize& size);
+
+    int maxFrameRate() const { return m_maxFrameRate; }
+    void setMaxFrameRate(int fps);
+
+    int slotCount() const { return m_slotCount; }
+    int drawnTiles() const { return m_drawnTiles; }
+    int fallbackTiles() const { return m_fallbackTiles; }
+
+    // 返回key对应的渲染目标，不存在时创建
+    Q_INVOKABLE QObject* tileSink(const QString& key);
+    // rect为画面在本项坐标系中的显示区域，rotation为顺时针角度，只支持90的倍数
+    Q_INVOKABLE void setTileRect(const QString& key, const QRectF& rect, int rotation = 0);
+    Q_INVOKABLE void removeTile(const QString& key);
+    Q_INVOKABLE void clearTiles();
+
+    // 所有视频墙上传到图集的字节数，以及被回收的槽位数
+    Q_INVOKABLE quint64 uploadedBytes() const;
+    Q_INVOKABLE quint64 slotEvictions() const;
+
+signals:
+    void slotSizeChanged();
+    void maxFrameRateChanged();
+    void statsChanged();
+
+protected:
+    QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData*) override;
+    void itemChange(ItemChange change, const ItemChangeData& value) override;
+
+private:
+    friend class VideoWallTile;
+    struct Tile {
+        VideoWallTile* sink = nullptr;
+        QRectF rect;
+        int rotation = 0;
+    };
+
+    // 把每个画面的显示尺寸（物理像素，不超过槽位）和帧率发布给生产者
+    void updateTileLimits(const Tile& tile);
+    void updateAllTileLimits();
+    void scheduleUpdate();
+
+private:
+    // 在GUI线程修改，渲染线程只在GUI线程阻塞时（updatePaintNode）读取
+    QHash<QString, Tile> m_tiles;
+    QSize m_slotSize = QSize(360, 640);
+    int m_maxFrameRate = 0;
+    // 槽位尺寸变化后图集需要重建
+    bool m_slotSizeChanged = true;
+    // 已投递还未处理的刷新
+    std::atomic<bool> m_updatePending{false};
+    int m_slotCount = 0;
+    int m_drawnTiles = 0;
+    int m_fallbackTiles = 0;
+};